@@ -40,6 +40,7 @@
 #include "animation.h"
 #include "iolib.h"
 #include "unit.h"
+#include "unit_manager.h"
 #include "unittype.h"
 
 /*----------------------------------------------------------------------------
@@ -122,6 +123,7 @@ static bool AnimateActionDie(CUnit &unit)
 
 	unit.Remove(NULL);
 	unit.Type = &corpseType;
+	UnitManager.UpdateSlot(unit);
 	unit.Stats = &corpseType.Stats[unit.Player->Index];
 	UpdateUnitSightRange(unit);
 	unit.Place(unit.tilePos);
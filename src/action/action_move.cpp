@@ -160,7 +160,8 @@ int DoActionMove(CUnit &unit)
 				unit.Moving = 0;
 				return d;
 			case PF_WAIT: // No path, wait
-				unit.Wait = 10;
+				// A deferred path request is served in one of the next cycles
+				unit.Wait = unit.pathFinderData->input.IsPathRequestDeferred() ? 1 : 10;
 
 				unit.Moving = 0;
 				return d;
@@ -46,6 +46,7 @@
 #include "spells.h"
 #include "translate.h"
 #include "unit.h"
+#include "unit_manager.h"
 #include "unittype.h"
 
 /// How many resources the player gets back if canceling upgrade
@@ -142,11 +143,13 @@ static int TransformUnitIntoType(CUnit &unit, const CUnitType &newtype)
 	}
 
 	unit.Type = const_cast<CUnitType *>(&newtype);
+	UnitManager.UpdateSlot(unit);
 	unit.Stats = &unit.Type->Stats[player.Index];
+	unit.ActivateBuffs();
 
 	if (newtype.CanCastSpell && !unit.AutoCastSpell) {
-		unit.AutoCastSpell = new char[SpellTypeTable.size()];
-		unit.SpellCoolDownTimers = new int[SpellTypeTable.size()];
+		unit.AutoCastSpell = unit.UnitManagerData.GetAutoCastSpell();
+		unit.SpellCoolDownTimers = unit.UnitManagerData.GetSpellCoolDownTimers();
 		memset(unit.AutoCastSpell, 0, SpellTypeTable.size() * sizeof(char));
 		memset(unit.SpellCoolDownTimers, 0, SpellTypeTable.size() * sizeof(int));
 	}
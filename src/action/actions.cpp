@@ -79,12 +79,24 @@
 ----------------------------------------------------------------------------*/
 
 unsigned SyncHash; /// Hash calculated to find sync failures
+unsigned SyncHashes[SyncHashPartCount]; /// Hash of each part of the state
 
 
 /*----------------------------------------------------------------------------
 --  Functions
 ----------------------------------------------------------------------------*/
 
+/**
+**  Reset SyncHash and the hash of each part of the state.
+*/
+void ResetSyncHashes()
+{
+	SyncHash = 0;
+	for (int i = 0; i != SyncHashPartCount; ++i) {
+		SyncHashes[i] = 0;
+	}
+}
+
 COrder::~COrder()
 {
 	Goal.Reset();
@@ -268,6 +280,10 @@ static inline void IncreaseVariable(CUnit &unit, int index)
 /**
 **  Handle things about the unit that decay over time each cycle
 **
+**  Spell effects and cooldowns are only handled while the unit has some,
+**  see CUnit::BuffsActive. Skipping the others changes nothing: their
+**  effects are 0 and already decrease by 1.
+**
 **  @param unit    The unit that the decay is handled for
 */
 static void HandleBuffsEachCycle(CUnit &unit)
@@ -291,11 +307,17 @@ static void HandleBuffsEachCycle(CUnit &unit)
 		unit.UnderAttack = 0;
 	}
 
+	if (!unit.BuffsActive) {
+		return;
+	}
+	bool active = false;
+
 	if (unit.Type->CanCastSpell) {
 		// decrease spell countdown timers
 		for (unsigned int i = 0; i < SpellTypeTable.size(); ++i) {
 			if (unit.SpellCoolDownTimers[i] > 0) {
 				--unit.SpellCoolDownTimers[i];
+				active |= unit.SpellCoolDownTimers[i] > 0;
 			}
 		}
 	}
@@ -305,12 +327,14 @@ static void HandleBuffsEachCycle(CUnit &unit)
 	for (unsigned int i = 0; i < sizeof(SpellEffects) / sizeof(int); ++i) {
 		unit.Variable[SpellEffects[i]].Increase = -1;
 		IncreaseVariable(unit, SpellEffects[i]);
+		active |= unit.Variable[SpellEffects[i]].Value > 0;
 	}
 
 	const bool lastStatusIsHidden = unit.Variable[INVISIBLE_INDEX].Value > 0;
 	if (lastStatusIsHidden && unit.Variable[INVISIBLE_INDEX].Value == 0) {
 		UnHideUnit(unit);
 	}
+	unit.BuffsActive = active;
 }
 
 /**
@@ -338,19 +362,44 @@ static bool HandleBurnAndPoison(CUnit &unit)
 	return false;
 }
 
+/**
+**  Can the unit burn or suffer from poison, whatever its state.
+**
+**  @param unit  the unit to check
+*/
+static bool CanBurnOrPoison(const CUnit &unit)
+{
+	const CVariable &hp = unit.Variable[HP_INDEX];
+
+	if (hp.Max != 0 && unit.Type->BurnDamageRate && (100 * hp.Value) / hp.Max <= unit.Type->BurnPercent) {
+		return true;
+	}
+	return unit.Variable[POISON_INDEX].Value && unit.Type->PoisonDrain;
+}
+
 /**
 **  Handle things about the unit that decay over time each second
 **
+**  The variables are only handled while the unit has some which change,
+**  or while it can burn or suffer from poison, see CUnit::RegenActive.
+**
 **  @param unit    The unit that the decay is handled for
 */
 static void HandleBuffsEachSecond(CUnit &unit)
 {
+	if (!unit.RegenActive) {
+		return;
+	}
+	bool active = false;
+
 	// User defined variables
 	for (unsigned int i = 0; i < UnitTypeVar.GetNumberVariable(); i++) {
 		if (i == BLOODLUST_INDEX || i == HASTE_INDEX || i == SLOW_INDEX
 			|| i == INVISIBLE_INDEX || i == UNHOLYARMOR_INDEX || i == POISON_INDEX) {
 			continue;
 		}
+		// Disabled variables are kept too, they change once enabled.
+		active |= unit.Variable[i].Increase != 0;
 		if (i == HP_INDEX && HandleBurnAndPoison(unit)) {
 			continue;
 		}
@@ -358,6 +407,7 @@ static void HandleBuffsEachSecond(CUnit &unit)
 			IncreaseVariable(unit, i);
 		}
 	}
+	unit.RegenActive = active || CanBurnOrPoison(unit);
 }
 
 /**
@@ -415,21 +465,22 @@ static void HandleUnitAction(CUnit &unit)
 	unit.Orders[0]->Execute(unit);
 }
 
-template <typename UNITP_ITERATOR>
-static void UnitActionsEachSecond(UNITP_ITERATOR begin, UNITP_ITERATOR end)
+static void UnitActionsEachSecond(unsigned int slotCount)
 {
-	for (UNITP_ITERATOR it = begin; it != end; ++it) {
-		CUnit &unit = **it;
+	for (unsigned int slot = 0; slot != slotCount; ++slot) {
+		CUnit *unitp = UnitManager.GetLoopUnit(slot);
 
-		if (unit.Destroyed) {
+		if (unitp == NULL) {
 			continue;
 		}
+		CUnit &unit = *unitp;
+		const CUnitType &type = UnitManager.GetLoopUnitType(slot);
 
 		// OnEachSecond callback
-		if (unit.Type->OnEachSecond  && unit.IsUnusable(false) == false) {
-			unit.Type->OnEachSecond->pushPreamble();
-			unit.Type->OnEachSecond->pushInteger(UnitNumber(unit));
-			unit.Type->OnEachSecond->run();
+		if (type.OnEachSecond && unit.IsUnusable(false) == false) {
+			type.OnEachSecond->pushPreamble();
+			type.OnEachSecond->pushInteger(UnitNumber(unit));
+			type.OnEachSecond->run();
 		}
 
 		// 1) Blink flag.
@@ -473,15 +524,16 @@ static void DumpUnitInfo(CUnit &unit)
 	fflush(NULL);
 }
 
-template <typename UNITP_ITERATOR>
-static void UnitActionsEachCycle(UNITP_ITERATOR begin, UNITP_ITERATOR end)
+static void UnitActionsEachCycle(unsigned int slotCount)
 {
-	for (UNITP_ITERATOR it = begin; it != end; ++it) {
-		CUnit &unit = **it;
+	for (unsigned int slot = 0; slot != slotCount; ++slot) {
+		CUnit *unitp = UnitManager.GetLoopUnit(slot);
 
-		if (unit.Destroyed) {
+		if (unitp == NULL) {
 			continue;
 		}
+		CUnit &unit = *unitp;
+		const CUnitType &type = UnitManager.GetLoopUnitType(slot);
 
 		if (!ReplayRevealMap && unit.Selected && !unit.IsVisible(*ThisPlayer)) {
 			UnSelectUnit(unit);
@@ -489,10 +541,10 @@ static void UnitActionsEachCycle(UNITP_ITERATOR begin, UNITP_ITERATOR end)
 		}
 
 		// OnEachCycle callback
-		if (unit.Type->OnEachCycle && unit.IsUnusable(false) == false) {
-			unit.Type->OnEachCycle->pushPreamble();
-			unit.Type->OnEachCycle->pushInteger(UnitNumber(unit));
-			unit.Type->OnEachCycle->run();
+		if (type.OnEachCycle && unit.IsUnusable(false) == false) {
+			type.OnEachCycle->pushPreamble();
+			type.OnEachCycle->pushInteger(UnitNumber(unit));
+			type.OnEachCycle->run();
 		}
 
 		// Handle each cycle buffs
@@ -512,9 +564,10 @@ static void UnitActionsEachCycle(UNITP_ITERATOR begin, UNITP_ITERATOR end)
 			DumpUnitInfo(unit);
 		}
 		// Calculate some hash.
-		SyncHash = (SyncHash << 5) | (SyncHash >> 27);
-		SyncHash ^= unit.Orders.empty() == false ? unit.CurrentAction() << 18 : 0;
-		SyncHash ^= unit.Refs << 3;
+		SyncHashMix(SyncHashUnits, (unit.tilePos.x << 16) ^ unit.tilePos.y ^ ((unsigned char)unit.IX << 8) ^ ((unsigned char)unit.IY << 24));
+		SyncHashMix(SyncHashUnits, unit.Variable[HP_INDEX].Value);
+		SyncHashMix(SyncHashUnits, (unit.Orders.empty() == false ? unit.CurrentAction() << 18 : 0) ^ (unit.Orders.size() << 8));
+		SyncHashMix(SyncHashUnits, unit.Refs << 3);
 	}
 }
 
@@ -525,15 +578,17 @@ static void UnitActionsEachCycle(UNITP_ITERATOR begin, UNITP_ITERATOR end)
 void UnitActions()
 {
 	const bool isASecondCycle = !(GameCycle % CYCLES_PER_SECOND);
-	// Unit list may be modified during loop... so make a copy
-	std::vector<CUnit *> table(UnitManager.begin(), UnitManager.end());
+	PathfinderNewCycle();
+	// Unit list may be modified during loop... so go through the slots,
+	// units created meanwhile wait for the next cycle.
+	const unsigned int slotCount = UnitManager.StartLoop();
 
 	// Check for things that only happen every second
 	if (isASecondCycle) {
-		UnitActionsEachSecond(table.begin(), table.end());
+		UnitActionsEachSecond(slotCount);
 	}
 	// Do all actions
-	UnitActionsEachCycle(table.begin(), table.end());
+	UnitActionsEachCycle(slotCount);
 }
 
 //@}
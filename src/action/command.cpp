@@ -915,13 +915,9 @@ void CommandDiplomacy(int player, int state, int opponent)
 */
 void CommandSharedVision(int player, bool state, int opponent)
 {
-	// Do a real hardcore seen recount. First we unmark EVERYTHING.
-	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
-		CUnit &unit = **it;
-		if (!unit.Destroyed) {
-			MapUnmarkUnitSight(unit);
-		}
-	}
+	// The sight of each player does not change, only whose sight it uses.
+	int oldShare[PlayerMax];
+	UnitsSharedVisionMasks(oldShare);
 
 	// Compute Before and after.
 	const int before = Players[player].HasMutualSharedVisionWith(Players[opponent]);
@@ -935,18 +931,19 @@ void CommandSharedVision(int player, bool state, int opponent)
 	if (before && !after) {
 		// Don't share vision anymore. Give each other explored terrain for good-bye.
 
+		unsigned short *playerVisible = Map.Visible.GetWritablePlane(player);
+		unsigned short *opponentVisible = Map.Visible.GetWritablePlane(opponent);
 		for (int i = 0; i != Map.Info.MapWidth * Map.Info.MapHeight; ++i) {
 			CMapField &mf = *Map.Field(i);
-			CMapFieldPlayerInfo &mfp = mf.playerInfo;
 
-			if (mfp.Visible[player] && !mfp.Visible[opponent]) {
-				mfp.Visible[opponent] = 1;
+			if (playerVisible[i] && !opponentVisible[i]) {
+				opponentVisible[i] = 1;
 				if (opponent == ThisPlayer->Index) {
 					Map.MarkSeenTile(mf);
 				}
 			}
-			if (mfp.Visible[opponent] && !mfp.Visible[player]) {
-				mfp.Visible[player] = 1;
+			if (opponentVisible[i] && !playerVisible[i]) {
+				playerVisible[i] = 1;
 				if (player == ThisPlayer->Index) {
 					Map.MarkSeenTile(mf);
 				}
@@ -954,11 +951,15 @@ void CommandSharedVision(int player, bool state, int opponent)
 		}
 	}
 
-	// Do a real hardcore seen recount. Now we remark EVERYTHING
-	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
-		CUnit &unit = **it;
-		if (!unit.Destroyed) {
-			MapMarkUnitSight(unit);
+	// Units go in or out of fog for the players whose vision changed.
+	UnitsUpdateSharedVision(oldShare);
+
+	// The fields seen through the new vision are seen again.
+	if (player == ThisPlayer->Index || opponent == ThisPlayer->Index) {
+		for (int i = 0; i != Map.Info.MapWidth * Map.Info.MapHeight; ++i) {
+			if (Map.FieldTeamVisibilityState(*ThisPlayer, i) == 2) {
+				Map.MarkSeenTile(*Map.Field(i));
+			}
 		}
 	}
 }
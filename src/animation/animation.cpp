@@ -108,167 +108,286 @@ int UnitShowAnimation(CUnit &unit, const CAnimation *anim)
 	return UnitShowAnimationScaled(unit, anim, 8);
 }
 
+CAnimIntArg::CAnimIntArg(const CAnimIntArg &rhs) :
+	Kind(rhs.Kind), OnGoal(rhs.OnGoal), Value(rhs.Value), Index(rhs.Index),
+	Component(rhs.Component), Max(rhs.Max), Spell(rhs.Spell), Name(rhs.Name),
+	PlayerProp(rhs.PlayerProp), PlayerPropArg(rhs.PlayerPropArg),
+	PlayerArg(rhs.PlayerArg ? new CAnimIntArg(*rhs.PlayerArg) : NULL)
+{
+}
+
+CAnimIntArg &CAnimIntArg::operator=(const CAnimIntArg &rhs)
+{
+	if (this != &rhs) {
+		CAnimIntArg *playerArg = rhs.PlayerArg ? new CAnimIntArg(*rhs.PlayerArg) : NULL;
+
+		delete PlayerArg;
+		Kind = rhs.Kind;
+		OnGoal = rhs.OnGoal;
+		Value = rhs.Value;
+		Index = rhs.Index;
+		Component = rhs.Component;
+		Max = rhs.Max;
+		Spell = rhs.Spell;
+		Name = rhs.Name;
+		PlayerProp = rhs.PlayerProp;
+		PlayerPropArg = rhs.PlayerPropArg;
+		PlayerArg = playerArg;
+	}
+	return *this;
+}
+
 /**
 **  Parse player number in animation frame
 **
-**  @param unit      Unit of the animation.
-**  @param parseint  Integer to parse.
-**
-**  @return  The parsed value.
+**  @param s  Player to parse, "this" or any integer argument.
 */
-
-static int ParseAnimPlayer(const CUnit &unit, char *parseint)
+void CAnimIntArg::ParsePlayer(const char *s)
 {
-	if (!strcmp(parseint, "this")) {
-		return unit.Player->Index;
+	if (!strcmp(s, "this")) {
+		Kind = AnimArgThisPlayer;
+		return;
 	}
-	return ParseAnimInt(unit, parseint);
+	Parse(s);
 }
 
-
 /**
 **  Parse integer in animation frame.
 **
-**  @param unit      Unit of the animation.
-**  @param parseint  Integer to parse.
-**
-**  @return  The parsed value.
+**  @param s  Integer to parse.
 */
-
-int ParseAnimInt(const CUnit &unit, const char *parseint)
+void CAnimIntArg::Parse(const char *s)
 {
-	char s[100];
-	const CUnit *goal = &unit;
-
-	if (!strlen(parseint)) {
-		return 0;
+	Kind = AnimArgConstant;
+	Value = 0;
+	if (!*s) {
+		return;
 	}
+	const std::string str(s);
+	const std::string cur = str.size() > 2 ? str.substr(2) : std::string();
 
-	strcpy(s, parseint);
-	char *cur = &s[2];
-	if (s[0] == 'v' || s[0] == 't') { //unit variable detected
-		if (s[0] == 't') {
-			if (unit.CurrentOrder()->HasGoal()) {
-				goal = unit.CurrentOrder()->GetGoal();
+	switch (s[0]) {
+		case 'v': //unit variable detected
+		case 't': {
+			OnGoal = s[0] == 't';
+			const size_t next = cur.find('.');
+			if (next == std::string::npos) {
+				fprintf(stderr, "Need also specify the variable '%s' tag \n", cur.c_str());
+				ExitFatal(1);
+			}
+			Name = cur.substr(0, next);
+			const std::string component = cur.substr(next + 1);
+
+			Kind = AnimArgVariable;
+			Index = UnitTypeVar.VariableNameLookup[Name.c_str()];// User variables
+			if (Index == -1) {
+				if (Name == "ResourcesHeld") {
+					Kind = AnimArgResourcesHeld;
+				} else if (Name == "ResourceActive") {
+					Kind = AnimArgResourceActive;
+				} else if (Name == "_Distance") {
+					Kind = AnimArgDistance;
+				}
+			}
+			if (component == "Value") {
+				Component = AnimArgValue;
+			} else if (component == "Max") {
+				Component = AnimArgMax;
+			} else if (component == "Increase") {
+				Component = AnimArgIncrease;
+			} else if (component == "Enable") {
+				Component = AnimArgEnable;
+			} else if (component == "Percent") {
+				Component = AnimArgPercent;
 			} else {
-				return 0;
+				Component = AnimArgNone;
 			}
+			break;
 		}
-		char *next = strchr(cur, '.');
-		if (next == NULL) {
-			fprintf(stderr, "Need also specify the variable '%s' tag \n", cur);
-			ExitFatal(1);
-		} else {
-			*next = '\0';
-		}
-		const int index = UnitTypeVar.VariableNameLookup[cur];// User variables
-		if (index == -1) {
-			if (!strcmp(cur, "ResourcesHeld")) {
-				return goal->ResourcesHeld;
-			} else if (!strcmp(cur, "ResourceActive")) {
-				return goal->Resource.Active;
-			} else if (!strcmp(cur, "_Distance")) {
-				return unit.MapDistanceTo(*goal);
+		case 'b': //unit bool flag detected
+		case 'g':
+			OnGoal = s[0] == 'g';
+			Kind = AnimArgBoolFlag;
+			Name = cur;
+			Index = UnitTypeVar.BoolFlagNameLookup[Name.c_str()];// User bool flags
+			break;
+		case 's': //spell type detected
+			Kind = AnimArgSpell;
+			Name = cur;
+			Spell = SpellTypeByIdent(Name);
+			break;
+		case 'S': // check if autocast for this spell available
+			Kind = AnimArgAutoCast;
+			Name = cur;
+			Spell = SpellTypeByIdent(Name);
+			break;
+		case 'p': { //player variable detected
+			std::string player;
+			size_t next;
+			if (!cur.empty() && cur[0] == '(') {
+				const size_t end = cur.find(')');
+				if (end == std::string::npos) {
+					fprintf(stderr, "ParseAnimInt: expected ')'\n");
+					ExitFatal(1);
+				}
+				player = cur.substr(1, end - 1);
+				next = end + 1;
+			} else {
+				next = cur.find('.');
+				player = cur.substr(0, next);
 			}
-			fprintf(stderr, "Bad variable name '%s'\n", cur);
-			ExitFatal(1);
-		}
-		if (!strcmp(next + 1, "Value")) {
-			return goal->Variable[index].Value;
-		} else if (!strcmp(next + 1, "Max")) {
-			return goal->Variable[index].Max;
-		} else if (!strcmp(next + 1, "Increase")) {
-			return goal->Variable[index].Increase;
-		} else if (!strcmp(next + 1, "Enable")) {
-			return goal->Variable[index].Enable;
-		} else if (!strcmp(next + 1, "Percent")) {
-			return goal->Variable[index].Value * 100 / goal->Variable[index].Max;
-		}
-		return 0;
-	} else if (s[0] == 'b' || s[0] == 'g') { //unit bool flag detected
-		if (s[0] == 'g') {
-			if (unit.CurrentOrder()->HasGoal()) {
-				goal = unit.CurrentOrder()->GetGoal();
+			if (next == std::string::npos || next >= cur.size()) {
+				fprintf(stderr, "Need also specify the %s player's property\n", player.c_str());
+				ExitFatal(1);
+			}
+			const size_t arg = cur.find('.', next + 1);
+			Kind = AnimArgPlayerVar;
+			if (arg == std::string::npos) {
+				PlayerProp = cur.substr(next + 1);
 			} else {
-				return 0;
+				PlayerProp = cur.substr(next + 1, arg - next - 1);
+				PlayerPropArg = cur.substr(arg + 1);
 			}
+			delete PlayerArg;
+			PlayerArg = new CAnimIntArg;
+			PlayerArg->ParsePlayer(player.c_str());
+			break;
 		}
-		const int index = UnitTypeVar.BoolFlagNameLookup[cur];// User bool flags
-		if (index == -1) {
-			fprintf(stderr, "Bad bool-flag name '%s'\n", cur);
-			ExitFatal(1);
-		}
-		return goal->Type->BoolFlag[index].value;
-	} else if (s[0] == 's') { //spell type detected
-		Assert(goal->CurrentAction() == UnitActionSpellCast);
-		const COrder_SpellCast &order = *static_cast<COrder_SpellCast *>(goal->CurrentOrder());
-		const SpellType &spell = order.GetSpell();
-		if (!strcmp(spell.Ident.c_str(), cur)) {
-			return 1;
-		}
-		return 0;
-	} else if (s[0] == 'S') { // check if autocast for this spell available
-		const SpellType *spell = SpellTypeByIdent(cur);
-		if (!spell) {
-			fprintf(stderr, "Invalid spell: '%s'\n", cur);
-			ExitFatal(1);
-		}
-		if (unit.AutoCastSpell[spell->Slot]) {
-			return 1;
+		case 'r': { //random value
+			const size_t next = cur.find('.');
+			Kind = AnimArgRandom;
+			if (next == std::string::npos) {
+				Value = 0;
+				Max = atoi(cur.c_str());
+			} else {
+				Value = atoi(cur.substr(0, next).c_str());
+				Max = atoi(cur.substr(next + 1).c_str());
+			}
+			break;
 		}
-		return 0;
-	} else if (s[0] == 'p') { //player variable detected
-		char *next;
-		if (*cur == '(') {
-			++cur;
-			char *end = strchr(cur, ')');
-			if (end == NULL) {
-				fprintf(stderr, "ParseAnimInt: expected ')'\n");
+		case 'l': //player number
+			ParsePlayer(cur.c_str());
+			break;
+		default:
+			// Check if we trying to parse a number
+			Assert(isdigit(s[0]) || s[0] == '-');
+			Value = atoi(s);
+			break;
+	}
+}
+
+/**
+**  Look up the names which were not yet defined when parsing.
+*/
+void CAnimIntArg::Resolve() const
+{
+	switch (Kind) {
+		case AnimArgVariable:
+			Index = UnitTypeVar.VariableNameLookup[Name.c_str()];
+			if (Index == -1) {
+				fprintf(stderr, "Bad variable name '%s'\n", Name.c_str());
 				ExitFatal(1);
 			}
-			*end = '\0';
-			next = end + 1;
-		} else {
-			next = strchr(cur, '.');
-		}
-		if (next == NULL) {
-			fprintf(stderr, "Need also specify the %s player's property\n", cur);
-			ExitFatal(1);
-		} else {
-			*next = '\0';
-		}
-		char *arg = strchr(next + 1, '.');
-		if (arg != NULL) {
-			*arg = '\0';
+			break;
+		case AnimArgBoolFlag:
+			Index = UnitTypeVar.BoolFlagNameLookup[Name.c_str()];
+			if (Index == -1) {
+				fprintf(stderr, "Bad bool-flag name '%s'\n", Name.c_str());
+				ExitFatal(1);
+			}
+			break;
+		case AnimArgAutoCast:
+			Spell = SpellTypeByIdent(Name);
+			if (!Spell) {
+				fprintf(stderr, "Invalid spell: '%s'\n", Name.c_str());
+				ExitFatal(1);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+**  Evaluate integer in animation frame.
+**
+**  @param unit  Unit of the animation.
+**
+**  @return  The value of the argument.
+*/
+int CAnimIntArg::Eval(const CUnit &unit) const
+{
+	if (Kind == AnimArgConstant) {
+		return Value;
+	}
+	const CUnit *goal = &unit;
+
+	if (OnGoal) {
+		if (!unit.CurrentOrder()->HasGoal()) {
+			return 0;
 		}
-		return GetPlayerData(ParseAnimPlayer(unit, cur), next + 1, arg + 1);
-	} else if (s[0] == 'r') { //random value
-		char *next = strchr(cur, '.');
-		if (next == NULL) {
-			return SyncRand(atoi(cur) + 1);
-		} else {
-			*next = '\0';
-			const int min = atoi(cur);
-			return min + SyncRand(atoi(next + 1) - min + 1);
+		goal = unit.CurrentOrder()->GetGoal();
+	}
+	switch (Kind) {
+		case AnimArgVariable: {
+			if (Index == -1) {
+				Resolve();
+			}
+			const CVariable &var = goal->Variable[Index];
+			switch (Component) {
+				case AnimArgValue: return var.Value;
+				case AnimArgMax: return var.Max;
+				case AnimArgIncrease: return var.Increase;
+				case AnimArgEnable: return var.Enable;
+				case AnimArgPercent: return var.Value * 100 / var.Max;
+				default: return 0;
+			}
 		}
-	} else if (s[0] == 'l') { //player number
-		return ParseAnimPlayer(unit, cur);
+		case AnimArgResourcesHeld:
+			return goal->ResourcesHeld;
+		case AnimArgResourceActive:
+			return goal->Resource.Active;
+		case AnimArgDistance:
+			return unit.MapDistanceTo(*goal);
+		case AnimArgBoolFlag:
+			if (Index == -1) {
+				Resolve();
+			}
+			return goal->Type->BoolFlag[Index].value;
+		case AnimArgSpell: {
+			Assert(goal->CurrentAction() == UnitActionSpellCast);
+			const COrder_SpellCast &order = *static_cast<COrder_SpellCast *>(goal->CurrentOrder());
 
+			if (Spell == NULL) {
+				Spell = SpellTypeByIdent(Name);
+			}
+			return &order.GetSpell() == Spell ? 1 : 0;
+		}
+		case AnimArgAutoCast:
+			if (Spell == NULL) {
+				Resolve();
+			}
+			return unit.AutoCastSpell[Spell->Slot] ? 1 : 0;
+		case AnimArgPlayerVar:
+			return GetPlayerData(PlayerArg->Eval(unit), PlayerProp.c_str(), PlayerPropArg.c_str());
+		case AnimArgRandom:
+			return Value + SyncRand(Max - Value + 1);
+		case AnimArgThisPlayer:
+			return unit.Player->Index;
+		default:
+			return Value;
 	}
-	// Check if we trying to parse a number
-	Assert(isdigit(s[0]) || s[0] == '-');
-	return atoi(parseint);
 }
 
 /**
 **  Parse flags list in animation frame.
 **
-**  @param unit       Unit of the animation.
+**  @param type       Type of the animation step the flags belong to.
 **  @param parseflag  Flag list to parse.
 **
 **  @return The parsed value.
 */
-int ParseAnimFlags(const CUnit &unit, const char *parseflag)
+int ParseAnimFlags(AnimationType type, const char *parseflag)
 {
 	char s[100];
 	int flags = 0;
@@ -282,7 +401,7 @@ int ParseAnimFlags(const CUnit &unit, const char *parseflag)
 			*next = '\0';
 			++next;
 		}
-		if (unit.Anim.Anim->Type == AnimationSpawnMissile) {
+		if (type == AnimationSpawnMissile) {
 			if (!strcmp(cur, "none")) {
 				flags = SM_None;
 				return flags;
@@ -302,7 +421,7 @@ int ParseAnimFlags(const CUnit &unit, const char *parseflag)
 				fprintf(stderr, "Unknown animation flag: %s\n", cur);
 				ExitFatal(1);
 			}
-		} else if (unit.Anim.Anim->Type == AnimationSpawnUnit) {
+		} else if (type == AnimationSpawnUnit) {
 			if (!strcmp(cur, "none")) {
 				flags = SU_None;
 				return flags;
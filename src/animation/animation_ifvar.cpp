@@ -69,8 +69,8 @@ static bool returnFalse(int, int) { return false; }
 {
 	Assert(unit.Anim.Anim == this);
 
-	const int lop = ParseAnimInt(unit, this->leftVar.c_str());
-	const int rop = ParseAnimInt(unit, this->rightVar.c_str());
+	const int lop = this->leftVar.Eval(unit);
+	const int rop = this->rightVar.Eval(unit);
 	const bool cond = this->binOpFunc(lop, rop);
 
 	if (cond) {
@@ -88,7 +88,7 @@ static bool returnFalse(int, int) { return false; }
 
 	size_t begin = 0;
 	size_t end = std::min(len, str.find(' ', begin));
-	this->leftVar.assign(str, begin, end - begin);
+	this->leftVar.Parse(str.substr(begin, end - begin).c_str());
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
@@ -134,7 +134,7 @@ static bool returnFalse(int, int) { return false; }
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->rightVar.assign(str, begin, end - begin);
+	this->rightVar.Parse(str.substr(begin, end - begin).c_str());
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
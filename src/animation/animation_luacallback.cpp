@@ -47,10 +47,8 @@
 	Assert(cb);
 
 	cb->pushPreamble();
-	for (std::vector<std::string>::const_iterator it = cbArgs.begin(); it != cbArgs.end(); ++it) {
-		const std::string str = *it;
-
-		const int arg = ParseAnimInt(unit, str.c_str());
+	for (std::vector<CAnimIntArg>::const_iterator it = cbArgs.begin(); it != cbArgs.end(); ++it) {
+		const int arg = it->Eval(unit);
 		cb->pushInteger(arg);
 	}
 	cb->run();
@@ -76,7 +74,8 @@
 		 begin != std::string::npos;) {
 		end = std::min(len, str.find(' ', begin));
 
-		this->cbArgs.push_back(str.substr(begin, end - begin));
+		this->cbArgs.push_back(CAnimIntArg());
+		this->cbArgs.back().Parse(str.substr(begin, end - begin).c_str());
 		begin = str.find_first_not_of(' ', end);
 	}
 }
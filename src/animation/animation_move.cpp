@@ -44,12 +44,12 @@
 	Assert(unit.Anim.Anim == this);
 	Assert(!move);
 
-	move = ParseAnimInt(unit, this->moveStr.c_str());
+	move = this->moveArg.Eval(unit);
 }
 
 /* virtual */ void CAnimation_Move::Init(const char *s, lua_State *)
 {
-	this->moveStr = s;
+	this->moveArg.Parse(s);
 }
 
 //@}
@@ -43,7 +43,7 @@
 {
 	Assert(unit.Anim.Anim == this);
 
-	if (SyncRand() % 100 < ParseAnimInt(unit, this->randomStr.c_str())) {
+	if (SyncRand() % 100 < this->randomArg.Eval(unit)) {
 		unit.Anim.Anim = this->gotoLabel;
 	}
 }
@@ -58,7 +58,7 @@
 
 	size_t begin = 0;
 	size_t end = str.find(' ', begin);
-	this->randomStr.assign(str, begin, end - begin);
+	this->randomArg.Parse(str.substr(begin, end - begin).c_str());
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
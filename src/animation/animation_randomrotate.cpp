@@ -45,15 +45,15 @@
 	Assert(unit.Anim.Anim == this);
 
 	if ((SyncRand() >> 8) & 1) {
-		UnitRotate(unit, -ParseAnimInt(unit, this->rotateStr.c_str()));
+		UnitRotate(unit, -this->rotateArg.Eval(unit));
 	} else {
-		UnitRotate(unit, ParseAnimInt(unit, this->rotateStr.c_str()));
+		UnitRotate(unit, this->rotateArg.Eval(unit));
 	}
 }
 
 /* virtual */ void CAnimation_RandomRotate::Init(const char *s, lua_State *)
 {
-	this->rotateStr = s;
+	this->rotateArg.Parse(s);
 }
 
 //@}
@@ -56,7 +56,7 @@ void UnitRotate(CUnit &unit, int rotate)
 {
 	Assert(unit.Anim.Anim == this);
 
-	if (!strcmp(this->rotateStr.c_str(), "target") && unit.CurrentOrder()->HasGoal()) {
+	if (this->rotateToTarget && unit.CurrentOrder()->HasGoal()) {
 		COrder &order = *unit.CurrentOrder();
 		const CUnit &target = *order.GetGoal();
 		if (target.Destroyed) {
@@ -66,13 +66,18 @@ void UnitRotate(CUnit &unit, int rotate)
 		const Vec2i pos = target.tilePos + target.Type->GetHalfTileSize() - unit.tilePos;
 		UnitHeadingFromDeltaXY(unit, pos);
 	} else {
-		UnitRotate(unit, ParseAnimInt(unit, this->rotateStr.c_str()));
+		UnitRotate(unit, this->rotateArg.Eval(unit));
 	}
 }
 
 /* virtual */ void CAnimation_Rotate::Init(const char *s, lua_State *)
 {
-	this->rotateStr = s;
+	if (!strcmp(s, "target")) {
+		// Without goal, rotate by 0
+		this->rotateToTarget = true;
+	} else {
+		this->rotateArg.Parse(s);
+	}
 }
 
 //@}
@@ -190,8 +190,8 @@ static void SetPlayerData(const int player, const char *prop, const char *arg, i
 
 	const char *var = this->varStr.c_str();
 	const char *arg = this->argStr.c_str();
-	const int playerId = ParseAnimInt(unit, this->playerStr.c_str());
-	int rop = ParseAnimInt(unit, this->valueStr.c_str());
+	const int playerId = this->playerArg.Eval(unit);
+	int rop = this->valueArg.Eval(unit);
 	int data = GetPlayerData(playerId, var, arg);
 
 	switch (this->mod) {
@@ -247,7 +247,7 @@ static void SetPlayerData(const int player, const char *prop, const char *arg, i
 
 	size_t begin = 0;
 	size_t end = str.find(' ', begin);
-	this->playerStr.assign(str, begin, end - begin);
+	this->playerArg.Parse(str.substr(begin, end - begin).c_str());
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
@@ -282,7 +282,7 @@ static void SetPlayerData(const int player, const char *prop, const char *arg, i
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->valueStr.assign(str, begin, end - begin);
+	this->valueArg.Parse(str.substr(begin, end - begin).c_str());
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
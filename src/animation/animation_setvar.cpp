@@ -49,65 +49,51 @@
 {
 	Assert(unit.Anim.Anim == this);
 
-	char arg1[128];
 	CUnit *goal = &unit;
-	strcpy(arg1, this->varStr.c_str());
-
-	if (this->unitSlotStr.empty() == false) {
-		switch (this->unitSlotStr[0]) {
-			case 'l': // last created unit
-				goal = UnitManager.lastCreatedUnit();
-				break;
-			case 't': // target unit
-				goal = unit.CurrentOrder()->GetGoal();
-				break;
-			case 's': // unit self (no use)
-				goal = &unit;
-				break;
-		}
+
+	switch (this->unitSlot) {
+		case 'l': // last created unit
+			goal = UnitManager.lastCreatedUnit();
+			break;
+		case 't': // target unit
+			goal = unit.CurrentOrder()->GetGoal();
+			break;
+		case 's': // unit self (no use)
+			goal = &unit;
+			break;
 	}
 	if (!goal) {
 		return;
 	}
 
-	char *next = strchr(arg1, '.');
-	if (next == NULL) {
-		// Special case for non-CVariable variables
-		if (!strcmp(arg1, "DamageType")) {
-			int death = ExtraDeathIndex(this->valueStr.c_str());
-			if (death == ANIMATIONS_DEATHTYPES) {
-				fprintf(stderr, "Incorrect death type : %s \n" _C_ this->valueStr.c_str());
-				Exit(1);
-				return;
-			}
-			goal->Type->DamageType = this->valueStr;
+	if (this->component == VarDamageType) {
+		int death = ExtraDeathIndex(this->valueStr.c_str());
+		if (death == ANIMATIONS_DEATHTYPES) {
+			fprintf(stderr, "Incorrect death type : %s \n" _C_ this->valueStr.c_str());
+			Exit(1);
 			return;
 		}
-		fprintf(stderr, "Need also specify the variable '%s' tag \n" _C_ arg1);
-		Exit(1);
+		goal->Type->DamageType = this->valueStr;
 		return;
-	} else {
-		*next = '\0';
 	}
-	const int index = UnitTypeVar.VariableNameLookup[arg1];// User variables
-	if (index == -1) {
-		fprintf(stderr, "Bad variable name '%s'\n" _C_ arg1);
-		Exit(1);
-		return;
+	if (this->index == -1) {
+		this->index = UnitTypeVar.VariableNameLookup[this->varName.c_str()];// User variables
+		if (this->index == -1) {
+			fprintf(stderr, "Bad variable name '%s'\n" _C_ this->varName.c_str());
+			Exit(1);
+			return;
+		}
 	}
-
-	const int rop = ParseAnimInt(unit, this->valueStr.c_str());
+	const int index = this->index;
+	const int rop = this->valueArg.Eval(unit);
 	int value = 0;
-	if (!strcmp(next + 1, "Value")) {
-		value = goal->Variable[index].Value;
-	} else if (!strcmp(next + 1, "Max")) {
-		value = goal->Variable[index].Max;
-	} else if (!strcmp(next + 1, "Increase")) {
-		value = goal->Variable[index].Increase;
-	} else if (!strcmp(next + 1, "Enable")) {
-		value = goal->Variable[index].Enable;
-	} else if (!strcmp(next + 1, "Percent")) {
-		value = goal->Variable[index].Value * 100 / goal->Variable[index].Max;
+	switch (this->component) {
+		case VarValue: value = goal->Variable[index].Value; break;
+		case VarMax: value = goal->Variable[index].Max; break;
+		case VarIncrease: value = goal->Variable[index].Increase; break;
+		case VarEnable: value = goal->Variable[index].Enable; break;
+		case VarPercent: value = goal->Variable[index].Value * 100 / goal->Variable[index].Max; break;
+		default: break;
 	}
 	switch (this->mod) {
 		case modAdd:
@@ -150,24 +136,33 @@
 		default:
 			value = rop;
 	}
-	if (!strcmp(next + 1, "Value")) {
-		goal->Variable[index].Value = value;
-	} else if (!strcmp(next + 1, "Max")) {
-		goal->Variable[index].Max = value;
-		// Special case: when adjusting the sight range, we need to update the visibility
-		if (index == SIGHTRANGE_INDEX) {
-			MapUnmarkUnitSight(unit);
-			unit.CurrentSightRange = value;
-			MapMarkUnitSight(unit);
-		}
-	} else if (!strcmp(next + 1, "Increase")) {
-		goal->Variable[index].Increase = value;
-	} else if (!strcmp(next + 1, "Enable")) {
-		goal->Variable[index].Enable = value;
-	} else if (!strcmp(next + 1, "Percent")) {
-		goal->Variable[index].Value = goal->Variable[index].Max * value / 100;
+	switch (this->component) {
+		case VarValue:
+			goal->Variable[index].Value = value;
+			break;
+		case VarMax:
+			goal->Variable[index].Max = value;
+			// Special case: when adjusting the sight range, we need to update the visibility
+			if (index == SIGHTRANGE_INDEX) {
+				MapUnmarkUnitSight(unit);
+				unit.CurrentSightRange = value;
+				MapMarkUnitSight(unit);
+			}
+			break;
+		case VarIncrease:
+			goal->Variable[index].Increase = value;
+			break;
+		case VarEnable:
+			goal->Variable[index].Enable = value;
+			break;
+		case VarPercent:
+			goal->Variable[index].Value = goal->Variable[index].Max * value / 100;
+			break;
+		default:
+			break;
 	}
 	clamp(&goal->Variable[index].Value, 0, goal->Variable[index].Max);
+	goal->ActivateBuffs();
 }
 
 /*
@@ -180,7 +175,7 @@
 
 	size_t begin = 0;
 	size_t end = str.find(' ', begin);
-	this->varStr.assign(str, begin, end - begin);
+	const std::string varStr(str, begin, end - begin);
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
@@ -216,7 +211,37 @@
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->unitSlotStr.assign(str, begin, end - begin);
+	if (begin != end) {
+		this->unitSlot = str[begin];
+	}
+
+	const size_t dot = varStr.find('.');
+	if (dot == std::string::npos) {
+		// Special case for non-CVariable variables
+		if (varStr == "DamageType") {
+			this->component = VarDamageType;
+			return;
+		}
+		fprintf(stderr, "Need also specify the variable '%s' tag \n" _C_ varStr.c_str());
+		Exit(1);
+		return;
+	}
+	this->varName.assign(varStr, 0, dot);
+	this->index = UnitTypeVar.VariableNameLookup[this->varName.c_str()];// User variables
+
+	const std::string component(varStr, dot + 1);
+	if (component == "Value") {
+		this->component = VarValue;
+	} else if (component == "Max") {
+		this->component = VarMax;
+	} else if (component == "Increase") {
+		this->component = VarIncrease;
+	} else if (component == "Enable") {
+		this->component = VarEnable;
+	} else if (component == "Percent") {
+		this->component = VarPercent;
+	}
+	this->valueArg.Parse(this->valueStr.c_str());
 }
 
 //@}
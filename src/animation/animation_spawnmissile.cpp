@@ -50,12 +50,12 @@
 {
 	Assert(unit.Anim.Anim == this);
 
-	const int startx = ParseAnimInt(unit, this->startXStr.c_str());
-	const int starty = ParseAnimInt(unit, this->startYStr.c_str());
-	const int destx = ParseAnimInt(unit, this->destXStr.c_str());
-	const int desty = ParseAnimInt(unit, this->destYStr.c_str());
-	const SpawnMissile_Flags flags = (SpawnMissile_Flags)(ParseAnimFlags(unit, this->flagsStr.c_str()));
-	const int offsetnum = ParseAnimInt(unit, this->offsetNumStr.c_str());
+	const int startx = this->startX.Eval(unit);
+	const int starty = this->startY.Eval(unit);
+	const int destx = this->destX.Eval(unit);
+	const int desty = this->destY.Eval(unit);
+	const SpawnMissile_Flags flags = (SpawnMissile_Flags)(this->flags);
+	const int offsetnum = this->offsetNum.Eval(unit);
 	const CUnit *goal = flags & SM_RelTarget ? unit.CurrentOrder()->GetGoal() : &unit;
 	const int dir = ((goal->Direction + NextDirection / 2) & 0xFF) / NextDirection;
 	const PixelPos moff = goal->Type->MissileOffsets[dir][!offsetnum ? 0 : offsetnum - 1];
@@ -156,27 +156,27 @@
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->startXStr.assign(str, begin, end - begin);
+	this->startX.Parse(str.substr(begin, end - begin).c_str());
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->startYStr.assign(str, begin, end - begin);
+	this->startY.Parse(str.substr(begin, end - begin).c_str());
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->destXStr.assign(str, begin, end - begin);
+	this->destX.Parse(str.substr(begin, end - begin).c_str());
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->destYStr.assign(str, begin, end - begin);
+	this->destY.Parse(str.substr(begin, end - begin).c_str());
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->flagsStr.assign(str, begin, end - begin);
+	this->flags = ParseAnimFlags(this->Type, str.substr(begin, end - begin).c_str());
 
 	begin = std::min(len, str.find_first_not_of(' ', end));
 	end = std::min(len, str.find(' ', begin));
-	this->offsetNumStr.assign(str, begin, end - begin);
+	this->offsetNum.Parse(str.substr(begin, end - begin).c_str());
 }
 
 //@}
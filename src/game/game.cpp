@@ -336,6 +336,67 @@ static int WriteMapPresentation(const std::string &mapname, CMap &map)
 }
 
 
+/**
+**  Write the tiles of the map as one SetTileMap call.
+**
+**  The tiles are run length encoded, each run is 4 bytes:
+**  the run length (1-255), the tile index (low byte first) and the
+**  tile value.  The runs are then written base64 encoded in a lua
+**  long string, so that loading costs a single lua call.
+**
+**  @param f    file to write to
+**  @param map  map to save
+*/
+static void WriteMapTiles(FileWriter &f, const CMap &map)
+{
+	static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	const int size = map.Info.MapWidth * map.Info.MapHeight;
+	std::vector<unsigned char> runs;
+
+	runs.reserve(size);
+	for (int i = 0; i < size;) {
+		const CMapField &mf = map.Fields[i];
+		const int n = map.Tileset->findTileIndexByTile(mf.getGraphicTile());
+		const int value = mf.Value;
+		int count = 1;
+
+		while (count < 255 && i + count < size) {
+			const CMapField &next = map.Fields[i + count];
+			if (next.getGraphicTile() != mf.getGraphicTile() || next.Value != mf.Value) {
+				break;
+			}
+			++count;
+		}
+		runs.push_back(count);
+		runs.push_back(n & 0xFF);
+		runs.push_back((n >> 8) & 0xFF);
+		runs.push_back(value);
+		i += count;
+	}
+
+	f.printf("SetTileMap(%d, %d, [[\n", map.Info.MapWidth, map.Info.MapHeight);
+	char line[80];
+	int pos = 0;
+	for (size_t i = 0; i < runs.size(); i += 3) {
+		const unsigned int b0 = runs[i];
+		const unsigned int b1 = i + 1 < runs.size() ? runs[i + 1] : 0;
+		const unsigned int b2 = i + 2 < runs.size() ? runs[i + 2] : 0;
+		const unsigned int bits = (b0 << 16) | (b1 << 8) | b2;
+
+		line[pos++] = base64[(bits >> 18) & 0x3F];
+		line[pos++] = base64[(bits >> 12) & 0x3F];
+		line[pos++] = i + 1 < runs.size() ? base64[(bits >> 6) & 0x3F] : '=';
+		line[pos++] = i + 2 < runs.size() ? base64[bits & 0x3F] : '=';
+		if (pos == 76) {
+			line[pos] = '\0';
+			f.printf("%s\n", line);
+			pos = 0;
+		}
+	}
+	line[pos] = '\0';
+	f.printf("%s]])\n", line);
+}
+
 /**
 **  Write the map setup file.
 **
@@ -382,15 +443,7 @@ int WriteMapSetup(const char *mapSetup, CMap &map, int writeTerrain)
 
 		if (writeTerrain) {
 			f->printf("-- Tiles Map\n");
-			for (int i = 0; i < map.Info.MapHeight; ++i) {
-				for (int j = 0; j < map.Info.MapWidth; ++j) {
-					const CMapField &mf = map.Fields[j + i * map.Info.MapWidth];
-					const int tile = mf.getGraphicTile();
-					const int n = map.Tileset->findTileIndexByTile(tile);
-					const int value = mf.Value;
-					f->printf("SetTile(%3d, %d, %d, %d)\n", n, j, i, value);
-				}
-			}
+			WriteMapTiles(*f, map);
 		}
 
 		f->printf("\n-- set map default stat and map sound for unit types\n");
@@ -766,7 +819,7 @@ void CreateGame(const std::string &filename, CMap *map)
 		// if is a network game, it is necessary to reinitialize the syncrand
 		// variables before beginning to load the map, due to random map
 		// generation
-		SyncHash = 0;
+		ResetSyncHashes();
 		InitSyncRand();
 	}
 
@@ -783,6 +836,10 @@ void CreateGame(const std::string &filename, CMap *map)
 		if (GameSettings.Presets[i].Type != SettingsPresetMapDefault) {
 			playertype = GameSettings.Presets[i].Type;
 		}
+		if (HeadlessMode && playertype == PlayerPerson && !IsReplayGame()) {
+			// Nobody to give orders, let the AI play
+			playertype = PlayerComputer;
+		}
 		CreatePlayer(playertype);
 		if (GameSettings.Presets[i].Team != SettingsPresetMapDefault) {
 			int presetTeam = GameSettings.Presets[i].Team;
@@ -825,7 +882,7 @@ void CreateGame(const std::string &filename, CMap *map)
 
 	GameCycle = 0;
 	FastForwardCycle = 0;
-	SyncHash = 0;
+	ResetSyncHashes();
 	InitSyncRand();
 
 	if (IsNetworkGame()) { // Prepare network play
@@ -1440,6 +1497,13 @@ static int CclSavedGameInfo(lua_State *l)
 			}
 		} else if (!strcmp(value, "SyncHash")) {
 			SyncHash = LuaToNumber(l, -1);
+		} else if (!strcmp(value, "SyncHashes")) {
+			if (!lua_istable(l, -1) || lua_rawlen(l, -1) != SyncHashPartCount) {
+				LuaError(l, "incorrect argument for SyncHashes");
+			}
+			for (int i = 0; i != SyncHashPartCount; ++i) {
+				SyncHashes[i] = LuaToNumber(l, -1, i + 1);
+			}
 		} else if (!strcmp(value, "SyncRandSeed")) {
 			SyncRandSeed = LuaToNumber(l, -1);
 		} else {
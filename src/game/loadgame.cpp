@@ -118,7 +118,7 @@ void InitModules()
 {
 	GameCycle = 0;
 	FastForwardCycle = 0;
-	SyncHash = 0;
+	ResetSyncHashes();
 
 	CallbackMusicOn();
 	InitSyncRand();
@@ -189,11 +189,9 @@ static void PlaceUnits()
 }
 
 /**
-**  Load a game to file.
-**
-**  @param filename  File name to be loaded.
+**  Prepare the modules to run a save game script.
 */
-void LoadGame(const std::string &filename)
+static void BeginLoadGame()
 {
 	// log will be enabled if found in the save game
 	CommandLogDisabled = true;
@@ -204,7 +202,13 @@ void LoadGame(const std::string &filename)
 
 	LuaGarbageCollect();
 	InitUnitTypes(1);
-	LuaLoadFile(filename);
+}
+
+/**
+**  Finish loading the game after the save game script ran.
+*/
+static void EndLoadGame()
+{
 	LuaGarbageCollect();
 
 	PlaceUnits();
@@ -212,6 +216,8 @@ void LoadGame(const std::string &filename)
 	const unsigned long game_cycle = GameCycle;
 	const unsigned syncrand = SyncRandSeed;
 	const unsigned synchash = SyncHash;
+	unsigned synchashes[SyncHashPartCount];
+	memcpy(synchashes, SyncHashes, sizeof(synchashes));
 
 	InitModules();
 	LoadModules();
@@ -219,7 +225,32 @@ void LoadGame(const std::string &filename)
 	GameCycle = game_cycle;
 	SyncRandSeed = syncrand;
 	SyncHash = synchash;
+	memcpy(SyncHashes, synchashes, sizeof(synchashes));
 	SelectionChanged();
 }
 
+/**
+**  Load a game to file.
+**
+**  @param filename  File name to be loaded.
+*/
+void LoadGame(const std::string &filename)
+{
+	BeginLoadGame();
+	LuaLoadFile(filename);
+	EndLoadGame();
+}
+
+/**
+**  Load a game saved in memory with SaveGameToMemory.
+**
+**  @param data  The save game.
+*/
+void LoadGameFromMemory(const std::string &data)
+{
+	BeginLoadGame();
+	LuaLoadBuffer(data, "saved game");
+	EndLoadGame();
+}
+
 //@}
@@ -47,6 +47,7 @@
 #include "network.h"
 #include "parameters.h"
 #include "player.h"
+#include "results.h"
 #include "script.h"
 #include "settings.h"
 #include "sound.h"
@@ -56,6 +57,7 @@
 #include "unittype.h"
 #include "version.h"
 
+#include <map>
 #include <sstream>
 #include <time.h>
 
@@ -149,10 +151,104 @@ public:
 	LogEntry *Commands;
 };
 
+/**
+**  Replay keyframe: the game saved in memory at a cycle of the replay,
+**  so that the replay can restart from there instead of from cycle 0.
+*/
+class ReplayKeyframe
+{
+public:
+	ReplayKeyframe() : GameCycle(0), Step(0) {}
+
+	unsigned long GameCycle;  /// Cycle of the save
+	int Step;                 /// Number of commands replayed before the save
+	std::string Save;         /// The saved game
+};
+
+/**
+**  Binary replay log writer.
+**
+**  Numbers are written 7 bits per byte, low bits first, the high bit
+**  telling if more bytes follow.  Signed numbers are zigzag encoded.
+**  Each command is written as the difference to the previous command,
+**  and each string as an index in a table growing with each new string.
+*/
+class BinaryReplayWriter
+{
+public:
+	BinaryReplayWriter() :
+		LastCycle(0), LastUnitNumber(-1), LastPosX(-1), LastPosY(-1),
+		LastDestUnitNumber(-1), LastNum(-1)
+	{}
+
+	void WriteHeader(const FullReplay &replay);
+	void WriteCommand(const LogEntry &log);
+
+private:
+	void PutNumber(unsigned long value);
+	void PutSigned(long value);
+	void PutString(const std::string &value);
+	void PutSymbol(const std::string &value);
+
+public:
+	std::string Data;  /// Encoded data not yet written to the file
+private:
+	std::map<std::string, unsigned long> Symbols;  /// String table
+	unsigned long LastCycle;
+	int LastUnitNumber;
+	int LastPosX;
+	int LastPosY;
+	int LastDestUnitNumber;
+	int LastNum;
+};
+
+/**
+**  Binary replay log reader, see BinaryReplayWriter for the format.
+*/
+class BinaryReplayReader
+{
+public:
+	explicit BinaryReplayReader(const std::string &data) :
+		Data(data), Pos(0), Error(false),
+		LastCycle(0), LastUnitNumber(-1), LastPosX(-1), LastPosY(-1),
+		LastDestUnitNumber(-1), LastNum(-1)
+	{}
+
+	bool ReadHeader(FullReplay &replay);
+	LogEntry *ReadCommand();
+
+private:
+	unsigned long GetNumber();
+	long GetSigned();
+	std::string GetString();
+	std::string GetSymbol();
+
+private:
+	const std::string &Data;  /// Encoded data
+	size_t Pos;               /// Read position in Data
+	bool Error;               /// Data is truncated or invalid
+	std::vector<std::string> Symbols;  /// String table
+	unsigned long LastCycle;
+	int LastUnitNumber;
+	int LastPosX;
+	int LastPosY;
+	int LastDestUnitNumber;
+	int LastNum;
+};
+
 //----------------------------------------------------------------------------
 // Constants
 //----------------------------------------------------------------------------
 
+/// First bytes of a binary replay
+#define REPLAY_BINARY_MAGIC "SRPL"
+/// Version of the binary replay format
+#define REPLAY_BINARY_VERSION 1
+/// Extension of the binary replays
+#define REPLAY_BINARY_EXTENSION ".rpb"
+/// Cycles between two replay keyframes
+#define REPLAY_KEYFRAME_CYCLES (CYCLES_PER_SECOND * 60)
+
 
 //----------------------------------------------------------------------------
 // Variables
@@ -166,6 +262,272 @@ static unsigned long NextLogCycle; /// Next log cycle number
 static int InitReplay;             /// Initialize replay
 static FullReplay *CurrentReplay;
 static LogEntry *ReplayStep;
+static CFile *BinaryLogFile;       /// Binary replay log file
+static BinaryReplayWriter *BinaryLog; /// Encoder of the binary replay log
+static std::vector<ReplayKeyframe> ReplayKeyframes; /// Keyframes of the replay being viewed
+static unsigned long ReplaySeekCycle = ~0UL; /// Cycle asked by SeekReplay, ~0UL for none
+
+//----------------------------------------------------------------------------
+// Binary replay format
+//----------------------------------------------------------------------------
+
+void BinaryReplayWriter::PutNumber(unsigned long value)
+{
+	while (value >= 0x80) {
+		Data += static_cast<char>((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+	Data += static_cast<char>(value);
+}
+
+void BinaryReplayWriter::PutSigned(long value)
+{
+	PutNumber(value < 0 ? ((~static_cast<unsigned long>(value)) << 1) | 1 : static_cast<unsigned long>(value) << 1);
+}
+
+void BinaryReplayWriter::PutString(const std::string &value)
+{
+	PutNumber(value.size());
+	Data += value;
+}
+
+/**
+**  Write a string as its index in the string table, an index equal to
+**  the table size is followed by the new string.
+*/
+void BinaryReplayWriter::PutSymbol(const std::string &value)
+{
+	std::map<std::string, unsigned long>::const_iterator it = Symbols.find(value);
+
+	if (it != Symbols.end()) {
+		PutNumber(it->second);
+		return;
+	}
+	const unsigned long index = Symbols.size();
+	Symbols[value] = index;
+	PutNumber(index);
+	PutString(value);
+}
+
+void BinaryReplayWriter::WriteHeader(const FullReplay &replay)
+{
+	Data += REPLAY_BINARY_MAGIC;
+	PutNumber(REPLAY_BINARY_VERSION);
+	PutString(replay.Comment1);
+	PutString(replay.Comment2);
+	PutString(replay.Comment3);
+	PutString(replay.Date);
+	PutString(replay.Map);
+	PutString(replay.MapPath);
+	PutNumber(replay.MapId);
+	PutSigned(replay.Type);
+	PutSigned(replay.Race);
+	PutSigned(replay.LocalPlayer);
+	PutNumber(PlayerMax);
+	for (int i = 0; i < PlayerMax; ++i) {
+		const MPPlayer &player = replay.Players[i];
+
+		PutString(player.Name);
+		PutString(player.AIScript);
+		PutSigned(player.PlayerColor);
+		PutSigned(player.Race);
+		PutSigned(player.Team);
+		PutSigned(player.Type);
+	}
+	PutSigned(replay.Resource);
+	PutSigned(replay.NumUnits);
+	PutSigned(replay.Difficulty);
+	PutNumber(replay.NoFow);
+	PutNumber(replay.Inside);
+	PutSigned(replay.RevealMap);
+	PutSigned(replay.MapRichness);
+	PutSigned(replay.GameType);
+	PutSigned(replay.Opponents);
+	for (int i = 0; i < 3; ++i) {
+		PutSigned(replay.Engine[i]);
+	}
+	for (int i = 0; i < 3; ++i) {
+		PutSigned(replay.Network[i]);
+	}
+}
+
+void BinaryReplayWriter::WriteCommand(const LogEntry &log)
+{
+	Assert(log.GameCycle >= LastCycle);
+
+	PutNumber(log.GameCycle - LastCycle);
+	PutSymbol(log.Action);
+	PutSigned(log.UnitNumber - LastUnitNumber);
+	PutSymbol(log.UnitIdent);
+	PutSigned(log.Flush);
+	PutSigned(log.PosX - LastPosX);
+	PutSigned(log.PosY - LastPosY);
+	PutSigned(log.DestUnitNumber - LastDestUnitNumber);
+	PutSymbol(log.Value);
+	PutSigned(log.Num - LastNum);
+	for (int i = 0; i < 4; ++i) {
+		Data += static_cast<char>((log.SyncRandSeed >> (8 * i)) & 0xFF);
+	}
+
+	LastCycle = log.GameCycle;
+	LastUnitNumber = log.UnitNumber;
+	LastPosX = log.PosX;
+	LastPosY = log.PosY;
+	LastDestUnitNumber = log.DestUnitNumber;
+	LastNum = log.Num;
+}
+
+unsigned long BinaryReplayReader::GetNumber()
+{
+	unsigned long value = 0;
+
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (Pos >= Data.size()) {
+			Error = true;
+			return 0;
+		}
+		const unsigned char c = Data[Pos++];
+		value |= static_cast<unsigned long>(c & 0x7F) << shift;
+		if (!(c & 0x80)) {
+			return value;
+		}
+	}
+	Error = true;
+	return 0;
+}
+
+long BinaryReplayReader::GetSigned()
+{
+	const unsigned long value = GetNumber();
+
+	return (value & 1) ? ~static_cast<long>(value >> 1) : static_cast<long>(value >> 1);
+}
+
+std::string BinaryReplayReader::GetString()
+{
+	const unsigned long size = GetNumber();
+
+	if (Error || size > Data.size() - Pos) {
+		Error = true;
+		return "";
+	}
+	Pos += size;
+	return Data.substr(Pos - size, size);
+}
+
+std::string BinaryReplayReader::GetSymbol()
+{
+	const unsigned long index = GetNumber();
+
+	if (index < Symbols.size()) {
+		return Symbols[index];
+	}
+	if (index != Symbols.size()) {
+		Error = true;
+		return "";
+	}
+	Symbols.push_back(GetString());
+	return Symbols.back();
+}
+
+/**
+**  Read the replay definition.
+**
+**  @return  false if the data isn't a binary replay.
+*/
+bool BinaryReplayReader::ReadHeader(FullReplay &replay)
+{
+	const size_t magicSize = sizeof(REPLAY_BINARY_MAGIC) - 1;
+
+	if (Data.compare(0, magicSize, REPLAY_BINARY_MAGIC) != 0) {
+		return false;
+	}
+	Pos = magicSize;
+	if (GetNumber() != REPLAY_BINARY_VERSION) {
+		return false;
+	}
+	replay.Comment1 = GetString();
+	replay.Comment2 = GetString();
+	replay.Comment3 = GetString();
+	replay.Date = GetString();
+	replay.Map = GetString();
+	replay.MapPath = GetString();
+	replay.MapId = GetNumber();
+	replay.Type = GetSigned();
+	replay.Race = GetSigned();
+	replay.LocalPlayer = GetSigned();
+	if (GetNumber() != PlayerMax) {
+		return false;
+	}
+	for (int i = 0; i < PlayerMax; ++i) {
+		MPPlayer &player = replay.Players[i];
+
+		player.Name = GetString();
+		player.AIScript = GetString();
+		player.PlayerColor = GetSigned();
+		player.Race = GetSigned();
+		player.Team = GetSigned();
+		player.Type = GetSigned();
+	}
+	replay.Resource = GetSigned();
+	replay.NumUnits = GetSigned();
+	replay.Difficulty = GetSigned();
+	replay.NoFow = GetNumber() != 0;
+	replay.Inside = GetNumber() != 0;
+	replay.RevealMap = GetSigned();
+	replay.MapRichness = GetSigned();
+	replay.GameType = GetSigned();
+	replay.Opponents = GetSigned();
+	for (int i = 0; i < 3; ++i) {
+		replay.Engine[i] = GetSigned();
+	}
+	for (int i = 0; i < 3; ++i) {
+		replay.Network[i] = GetSigned();
+	}
+	return !Error;
+}
+
+/**
+**  Read the next command.
+**
+**  @return  The new command, NULL at the end of the data.  A command cut
+**           by the end of the data (game crash) is dropped.
+*/
+LogEntry *BinaryReplayReader::ReadCommand()
+{
+	if (Error || Pos >= Data.size()) {
+		return NULL;
+	}
+	LogEntry *log = new LogEntry;
+
+	log->GameCycle = LastCycle + GetNumber();
+	log->Action = GetSymbol();
+	log->UnitNumber = LastUnitNumber + GetSigned();
+	log->UnitIdent = GetSymbol();
+	log->Flush = GetSigned();
+	log->PosX = LastPosX + GetSigned();
+	log->PosY = LastPosY + GetSigned();
+	log->DestUnitNumber = LastDestUnitNumber + GetSigned();
+	log->Value = GetSymbol();
+	log->Num = LastNum + GetSigned();
+	if (Error || Data.size() - Pos < 4) {
+		Error = true;
+		delete log;
+		return NULL;
+	}
+	log->SyncRandSeed = 0;
+	for (int i = 0; i < 4; ++i) {
+		log->SyncRandSeed |= static_cast<unsigned>(static_cast<unsigned char>(Data[Pos++])) << (8 * i);
+	}
+
+	LastCycle = log->GameCycle;
+	LastUnitNumber = log->UnitNumber;
+	LastPosX = log->PosX;
+	LastPosY = log->PosY;
+	LastDestUnitNumber = log->DestUnitNumber;
+	LastNum = log->Num;
+	return log;
+}
 
 //----------------------------------------------------------------------------
 // Log commands
@@ -232,9 +594,9 @@ static FullReplay *StartReplay()
 }
 
 /**
-**  Applies settings the game used at the start of the replay
+**  Set the replay game type from the replay
 */
-static void ApplyReplaySettings()
+static void ApplyReplayGameType()
 {
 	if (CurrentReplay->Type == ReplayMultiPlayer) {
 		ExitNetwork1();
@@ -247,6 +609,14 @@ static void ApplyReplaySettings()
 		GameSettings.NetGameType = SettingsSinglePlayerGame;
 		ReplayGameType = ReplaySinglePlayer;
 	}
+}
+
+/**
+**  Applies settings the game used at the start of the replay
+*/
+static void ApplyReplaySettings()
+{
+	ApplyReplayGameType();
 
 	for (int i = 0; i < PlayerMax; ++i) {
 		GameSettings.Presets[i].PlayerColor = CurrentReplay->Players[i].PlayerColor;
@@ -377,6 +747,35 @@ static void SaveFullLog(CFile &file)
 	}
 }
 
+/**
+**  Write the pending binary log data to the binary log file.
+*/
+static void FlushBinaryLog()
+{
+	if (!BinaryLog->Data.empty()) {
+		BinaryLogFile->write(BinaryLog->Data.data(), BinaryLog->Data.size());
+		BinaryLogFile->flush();
+		BinaryLog->Data.clear();
+	}
+}
+
+/**
+**  Start the binary log with the FullReplay definition and its commands.
+*/
+static void SaveBinaryFullLog()
+{
+	if (!BinaryLogFile) {
+		return;
+	}
+	delete BinaryLog;
+	BinaryLog = new BinaryReplayWriter;
+	BinaryLog->WriteHeader(*CurrentReplay);
+	for (const LogEntry *log = CurrentReplay->Commands; log; log = log->Next) {
+		BinaryLog->WriteCommand(*log);
+	}
+	FlushBinaryLog();
+}
+
 /**
 **  Append the LogEntry structure at the end of currentLog, and to LogFile
 **
@@ -398,6 +797,11 @@ static void AppendLog(LogEntry *log, CFile &file)
 
 	PrintLogCommand(*log, file);
 	file.flush();
+
+	if (BinaryLog) {
+		BinaryLog->WriteCommand(*log);
+		FlushBinaryLog();
+	}
 }
 
 /**
@@ -442,19 +846,24 @@ void CommandLog(const char *action, const CUnit *unit, int flush,
 
 		path += "/log_of_stratagus_";
 		path += buf;
-		path += ".log";
 
 		LogFile = new CFile;
-		if (LogFile->open(path.c_str(), CL_OPEN_WRITE) == -1) {
+		if (LogFile->open((path + ".log").c_str(), CL_OPEN_WRITE) == -1) {
 			// don't retry for each command
 			CommandLogDisabled = false;
 			delete LogFile;
 			LogFile = NULL;
 			return;
 		}
+		BinaryLogFile = new CFile;
+		if (BinaryLogFile->open((path + REPLAY_BINARY_EXTENSION).c_str(), CL_OPEN_WRITE) == -1) {
+			delete BinaryLogFile;
+			BinaryLogFile = NULL;
+		}
 
 		if (CurrentReplay) {
 			SaveFullLog(*LogFile);
+			SaveBinaryFullLog();
 		}
 	}
 
@@ -462,6 +871,7 @@ void CommandLog(const char *action, const CUnit *unit, int flush,
 		CurrentReplay = StartReplay();
 
 		SaveFullLog(*LogFile);
+		SaveBinaryFullLog();
 	}
 
 	if (!action) {
@@ -706,6 +1116,14 @@ bool IsReplayGame()
 	return ReplayGameType != ReplayNone;
 }
 
+/**
+**  Check if all the commands of the replay are replayed
+*/
+bool IsReplayFinished()
+{
+	return IsReplayGame() && CurrentReplay && !InitReplay && !ReplayStep;
+}
+
 /**
 **  Save generated replay
 **
@@ -716,6 +1134,44 @@ void SaveReplayList(CFile &file)
 	SaveFullLog(file);
 }
 
+/**
+**  Load a binary replay.
+**
+**  @param name  name of file to load.
+**
+**  @return      false if the file isn't a binary replay.
+*/
+static bool LoadBinaryReplay(const std::string &name)
+{
+	CFile file;
+	std::string data;
+	char buf[4096];
+	int size;
+
+	if (file.open(name.c_str(), CL_OPEN_READ) == -1) {
+		return false;
+	}
+	while ((size = file.read(buf, sizeof(buf))) > 0) {
+		data.append(buf, size);
+	}
+	file.close();
+
+	BinaryReplayReader reader(data);
+	FullReplay *replay = new FullReplay;
+	if (!reader.ReadHeader(*replay)) {
+		delete replay;
+		return false;
+	}
+	LogEntry **last = &replay->Commands;
+	while ((*last = reader.ReadCommand()) != NULL) {
+		last = &(*last)->Next;
+	}
+
+	CurrentReplay = replay;
+	ApplyReplaySettings();
+	return true;
+}
+
 /**
 **  Load a log file to replay a game
 **
@@ -725,8 +1181,12 @@ int LoadReplay(const std::string &name)
 {
 	CleanReplayLog();
 	ReplayGameType = ReplaySinglePlayer;
+	ReplayKeyframes.clear();
+	ReplaySeekCycle = ~0UL;
 
-	LuaLoadFile(name);
+	if (!LoadBinaryReplay(name)) {
+		LuaLoadFile(name);
+	}
 
 	NextLogCycle = ~0UL;
 	if (!CommandLogDisabled) {
@@ -749,6 +1209,13 @@ void EndReplayLog()
 		delete LogFile;
 		LogFile = NULL;
 	}
+	if (BinaryLogFile) {
+		BinaryLogFile->close();
+		delete BinaryLogFile;
+		BinaryLogFile = NULL;
+	}
+	delete BinaryLog;
+	BinaryLog = NULL;
 	if (CurrentReplay) {
 		DeleteReplay(CurrentReplay);
 		CurrentReplay = NULL;
@@ -953,11 +1420,58 @@ static void ReplayEachCycle()
 	}
 }
 
+/**
+**  Keep a keyframe of the replay each REPLAY_KEYFRAME_CYCLES.
+**
+**  Called at the start of a game cycle, before its commands are replayed.
+*/
+static void ReplayKeyframeEachCycle()
+{
+	if (GameCycle % REPLAY_KEYFRAME_CYCLES != 0) {
+		return;
+	}
+	if (!ReplayKeyframes.empty() && ReplayKeyframes.back().GameCycle >= GameCycle) {
+		return;
+	}
+	int step = 0;
+	if (!InitReplay) {
+		for (const LogEntry *log = CurrentReplay->Commands; log != ReplayStep; log = log->Next) {
+			++step;
+		}
+	}
+	ReplayKeyframes.push_back(ReplayKeyframe());
+	ReplayKeyframe &keyframe = ReplayKeyframes.back();
+	keyframe.GameCycle = GameCycle;
+	keyframe.Step = step;
+	SaveGameToMemory(keyframe.Save);
+}
+
+/**
+**  Find the last keyframe before a cycle.
+**
+**  @param cycle  The game cycle.
+**
+**  @return       The keyframe, NULL if none.
+*/
+static const ReplayKeyframe *FindReplayKeyframe(unsigned long cycle)
+{
+	const ReplayKeyframe *keyframe = NULL;
+
+	for (size_t i = 0; i < ReplayKeyframes.size() && ReplayKeyframes[i].GameCycle <= cycle; ++i) {
+		keyframe = &ReplayKeyframes[i];
+	}
+	return keyframe;
+}
+
 /**
 **  Replay user commands from log each cycle, single player games
 */
 void SinglePlayerReplayEachCycle()
 {
+	// Keyframes are only for seeking, which needs a player at the screen.
+	if (ReplayGameType != ReplayNone && CurrentReplay && !HeadlessMode) {
+		ReplayKeyframeEachCycle();
+	}
 	if (ReplayGameType == ReplaySinglePlayer) {
 		ReplayEachCycle();
 	}
@@ -996,7 +1510,14 @@ int SaveReplay(const std::string &filename)
 
 	destination = Parameters::Instance.GetUserDirectory() + "/" + GameName + "/logs/" + filename;
 
-	logfile << Parameters::Instance.GetUserDirectory() << "/" << GameName << "/logs/log_of_stratagus_" << ThisPlayer->Index << ".log";
+	logfile << Parameters::Instance.GetUserDirectory() << "/" << GameName << "/logs/log_of_stratagus_" << ThisPlayer->Index;
+	const size_t extensionSize = sizeof(REPLAY_BINARY_EXTENSION) - 1;
+	if (filename.size() > extensionSize
+		&& filename.compare(filename.size() - extensionSize, extensionSize, REPLAY_BINARY_EXTENSION) == 0) {
+		logfile << REPLAY_BINARY_EXTENSION;
+	} else {
+		logfile << ".log";
+	}
 
 	if (stat(logfile.str().c_str(), &sb)) {
 		fprintf(stderr, "stat failed\n");
@@ -1030,6 +1551,65 @@ int SaveReplay(const std::string &filename)
 	return 0;
 }
 
+/**
+**  Seek the replay being viewed to a game cycle.
+**
+**  Going forward fast forwards the game.  Going back, or forward past a
+**  keyframe, restarts the game from the last keyframe before the cycle
+**  and fast forwards from there.
+**
+**  @param cycle  Game cycle to go to.
+*/
+void SeekReplay(unsigned long cycle)
+{
+	if (!IsReplayGame() || !GameRunning) {
+		return;
+	}
+	const ReplayKeyframe *keyframe = FindReplayKeyframe(cycle);
+
+	if (cycle >= GameCycle && (keyframe == NULL || keyframe->GameCycle <= GameCycle)) {
+		FastForwardCycle = cycle;
+		return;
+	}
+	if (keyframe == NULL) {
+		return;
+	}
+	ReplaySeekCycle = cycle;
+	StopGame(GameNoResult);
+}
+
+/**
+**  Restart the replay from the last keyframe before a cycle.
+**
+**  @param cycle   Game cycle to go to.
+**  @param reveal  Reveal the map.
+*/
+static void RestartReplay(unsigned long cycle, bool reveal)
+{
+	const ReplayKeyframe &keyframe = *FindReplayKeyframe(cycle);
+
+	CleanPlayers();
+	LoadGameFromMemory(keyframe.Save);
+
+	// The saved game has the replay, but as a game to go on logging.
+	ApplyReplayGameType();
+	if (!CommandLogDisabled) {
+		CommandLogDisabled = true;
+		DisabledLog = true;
+	}
+	GameObserve = true;
+	InitReplay = 0;
+	ReplayStep = CurrentReplay->Commands;
+	for (int i = 0; i < keyframe.Step && ReplayStep; ++i) {
+		ReplayStep = ReplayStep->Next;
+	}
+	NextLogCycle = ReplayStep ? ReplayStep->GameCycle : ~0UL;
+	FastForwardCycle = cycle;
+	ReplayRevealMap = reveal;
+
+	StartMap(CurrentMapPath, false);
+}
+
 void StartReplay(const std::string &filename, bool reveal)
 {
 	std::string replay;
@@ -1041,6 +1621,14 @@ void StartReplay(const std::string &filename, bool reveal)
 	ReplayRevealMap = reveal;
 
 	StartMap(CurrentMapPath, false);
+
+	while (ReplaySeekCycle != ~0UL) {
+		const unsigned long cycle = ReplaySeekCycle;
+
+		ReplaySeekCycle = ~0UL;
+		RestartReplay(cycle, reveal);
+	}
+	ReplayKeyframes.clear();
 }
 
 /**
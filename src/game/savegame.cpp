@@ -57,6 +57,8 @@
 
 #include <time.h>
 
+#include "SDL.h"
+
 extern void StartMap(const std::string &filename, bool clean);
 
 
@@ -64,6 +66,17 @@ extern void StartMap(const std::string &filename, bool clean);
 --  Variables
 ----------------------------------------------------------------------------*/
 
+unsigned int SaveGameBlockedTicks;  /// Game thread time of the last background save
+
+/// A save game formatted in memory, written to disk by the save thread
+struct BackgroundSave {
+	std::string FullPath;  /// Path of the save file
+	std::string Data;      /// Save game text
+};
+
+static SDL_Thread *SaveThread;          /// Thread writing the background save
+static BackgroundSave *PendingSave;     /// Save written by SaveThread
+
 /*----------------------------------------------------------------------------
 --  Functions
 ----------------------------------------------------------------------------*/
@@ -101,25 +114,13 @@ static std::string GetSaveDir()
 }
 
 /**
-**  Save a game to file.
+**  Write the whole game state.
 **
-**  @param filename  File name to be stored.
-**  @return  -1 if saving failed, 0 if all OK
-**
-**  @note  Later we want to store in a more compact binary format.
+**  @param file      File to write to.
+**  @param filename  File name of the save game.
 */
-int SaveGame(const std::string &filename)
+static void SaveGameState(CFile &file, const std::string &filename)
 {
-	CFile file;
-	std::string fullpath(GetSaveDir());
-
-	fullpath += "/";
-	fullpath += filename;
-	if (file.open(fullpath.c_str(), CL_WRITE_GZ | CL_OPEN_WRITE) == -1) {
-		fprintf(stderr, "Can't save to '%s'\n", filename.c_str());
-		return -1;
-	}
-
 	time_t now;
 	char dateStr[64];
 
@@ -151,6 +152,8 @@ int SaveGame(const std::string &filename)
 	file.printf("---  \"engine\",  {%d, %d, %d},\n",
 				StratagusMajorVersion, StratagusMinorVersion, StratagusPatchLevel);
 	file.printf("  SyncHash = %d, \n", SyncHash);
+	file.printf("  SyncHashes = {%d, %d, %d}, \n",
+				SyncHashes[SyncHashUnits], SyncHashes[SyncHashMissiles], SyncHashes[SyncHashPlayers]);
 	file.printf("  SyncRandSeed = %d, \n", SyncRandSeed);
 	file.printf("  SaveFile = \"%s\"\n", CurrentMapPath);
 	file.printf("\n---  \"preview\", \"%s.pam\",\n", filename.c_str());
@@ -179,10 +182,118 @@ int SaveGame(const std::string &filename)
 		file.printf("-- Lua state\n\n %s\n", s.c_str());
 	}
 	SaveTriggers(file); //Triggers are saved in SaveGlobal, so load it after Global
+}
+
+/**
+**  Save a game to file.
+**
+**  @param filename  File name to be stored.
+**  @return  -1 if saving failed, 0 if all OK
+**
+**  @note  Later we want to store in a more compact binary format.
+*/
+int SaveGame(const std::string &filename)
+{
+	CFile file;
+	std::string fullpath(GetSaveDir());
+
+	fullpath += "/";
+	fullpath += filename;
+
+	// Don't let a background save write the same file.
+	WaitForSaveGame();
+	if (file.open(fullpath.c_str(), CL_WRITE_GZ | CL_OPEN_WRITE) == -1) {
+		fprintf(stderr, "Can't save to '%s'\n", filename.c_str());
+		return -1;
+	}
+	SaveGameState(file, filename);
 	file.close();
 	return 0;
 }
 
+/**
+**  Save a game in memory, to be loaded with LoadGameFromMemory.
+**
+**  @param data  Filled with the save game.
+*/
+void SaveGameToMemory(std::string &data)
+{
+	CFile file;
+
+	file.open("memory", CL_WRITE_MEMORY | CL_OPEN_WRITE);
+	SaveGameState(file, "memory");
+	file.close();
+	file.takeMemory(data);
+}
+
+/**
+**  Compress and write a background save, runs in the save thread.
+**
+**  @param data  The BackgroundSave to write.
+*/
+static int SaveGameThread(void *data)
+{
+	const BackgroundSave &save = *static_cast<BackgroundSave *>(data);
+	CFile file;
+
+	if (file.open(save.FullPath.c_str(), CL_WRITE_GZ | CL_OPEN_WRITE) == -1) {
+		fprintf(stderr, "Can't save to '%s'\n", save.FullPath.c_str());
+		return -1;
+	}
+	file.write(save.Data.data(), save.Data.size());
+	file.close();
+	return 0;
+}
+
+/**
+**  Save a game to file, without stopping the game for the compression
+**  and the disk writes.
+**
+**  The game state is formatted into memory at once, so it is the state
+**  of the current cycle.  A thread then compresses and writes it while
+**  the game goes on.  The time the game was blocked is kept in
+**  SaveGameBlockedTicks.
+**
+**  @param filename  File name to be stored.
+**  @return  -1 if saving failed, 0 if all OK
+*/
+int SaveGameInBackground(const std::string &filename)
+{
+	const Uint32 start = SDL_GetTicks();
+
+	WaitForSaveGame();
+
+	BackgroundSave *save = new BackgroundSave;
+	save->FullPath = GetSaveDir() + "/" + filename;
+	SaveGameToMemory(save->Data);
+
+	PendingSave = save;
+	SaveThread = SDL_CreateThread(SaveGameThread, "SaveGame", save);
+	if (SaveThread == NULL) {
+		DebugPrint("Can't create the save thread: %s\n" _C_ SDL_GetError());
+		SaveGameThread(save);
+		delete save;
+		PendingSave = NULL;
+	}
+	SaveGameBlockedTicks = SDL_GetTicks() - start;
+	DebugPrint("Saved '%s', game blocked for %u ms\n" _C_ filename.c_str() _C_ SaveGameBlockedTicks);
+	return 0;
+}
+
+/**
+**  Wait until the background save is written.
+*/
+void WaitForSaveGame()
+{
+	if (SaveThread == NULL) {
+		return;
+	}
+	SDL_WaitThread(SaveThread, NULL);
+	SaveThread = NULL;
+	delete PendingSave;
+	PendingSave = NULL;
+}
+
 /**
 **  Delete save game
 **
@@ -195,6 +306,7 @@ void DeleteSaveGame(const std::string &filename)
 		return;
 	}
 
+	WaitForSaveGame();
 	std::string fullpath = GetSaveDir() + "/" + filename;
 	if (unlink(fullpath.c_str()) == -1) {
 		fprintf(stderr, "delete failed for %s", fullpath.c_str());
@@ -205,6 +317,7 @@ void StartSavedGame(const std::string &filename)
 {
 	std::string path;
 
+	WaitForSaveGame();
 	SaveGameLoading = true;
 	CleanPlayers();
 	ExpandPath(path, filename);
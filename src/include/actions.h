@@ -171,6 +171,31 @@ typedef COrder *COrderPtr;
 
 extern unsigned SyncHash;  /// Hash calculated to find sync failures
 
+/// Parts of the game state which get their own sync hash
+enum SyncHashPart {
+	SyncHashUnits,     /// unit positions, hit points and orders
+	SyncHashMissiles,  /// global missiles
+	SyncHashPlayers,   /// player resources and unit counts
+	SyncHashPartCount
+};
+
+extern unsigned SyncHashes[SyncHashPartCount];  /// Hash of each part of the state
+
+/**
+**  Mix a value into the hash of a part of the state and into SyncHash.
+**
+**  @param part   Part of the state the value belongs to.
+**  @param value  Value to mix in.
+*/
+inline void SyncHashMix(SyncHashPart part, unsigned value)
+{
+	SyncHashes[part] = ((SyncHashes[part] << 5) | (SyncHashes[part] >> 27)) ^ value;
+	SyncHash = ((SyncHash << 5) | (SyncHash >> 27)) ^ value;
+}
+
+/// Reset SyncHash and the hash of each part
+extern void ResetSyncHashes();
+
 /*----------------------------------------------------------------------------
 --  Actions: in action_<name>.c
 ----------------------------------------------------------------------------*/
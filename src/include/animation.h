@@ -40,6 +40,7 @@
 
 class CFile;
 class CUnit;
+class SpellType;
 struct lua_State;
 
 /*----------------------------------------------------------------------------
@@ -90,6 +91,74 @@ enum SetVar_ModifyTypes {
 	modNot,          /// Bitwise NOT
 };
 
+/**
+**  Integer argument of an animation script step.
+**
+**  The textual argument ("v.HitPoints.Value", "r.2.5", "p.this.Resources.gold",
+**  "12", ...) is parsed once when the animation is defined, so running the
+**  step only has to evaluate it.
+**  Variable, bool flag and spell names are looked up at definition time when
+**  they are already known, else the first time the argument is evaluated.
+*/
+class CAnimIntArg
+{
+public:
+	CAnimIntArg() : Kind(AnimArgConstant), OnGoal(false), Value(0), Index(-1),
+		Component(AnimArgNone), Max(0), Spell(NULL), PlayerArg(NULL) {}
+	CAnimIntArg(const CAnimIntArg &rhs);
+	~CAnimIntArg() { delete PlayerArg; }
+	CAnimIntArg &operator=(const CAnimIntArg &rhs);
+
+	/// Parse the textual argument
+	void Parse(const char *s);
+	/// Evaluate the argument for unit
+	int Eval(const CUnit &unit) const;
+
+	/// Is the argument a plain number ?
+	bool IsConstant() const { return Kind == AnimArgConstant; }
+	/// The value of a plain number (0 for other arguments)
+	int GetConstant() const { return IsConstant() ? Value : 0; }
+
+private:
+	enum Kinds {
+		AnimArgConstant,       /// plain number
+		AnimArgVariable,       /// "v.Var.Component", "t.Var.Component"
+		AnimArgResourcesHeld,  /// "v.ResourcesHeld.*"
+		AnimArgResourceActive, /// "v.ResourceActive.*"
+		AnimArgDistance,       /// "v._Distance.*"
+		AnimArgBoolFlag,       /// "b.Flag", "g.Flag"
+		AnimArgSpell,          /// "s.Spell"
+		AnimArgAutoCast,       /// "S.Spell"
+		AnimArgPlayerVar,      /// "p.Player.Prop.Arg", "p(Player).Prop.Arg"
+		AnimArgRandom,         /// "r.Max", "r.Min.Max"
+		AnimArgThisPlayer      /// "l.this", "p.this.*"
+	};
+	enum Components {
+		AnimArgNone,           /// unknown component, always 0
+		AnimArgValue,
+		AnimArgMax,
+		AnimArgIncrease,
+		AnimArgEnable,
+		AnimArgPercent
+	};
+
+	void ParsePlayer(const char *s);
+	void Resolve() const;
+
+private:
+	Kinds Kind;
+	bool OnGoal;                    /// Use the goal of the current order
+	int Value;                      /// Constant value, or random minimum
+	mutable int Index;              /// Variable or bool flag index, -1 if not looked up
+	Components Component;           /// Component of the variable
+	int Max;                        /// Random maximum
+	mutable const SpellType *Spell; /// Spell, NULL if not looked up
+	std::string Name;               /// Variable, bool flag or spell name
+	std::string PlayerProp;         /// Player property
+	std::string PlayerPropArg;      /// Argument of the player property
+	CAnimIntArg *PlayerArg;         /// Player of AnimArgPlayerVar
+};
+
 class CAnimation
 {
 public:
@@ -173,8 +242,7 @@ extern int UnitShowAnimationScaled(CUnit &unit, const CAnimation *anim, int scal
 extern int UnitShowAnimation(CUnit &unit, const CAnimation *anim);
 
 
-extern int ParseAnimInt(const CUnit &unit, const char *parseint);
-extern int ParseAnimFlags(const CUnit &unit, const char *parseflag);
+extern int ParseAnimFlags(AnimationType type, const char *parseflag);
 
 extern void FindLabelLater(CAnimation **anim, const std::string &name);
 
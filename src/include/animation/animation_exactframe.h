@@ -46,7 +46,7 @@ public:
 	int ParseAnimInt(const CUnit *unit) const;
 
 private:
-	std::string frame;
+	CAnimIntArg frame;
 };
 
 //@}
@@ -44,7 +44,7 @@ public:
 	virtual void Init(const char *s, lua_State *l);
 
 private:
-	std::string randomStr;
+	CAnimIntArg randomArg;
 	CAnimation *gotoLabel;
 };
 
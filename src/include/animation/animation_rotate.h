@@ -38,13 +38,14 @@
 class CAnimation_Rotate : public CAnimation
 {
 public:
-	CAnimation_Rotate() : CAnimation(AnimationRotate) {}
+	CAnimation_Rotate() : CAnimation(AnimationRotate), rotateToTarget(false) {}
 
 	virtual void Action(CUnit &unit, int &move, int scale) const;
 	virtual void Init(const char *s, lua_State *l);
 
 private:
-	std::string rotateStr;
+	bool rotateToTarget; /// Rotate toward the goal of the order ("target")
+	CAnimIntArg rotateArg;
 };
 
 extern void UnitRotate(CUnit &unit, int rotate);
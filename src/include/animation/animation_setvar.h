@@ -38,16 +38,30 @@
 class CAnimation_SetVar : public CAnimation
 {
 public:
-	CAnimation_SetVar() : CAnimation(AnimationSetVar) {}
+	CAnimation_SetVar() : CAnimation(AnimationSetVar), index(-1), component(VarNone),
+		unitSlot('\0') {}
 
 	virtual void Action(CUnit &unit, int &move, int scale) const;
 	virtual void Init(const char *s, lua_State *l);
 
 private:
+	enum Components {
+		VarNone,
+		VarValue,
+		VarMax,
+		VarIncrease,
+		VarEnable,
+		VarPercent,
+		VarDamageType   /// Not a CVariable: DamageType of the unit type
+	};
+
 	SetVar_ModifyTypes mod;
-	std::string varStr;
-	std::string valueStr;
-	std::string unitSlotStr;
+	std::string varName;          /// Name of the variable
+	mutable int index;            /// Index of the variable, -1 if not looked up yet
+	Components component;         /// Component of the variable to modify
+	std::string valueStr;         /// Value as written (for DamageType)
+	CAnimIntArg valueArg;         /// Value to apply
+	char unitSlot;                /// Unit to modify, '\0', 'l', 't' or 's'
 };
 
 //@}
@@ -50,19 +50,19 @@ enum SpawnMissile_Flags {
 class CAnimation_SpawnMissile : public CAnimation
 {
 public:
-	CAnimation_SpawnMissile() : CAnimation(AnimationSpawnMissile) {}
+	CAnimation_SpawnMissile() : CAnimation(AnimationSpawnMissile), flags(0) {}
 
 	virtual void Action(CUnit &unit, int &move, int scale) const;
 	virtual void Init(const char *s, lua_State *l);
 
 private:
 	std::string missileTypeStr;
-	std::string startXStr;
-	std::string startYStr;
-	std::string destXStr;
-	std::string destYStr;
-	std::string flagsStr;
-	std::string offsetNumStr;
+	CAnimIntArg startX;
+	CAnimIntArg startY;
+	CAnimIntArg destX;
+	CAnimIntArg destY;
+	int flags;
+	CAnimIntArg offsetNum;
 };
 
 //@}
@@ -0,0 +1,304 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name astar_openset.h - The a* open set headerfile. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#ifndef __ASTAR_OPENSET_H__
+#define __ASTAR_OPENSET_H__
+
+//@{
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+/**
+**  An entry of the a* open set.
+**
+**  Ties on Costs are broken by the estimated cost to goal and then by
+**  the manhattan distance to goal.
+*/
+struct AStarOpenNode {
+	int Costs;       /// complete costs to goal
+	int CostToGoal;  /// estimated cost to goal
+	int Dist;        /// manhattan distance to goal
+	int O;           /// Offset into matrix
+
+	bool IsBetterThan(const AStarOpenNode &rhs) const
+	{
+		if (Costs != rhs.Costs) {
+			return Costs < rhs.Costs;
+		}
+		if (CostToGoal != rhs.CostToGoal) {
+			return CostToGoal < rhs.CostToGoal;
+		}
+		return Dist < rhs.Dist;
+	}
+};
+
+/**
+**  The a* open set, kept as an array sorted from the highest cost to
+**  the lowest one, so the best node is the last one.
+**
+**  Inserting a node is a binary search and a memmove, finding a node is
+**  a linear scan. Both are cheap while the open set is small, which is
+**  the common case. A node is never twice in the array, so a capacity of
+**  width * height is always enough.
+*/
+class AStarSortedOpenSet
+{
+public:
+	AStarSortedOpenSet() : Nodes(NULL), Size(0), Capacity(0) {}
+	~AStarSortedOpenSet() { delete[] Nodes; }
+
+	void Init(int capacity)
+	{
+		delete[] Nodes;
+		Nodes = new AStarOpenNode[capacity];
+		Capacity = capacity;
+		Size = 0;
+	}
+
+	void Free()
+	{
+		delete[] Nodes;
+		Nodes = NULL;
+		Capacity = 0;
+		Size = 0;
+	}
+
+	/// Forget all the nodes
+	void Clear() { Size = 0; }
+
+	bool Empty() const { return Size == 0; }
+	int GetSize() const { return Size; }
+	const AStarOpenNode &operator[](int i) const { return Nodes[i]; }
+
+	/// Return the node with the smallest cost
+	const AStarOpenNode &Top() const
+	{
+		Assert(Size > 0);
+		return Nodes[Size - 1];
+	}
+
+	/// Return the position of the matrix offset o, or -1
+	int Find(int o) const
+	{
+		for (int i = 0; i < Size; ++i) {
+			if (Nodes[i].O == o) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	void Push(const AStarOpenNode &node)
+	{
+		Assert(Size < Capacity);
+		// The nodes worse than node stay before it, the others after it.
+		int low = 0;
+		int high = Size;
+		while (low < high) {
+			const int middle = (low + high) >> 1;
+			if (node.IsBetterThan(Nodes[middle])) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+		memmove(&Nodes[low + 1], &Nodes[low], (Size - low) * sizeof(AStarOpenNode));
+		Nodes[low] = node;
+		++Size;
+	}
+
+	void Pop()
+	{
+		Assert(Size > 0);
+		--Size;
+	}
+
+	/**
+	**  Replace the node at position pos by node, which has
+	**  the same offset and a cost not greater than the old one.
+	*/
+	void Decrease(int pos, const AStarOpenNode &node)
+	{
+		Assert(0 <= pos && pos < Size);
+		Assert(Nodes[pos].O == node.O);
+		--Size;
+		memmove(&Nodes[pos], &Nodes[pos + 1], (Size - pos) * sizeof(AStarOpenNode));
+		Push(node);
+	}
+
+private:
+	AStarOpenNode *Nodes;  /// nodes, the best one last
+	int Size;              /// number of nodes in the array
+	int Capacity;          /// allocated size of Nodes
+};
+
+/**
+**  The a* open set, kept as a binary min-heap.
+**
+**  Each node of the matrix remembers where it lives in the heap through
+**  IndexOf(o), which returns a reference to an int owned by the caller:
+**  0 means "not in the open set", n means "at heap position n - 1".
+**  This way finding a node and decreasing its cost are O(log n).
+**
+**  The heap never holds a matrix offset twice, so a capacity of
+**  width * height is always enough.
+*/
+template <typename IndexOf>
+class AStarOpenSet
+{
+public:
+	explicit AStarOpenSet(const IndexOf &indexOf) :
+		Nodes(NULL), Size(0), Capacity(0), IndexOfNode(indexOf)
+	{}
+	~AStarOpenSet() { delete[] Nodes; }
+
+	void Init(int capacity)
+	{
+		delete[] Nodes;
+		Nodes = new AStarOpenNode[capacity];
+		Capacity = capacity;
+		Size = 0;
+	}
+
+	void Free()
+	{
+		delete[] Nodes;
+		Nodes = NULL;
+		Capacity = 0;
+		Size = 0;
+	}
+
+	/// Forget all the nodes, also resetting their index
+	void Clear()
+	{
+		for (int i = 0; i < Size; ++i) {
+			IndexOfNode(Nodes[i].O) = 0;
+		}
+		Size = 0;
+	}
+
+	bool Empty() const { return Size == 0; }
+	int GetSize() const { return Size; }
+	const AStarOpenNode &operator[](int i) const { return Nodes[i]; }
+
+	/// Return the node with the smallest cost
+	const AStarOpenNode &Top() const
+	{
+		Assert(Size > 0);
+		return Nodes[0];
+	}
+
+	/// Return the heap position of the matrix offset o, or -1
+	int Find(int o) const { return IndexOfNode(o) - 1; }
+
+	void Push(const AStarOpenNode &node)
+	{
+		Assert(Size < Capacity);
+		Assert(IndexOfNode(node.O) == 0);
+		SiftUp(Size++, node);
+	}
+
+	void Pop()
+	{
+		Assert(Size > 0);
+		IndexOfNode(Nodes[0].O) = 0;
+		if (--Size > 0) {
+			SiftDown(0, Nodes[Size]);
+		}
+	}
+
+	/**
+	**  Replace the node at heap position pos by node, which has
+	**  the same offset and a cost not greater than the old one.
+	*/
+	void Decrease(int pos, const AStarOpenNode &node)
+	{
+		Assert(0 <= pos && pos < Size);
+		Assert(Nodes[pos].O == node.O);
+		Assert(!Nodes[pos].IsBetterThan(node));
+		SiftUp(pos, node);
+	}
+
+private:
+	void Place(int pos, const AStarOpenNode &node)
+	{
+		Nodes[pos] = node;
+		IndexOfNode(node.O) = pos + 1;
+	}
+
+	void SiftUp(int pos, const AStarOpenNode &node)
+	{
+		while (pos > 0) {
+			const int parent = (pos - 1) >> 1;
+			if (!node.IsBetterThan(Nodes[parent])) {
+				break;
+			}
+			Place(pos, Nodes[parent]);
+			pos = parent;
+		}
+		Place(pos, node);
+	}
+
+	void SiftDown(int pos, const AStarOpenNode &node)
+	{
+		for (;;) {
+			int child = 2 * pos + 1;
+			if (child >= Size) {
+				break;
+			}
+			if (child + 1 < Size && Nodes[child + 1].IsBetterThan(Nodes[child])) {
+				++child;
+			}
+			if (!Nodes[child].IsBetterThan(node)) {
+				break;
+			}
+			Place(pos, Nodes[child]);
+			pos = child;
+		}
+		Place(pos, node);
+	}
+
+private:
+	AStarOpenNode *Nodes;  /// heap storage
+	int Size;              /// number of nodes in the heap
+	int Capacity;          /// allocated size of Nodes
+	IndexOf IndexOfNode;   /// access to the per node heap position
+};
+
+//@}
+
+#endif // !__ASTAR_OPENSET_H__
@@ -34,7 +34,12 @@
 class CFile;
 
 extern void LoadGame(const std::string &filename); /// Load saved game
+extern void LoadGameFromMemory(const std::string &data); /// Load game saved in memory
 extern int SaveGame(const std::string &filename); /// Save game
+extern void SaveGameToMemory(std::string &data); /// Save game in memory
+extern int SaveGameInBackground(const std::string &filename); /// Save game without blocking on the disk
+extern void WaitForSaveGame();               /// Wait for the background save to be written
+extern unsigned int SaveGameBlockedTicks;    /// Game thread time of the last background save
 extern void DeleteSaveGame(const std::string &filename); /// Delete save game
 extern bool SaveGameLoading;                 /// Save game is in progress of loading
 
@@ -109,8 +109,10 @@ public:
 	int close();
 	void flush();
 	int read(void *buf, size_t len);
+	int write(const void *buf, size_t len);
 	int seek(long offset, int whence);
 	long tell();
+	void takeMemory(std::string &data);
 	SDL_RWops * as_SDL_RWops();
 
 	int printf(const char *format, ...) PRINTF_VAARG_ATTRIBUTE(2, 3); // Don't forget to count this
@@ -126,13 +128,15 @@ enum {
 	CLF_TYPE_INVALID,  /// invalid file handle
 	CLF_TYPE_PLAIN,    /// plain text file handle
 	CLF_TYPE_GZIP,     /// gzip file handle
-	CLF_TYPE_BZIP2     /// bzip2 file handle
+	CLF_TYPE_BZIP2,    /// bzip2 file handle
+	CLF_TYPE_MEMORY    /// memory buffer handle
 };
 
 #define CL_OPEN_READ 0x1
 #define CL_OPEN_WRITE 0x2
 #define CL_WRITE_GZ 0x4
 #define CL_WRITE_BZ2 0x8
+#define CL_WRITE_MEMORY 0x10
 
 /*----------------------------------------------------------------------------
 --  Functions
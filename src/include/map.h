@@ -52,6 +52,12 @@
 **    An array CMap::Info::Width * CMap::Info::Height of all fields
 **    belonging to this map.
 **
+**  CMap::UnitBuckets
+**
+**    The units on the map, grouped by squares of UnitBucketSize tiles.
+**    A unit is only in the bucket of its top left tile, so range
+**    queries over big areas see each unit once, see SelectFixed().
+**
 **  CMap::NoFogOfWar
 **
 **    Flag if true, the fog of war is disabled.
@@ -109,6 +115,9 @@ class CUnitType;
 #define MaxMapWidth  256  /// max map width supported
 #define MaxMapHeight 256  /// max map height supported
 
+#define UnitBucketShift 3                     /// log2 of UnitBucketSize
+#define UnitBucketSize  (1 << UnitBucketShift) /// side of a unit bucket, in tiles
+
 /*----------------------------------------------------------------------------
 --  Map info structure
 ----------------------------------------------------------------------------*/
@@ -175,6 +184,12 @@ public:
 		return Field(pos.x, pos.y);
 	}
 
+	/// Get the bucket of units whose top left tile is in bucket (bx, by)
+	const CUnitCache &UnitBucket(int bx, int by) const
+	{
+		return this->UnitBuckets[bx + by * this->UnitBucketsWidth];
+	}
+
 	/// Alocate and initialise map table.
 	void Create();
 	/// Build tables for map
@@ -199,6 +214,13 @@ public:
 	/// Mark a tile as seen by the player.
 	void MarkSeenTile(CMapField &mf);
 
+	/// Check if a field for the user is explored.
+	bool IsFieldExplored(const CPlayer &player, unsigned int index) const;
+	/// @note Manage Map.NoFogOfWar
+	bool IsFieldVisible(const CPlayer &player, unsigned int index) const;
+	/// Find out how a field is seen (0 unexplored, 1 explored, 2 visible).
+	unsigned char FieldTeamVisibilityState(const CPlayer &player, unsigned int index) const;
+
 	/// Regenerate the forest.
 	void RegenerateForest();
 	/// Reveal the complete map, make everything known.
@@ -231,6 +253,9 @@ public:
 	/// Remove unit from cache
 	void Remove(CUnit &unit);
 
+	/// Biggest width or height of the units inserted in the cache
+	int GetMaxUnitTileSize() const { return MaxUnitTileSize; }
+
 	void Clamp(Vec2i &pos) const;
 
 	//Warning: we expect typical usage as xmin = x - range
@@ -255,8 +280,25 @@ private:
 	/// Regenerate the forest.
 	void RegenerateForestTile(const Vec2i &pos);
 
+	/// Bucket of units of the tile pos
+	CUnitCache &UnitBucket(const Vec2i &pos)
+	{
+		return this->UnitBuckets[(pos.x >> UnitBucketShift) + (pos.y >> UnitBucketShift) * this->UnitBucketsWidth];
+	}
+
 public:
 	CMapField *Fields;              /// fields on map
+	/// Seen counters, 0 the field is not explored, 1 explored, n-1 units see it
+	CMapPlayerPlanes<unsigned short> Visible;
+	CMapPlayerPlanes<unsigned char> VisCloak;    /// Visiblity for cloaking.
+	/// Players which see each field, bit p is set when Visible of p is 2 or more
+	std::vector<unsigned int> SightMask;
+	/// Players which detect cloaked units on each field, bit p is set when VisCloak of p is not 0
+	std::vector<unsigned int> CloakMask;
+	CMapPlayerPlanes<unsigned char> Radar;       /// Visiblity for radar.
+	CMapPlayerPlanes<unsigned char> RadarJammer; /// Jamming capabilities.
+	std::vector<CUnitCache> UnitBuckets; /// units on map, by bucket of their top left tile
+	int UnitBucketsWidth;      /// number of buckets in a row
 	bool NoFogOfWar;           /// fog of war disabled
 
 	CTileset *Tileset;          /// tileset data
@@ -265,6 +307,9 @@ public:
 	static CGraphic *FogGraphic;      /// graphic for fog of war
 
 	CMapInfo Info;             /// descriptive information
+
+private:
+	int MaxUnitTileSize;       /// biggest unit in the buckets, to know how far to look
 };
 
 
@@ -299,6 +344,8 @@ typedef void MapMarkerFunc(const CPlayer &player, const Vec2i &pos);
 #else
 typedef void MapMarkerFunc(const CPlayer &player, const unsigned int index);
 #endif
+/// Function to (un)mark the vision table for count tiles of a row.
+typedef void MapSpanMarkerFunc(const CPlayer &player, const unsigned int index, int count);
 
 /// Filter map flags through fog
 extern int MapFogFilterFlags(CPlayer &player, const Vec2i &pos, int mask);
@@ -311,10 +358,25 @@ extern MapMarkerFunc MapUnmarkTileSight;
 extern MapMarkerFunc MapMarkTileDetectCloak;
 /// Unmark a tile for cloak detection
 extern MapMarkerFunc MapUnmarkTileDetectCloak;
+/// Mark a row of tiles for normal sight
+extern MapSpanMarkerFunc MapMarkSpanSight;
+/// Unmark a row of tiles for normal sight
+extern MapSpanMarkerFunc MapUnmarkSpanSight;
+/// Mark a row of tiles for cloak detection
+extern MapSpanMarkerFunc MapMarkSpanDetectCloak;
+/// Unmark a row of tiles for cloak detection
+extern MapSpanMarkerFunc MapUnmarkSpanDetectCloak;
 
 /// Mark sight changes
 extern void MapSight(const CPlayer &player, const Vec2i &pos, int w,
 					 int h, int range, MapMarkerFunc *marker);
+extern void MapSight(const CPlayer &player, const Vec2i &pos, int w,
+					 int h, int range, MapSpanMarkerFunc *marker);
+/// Mark sight changes of a sight moving from oldPos to newPos
+extern void MapSightMove(const CPlayer &player, const Vec2i &oldPos, const Vec2i &newPos,
+						 int w, int h, int range, MapMarkerFunc *marker, MapMarkerFunc *unmarker);
+extern void MapSightMove(const CPlayer &player, const Vec2i &oldPos, const Vec2i &newPos,
+						 int w, int h, int range, MapSpanMarkerFunc *marker, MapSpanMarkerFunc *unmarker);
 /// Update fog of war
 extern void UpdateFogOfWarChange();
 
@@ -385,6 +447,8 @@ extern void PreprocessMap();
 void MapMarkUnitSight(CUnit &unit);
 /// Unmark on vision table the Sight of the unit.
 void MapUnmarkUnitSight(CUnit &unit);
+/// Update on vision table the Sight of the unit moved from oldPos.
+void MapMoveUnitSight(CUnit &unit, const Vec2i &oldPos);
 
 /*----------------------------------------------------------------------------
 --  Defines
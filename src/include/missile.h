@@ -617,6 +617,8 @@ extern MissileType *MissileBurningBuilding(int percent);
 
 /// Save missiles
 extern void SaveMissiles(CFile &file);
+/// Write the global missiles one per line, to compare them between computers
+extern void DumpGlobalMissiles(CFile &file);
 
 /// Initialize missile-types
 extern void InitMissileTypes();
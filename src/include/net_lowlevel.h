@@ -123,6 +123,10 @@ extern void NetCloseUDP(Socket sockfd);
 extern int NetSendUDP(Socket sockfd, unsigned long host, int port, const void *buf, int len);
 /// Receive from a UDP socket.
 extern int NetRecvUDP(Socket sockfd, void *buf, int len, unsigned long *hostFrom, int *portFrom);
+/// Send the same message through a UDP socket to many hosts.
+extern int NetSendUDPBatch(Socket sockfd, const unsigned long *hosts, const int *ports, int count, const void *buf, int len);
+/// Receive all waiting messages from a UDP socket.
+extern int NetRecvUDPBatch(Socket sockfd, unsigned char *bufs, int len, int maxCount, int *lens, unsigned long *hostsFrom, int *portsFrom);
 
 
 /// Open a TCP Socket port.
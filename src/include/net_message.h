@@ -45,6 +45,8 @@
 #define NetPlayerNameSize 16
 
 #define MaxNetworkCommands 9  /// Max Commands In A Packet
+#define MaxNetworkRedundancy 2  /// Max older packets repeated in a packet
+#define MaxNetworkRelaySize 1024  /// Max size of an observer relay entry
 
 /**
 **  Network systems active in current game.
@@ -160,7 +162,7 @@ private:
 	CInitMessage_Header header;
 public:
 	char PlyName[NetPlayerNameSize];  /// Name of player
-	int32_t Stratagus;  /// Stratagus engine version
+	int32_t Stratagus;  /// Network protocol version
 	uint32_t Version;   /// Lua files version
 };
 
@@ -191,7 +193,7 @@ public:
 private:
 	CInitMessage_Header header;
 public:
-	int32_t Stratagus;  /// Stratagus engine version
+	int32_t Stratagus;  /// Network protocol version
 };
 
 class CInitMessage_LuaFilesMismatch
@@ -278,6 +280,7 @@ enum _message_type_ {
 	MessageNone,                   /// When Nothing Is Happening
 	MessageInit_FromClient,        /// Start connection
 	MessageInit_FromServer,        /// Connection reply
+	MessageRelay,                  /// Observer relay stream
 
 	MessageSync,                   /// Heart beat
 	MessageSelection,              /// Update a Selection from Team Player
@@ -322,7 +325,8 @@ enum _message_type_ {
 */
 enum _extended_message_type_ {
 	ExtendedMessageDiplomacy,     /// Change diplomacy
-	ExtendedMessageSharedVision   /// Change shared vision
+	ExtendedMessageSharedVision,  /// Change shared vision
+	ExtendedMessageNetworkLag     /// Change network lag and update interval
 };
 
 /**
@@ -384,14 +388,22 @@ public:
 class CNetworkCommandSync
 {
 public:
-	CNetworkCommandSync() : syncSeed(0), syncHash(0) {}
+	CNetworkCommandSync() :
+		syncSeed(0), syncHash(0), unitHash(0), missileHash(0), playerHash(0),
+		sendTicks(0), echoTicks(0)
+	{}
 	size_t Serialize(unsigned char *buf) const;
 	size_t Deserialize(const unsigned char *buf);
-	static size_t Size() { return 4 + 4; };
+	static size_t Size() { return 4 + 4 + 4 + 4 + 4 + 4 + 4; };
 
 public:
 	uint32_t syncSeed;
 	uint32_t syncHash;
+	uint32_t unitHash;     /// hash of the units only
+	uint32_t missileHash;  /// hash of the missiles only
+	uint32_t playerHash;   /// hash of the players only
+	uint32_t sendTicks;    /// ticks of the sender when sent
+	uint32_t echoTicks;    /// ticks of the server echoed by a client, 0 if none
 };
 
 /**
@@ -426,6 +438,93 @@ public:
 	std::vector<uint16_t> Units;  /// Selection Units
 };
 
+/**
+**  Observer relay message subtypes.
+*/
+enum _relay_message_subtype_ {
+	RelayMessageSetup,  /// Game setup, first entry of the stream
+	RelayMessageCycle,  /// Commands of a game cycle
+	RelayMessageAck     /// Next entry wanted by the receiver
+};
+
+/**
+**  Observer relay message header.
+**
+**  The relay stream is a sequence of entries, numbered by Seq.
+**  An ack carries in Seq the number of entries the receiver has.
+*/
+class CNetworkRelayHeader
+{
+public:
+	CNetworkRelayHeader() : Subtype(RelayMessageAck), Seq(0), Cycle(0) {}
+
+	size_t Serialize(unsigned char *buf) const;
+	size_t Deserialize(const unsigned char *buf);
+	static size_t Size() { return 1 + 1 + 4 + 4; }
+
+	uint8_t Subtype;  /// Relay message subtype
+	uint32_t Seq;     /// Index of the entry in the stream
+	uint32_t Cycle;   /// Game cycle of the entry
+};
+
+/**
+**  Observer relay game setup, what a client gets from the server to start.
+**
+**  The host addresses are not sent, only the player numbers and names.
+*/
+class CNetworkRelaySetup
+{
+public:
+	CNetworkRelaySetup();
+
+	size_t Serialize(unsigned char *buf) const;
+	size_t Deserialize(const unsigned char *buf);
+	static size_t Size() { return CNetworkRelayHeader::Size() + 4 + 256 + 4 + CServerSetup::Size() + 1 + PlayerMax * CNetworkHost::Size(); }
+
+	CNetworkRelayHeader Header;     /// Relay header
+	uint32_t Game;                  /// Differs for each game of the server, even with the same setup
+	char MapPath[256];              /// Map to play
+	uint32_t MapUID;                /// UID of the map
+	CServerSetup State;             /// Server setup state
+	uint8_t hostsCount;             /// Number of hosts, server is last
+	CNetworkHost hosts[PlayerMax];  /// Participant information
+};
+
+/**
+**  Command of a player in an observer relay cycle.
+*/
+class CNetworkRelayCommand
+{
+public:
+	CNetworkRelayCommand() : Player(0), Type(MessageNone) {}
+
+	uint8_t Player;                  /// Player who sent the command
+	uint8_t Type;                    /// Network message type
+	std::vector<unsigned char> Data; /// Serialized command
+};
+
+/**
+**  Observer relay cycle: the commands executed in a game cycle, in the
+**  order of execution. The commands of a cycle may be split over several
+**  entries, all but the last have More set.
+*/
+class CNetworkRelayCycle
+{
+public:
+	CNetworkRelayCycle() : More(0) { Header.Subtype = RelayMessageCycle; }
+
+	size_t Serialize(unsigned char *buf) const;
+	/// Return the bytes read, 0 if the message is bad
+	size_t Deserialize(const unsigned char *buf, unsigned int len);
+	size_t Size() const;
+	/// Size of the command once serialized
+	static size_t CommandSize(const CNetworkRelayCommand &command);
+
+	CNetworkRelayHeader Header;  /// Relay header
+	uint8_t More;                /// More entries follow for this cycle
+	std::vector<CNetworkRelayCommand> Commands;  /// Commands to execute
+};
+
 /**
 **  Network packet header.
 **
@@ -454,16 +553,37 @@ public:
 **  Network packet.
 **
 **  This is sent over the network.
+**
+**  The packet also repeats the commands of the previous packets of the
+**  sender, so that a lost packet can be filled in without a resend.
+**  Each repeated command is delta encoded against the command at the same
+**  index of the newer packet.
 */
 class CNetworkPacket
 {
 public:
+	CNetworkPacket() : PreviousCount(0), EncodedCount(0) {}
+
 	size_t Serialize(unsigned char *buf, int numcommands) const;
 	void Deserialize(const unsigned char *buf, unsigned int len, int *numcommands);
 	size_t Size(int numcommands) const;
 
+	/// Encode the previous packets for Size and Serialize
+	void EncodePrevious(int numcommands);
+	/// Number of commands in a previous packet
+	int PreviousCommandCount(int index) const;
+
 	CNetworkPacketHeader Header;  /// Packet Header Info
 	std::vector<unsigned char> Command[MaxNetworkCommands];
+
+	int PreviousCount;  /// Number of repeated previous packets, newest first
+	CNetworkPacketHeader PreviousHeader[MaxNetworkRedundancy];  /// Headers of previous packets
+	std::vector<unsigned char> PreviousCommand[MaxNetworkRedundancy][MaxNetworkCommands];  /// Commands of previous packets
+
+private:
+	int EncodedCount;                             /// Number of previous packets encoded
+	std::vector<unsigned char> EncodedPrevious;   /// Previous packets as sent, without their count
+	size_t EncodedEnd[MaxNetworkRedundancy];      /// End of each previous packet in EncodedPrevious
 };
 
 //@}
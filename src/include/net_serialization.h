@@ -48,6 +48,6 @@ extern size_t deserialize8(const unsigned char *buf, int8_t *data);
 template <int N>
 extern size_t deserialize(const unsigned char *buf, char(&data)[N]);
 extern size_t deserialize(const unsigned char *buf, std::string &s);
-extern size_t deserialize(const unsigned char *buf, std::vector<unsigned char> &data);
+extern size_t deserialize(const unsigned char *buf, const unsigned char *end, std::vector<unsigned char> &data);
 
 #endif
@@ -43,8 +43,8 @@ class CHost;
 #define NetworkProtocolMajorVersion StratagusMajorVersion
 /// Network protocol minor version (maximum 99)
 #define NetworkProtocolMinorVersion StratagusMinorVersion
-/// Network protocol patch level (maximum 99)
-#define NetworkProtocolPatchLevel   StratagusPatchLevel
+/// Network protocol patch level (maximum 99), raised each time the game messages change
+#define NetworkProtocolPatchLevel   1
 /// Network protocol version (1,2,3) -> 10203
 #define NetworkProtocolVersion \
 	(NetworkProtocolMajorVersion * 10000 + NetworkProtocolMinorVersion * 100 + \
@@ -118,6 +118,8 @@ extern void NetworkProcessClientRequest();  /// Menu Loop: Send out client reque
 extern void NetworkProcessServerRequest();  /// Menu Loop: Send out server request messages
 extern void NetworkServerResyncClients();   /// Menu Loop: Server: Mark clients state to send stateinfo message
 extern void NetworkDetachFromServer();      /// Menu Loop: Client: Send GoodBye to the server and detach
+extern void NetworkFillRelaySetup(CNetworkRelaySetup &setup);  /// Server: Game setup for the observer relay
+extern bool NetworkSetupObserverGame(const CNetworkRelaySetup &setup);  /// Observer: Setup the game from the relay
 
 //@}
 
@@ -55,9 +55,11 @@ public:
 	unsigned int gameCyclesPerUpdate;  /// Network update each # game cycles
 	unsigned int NetworkLag;      /// Network lag (# update cycles)
 	unsigned int timeoutInS;      /// Number of seconds until player times out
+	bool adaptiveLag;             /// Server adapts lag and update interval to the round trip times
 
 public:
 	static const int defaultPort = 6660; /// Default communication port
+	static const int defaultRelayPort = 6661; /// Default observer relay port
 public:
 	static CNetworkParameter Instance;
 };
@@ -91,6 +93,12 @@ extern void NetworkSendExtendedCommand(int command, int arg1, int arg2,
 									   int arg3, int arg4, int status);
 /// Send Selections to Team
 extern void NetworkSendSelection(CUnit **units, int count);
+/// Server: send the game to an observer relay
+extern int NetworkSetupRelayAddress(const std::string &relayaddr, int port);
+/// Observe a game through an observer relay
+extern int NetworkObserve(const std::string &relayaddr, int port);
+/// Observer: the game setup has been received
+extern bool NetworkObserverReady();
 
 extern void NetworkCclRegister();
 
@@ -0,0 +1,148 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name netrelay.h - The observer relay headerfile. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+
+#ifndef NETRELAY_H
+#define NETRELAY_H
+
+#include "network/netsockets.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//@{
+
+/**
+**  The entries of an observer relay stream, kept as sent.
+**
+**  Entry 0 is the game setup, each other entry holds the commands of a
+**  game cycle. Entries are kept until the end of the game, so that late
+**  observers get the whole game and lost entries can be sent again.
+*/
+class CNetworkRelayStream
+{
+public:
+	void Clear();
+	/// Append the serialized entry of the game cycle
+	void Add(const unsigned char *buf, unsigned int len, uint32_t cycle);
+	/// Is the entry seq the same as the serialized entry
+	bool IsSameEntry(uint32_t seq, const unsigned char *buf, unsigned int len) const;
+
+	uint32_t GetSize() const { return Cycles.size(); }
+	uint32_t GetCycle(uint32_t seq) const { return Cycles[seq]; }
+	const std::vector<unsigned char> &GetEntry(uint32_t seq) const { return Entries[seq]; }
+
+private:
+	std::vector<std::vector<unsigned char> > Entries;  /// Serialized entries
+	std::vector<uint32_t> Cycles;                      /// Game cycle of each entry
+};
+
+/**
+**  Receiver of an observer relay stream: the relay for the server,
+**  an observer for the relay.
+**
+**  Entries are sent in order, a window at a time. The receiver acks the
+**  number of entries it has, when it stops doing so the unacked entries
+**  are sent again.
+*/
+class CNetworkRelayPeer
+{
+public:
+	CNetworkRelayPeer() : Acked(0), Sent(0), LastAckTicks(0), LastProgressTicks(0) {}
+	CNetworkRelayPeer(const CHost &host, unsigned long ticks);
+
+	/// Note that the peer has the first next entries
+	void Ack(uint32_t next, unsigned long ticks);
+	/// Go back to the first unacked entry if the acks stopped
+	void CheckResend(unsigned long ticks);
+	/// Can the next entry be sent, with end entries available
+	bool CanSend(uint32_t end) const;
+	/// Send the entries before end which are due
+	void Send(CUDPSocket &socket, const CNetworkRelayStream &stream, uint32_t end, unsigned long ticks);
+	/// Has the peer not acked for too long
+	bool IsTimedOut(unsigned long ticks) const;
+
+	CHost Host;                       /// Address of the peer
+	uint32_t Acked;                   /// Number of entries the peer has
+	uint32_t Sent;                    /// Number of entries sent to the peer
+	unsigned long LastAckTicks;       /// Ticks of the last ack
+	unsigned long LastProgressTicks;  /// Ticks of the last new ack or resend
+};
+
+/**
+**  Observer relay.
+**
+**  Receives the stream of the server and sends it to any number of
+**  observers, held back by a delay. The server sends each entry once,
+**  whatever the number of observers, and the observers are not hosts
+**  of the game. Observers subscribe by acking the entries they have.
+**
+**  Only the server given to Open may send the stream. When it starts a
+**  new game, its new setup replaces the stream of the old game.
+*/
+class CNetworkRelay
+{
+public:
+	CNetworkRelay() : Delay(0), HasSource(false), SourceHeard(false), Released(0) {}
+
+	bool Open(const CHost &host, unsigned int delay, const CHost &source);
+	void Close();
+	bool IsValid() const { return Socket.IsValid(); }
+	int HasDataToRead(int timeout) { return Socket.HasDataToRead(timeout); }
+
+	/// Receive the waiting messages and send the entries due
+	void Update(unsigned long ticks);
+
+	const CNetworkRelayStream &GetStream() const { return Stream; }
+	/// Number of entries the observers may get
+	uint32_t GetReleased() const { return Released; }
+	int GetObserverCount() const { return Observers.size(); }
+
+private:
+	bool IsSource(const CHost &host) const;
+	void Parse(const unsigned char *buf, int len, const CHost &host, unsigned long ticks);
+	void SendEntries(unsigned long ticks);
+
+private:
+	CUDPSocket Socket;          /// Relay endpoint
+	unsigned int Delay;         /// Game cycles the observers are behind
+	CHost Source;               /// Server allowed to send the stream, port 0 for any port
+	CHost SourceHost;           /// Address the stream comes from, where acks go
+	bool HasSource;             /// SourceHost is known
+	bool SourceHeard;           /// Source sent something since the last ack
+	CNetworkRelayStream Stream; /// Entries received from the source
+	uint32_t Released;          /// Number of entries past the delay
+	std::vector<CNetworkRelayPeer> Observers;  /// Subscribed observers
+};
+
+/// Run a dedicated observer relay on port for the server source, never returns unless it fails
+extern int RunNetworkRelay(int port, unsigned int delay, const std::string &source);
+
+//@}
+
+#endif // !NETRELAY_H
@@ -63,6 +63,10 @@ public:
 	void Close();
 	void Send(const CHost &host, const void *buf, unsigned int len);
 	int Recv(void *buf, int len, CHost *hostFrom);
+	/// Send the same message to all the hosts
+	void SendBatch(const CHost *hosts, int count, const void *buf, unsigned int len);
+	/// Receive the waiting messages, maxCount buffers of len bytes each
+	int RecvBatch(unsigned char *bufs, int len, int maxCount, int *lens, CHost *hostsFrom);
 	void SetNonBlocking();
 	//
 	int HasDataToRead(int timeout);
@@ -86,6 +90,10 @@ public:
 		unsigned int receivedBytesExpectedCount;
 		unsigned int biggestSentPacketSize;
 		unsigned int biggestReceivedPacketSize;
+		unsigned int sentBatchCount;        /// Calls to SendBatch
+		unsigned int receivedBatchCount;    /// Calls to RecvBatch
+		unsigned int biggestSentBatchSize;      /// Most packets sent by one SendBatch
+		unsigned int biggestReceivedBatchSize;  /// Most packets received by one RecvBatch
 	};
 
 	void clearStatistic() { m_statistic.clear(); }
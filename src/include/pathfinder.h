@@ -76,6 +76,8 @@ public:
 	int GetMinRange() const { return minRange; }
 	int GetMaxRange() const { return maxRange; }
 	bool IsRecalculateNeeded() const { return isRecalculatePathNeeded; }
+	bool IsPathRequestDeferred() const { return isPathRequestDeferred; }
+	unsigned long GetDeferredCycle() const { return deferredCycle; }
 
 	void SetUnit(CUnit &_unit);
 	void SetGoal(const Vec2i &pos, const Vec2i &size);
@@ -83,6 +85,7 @@ public:
 	void SetMaxRange(int range);
 
 	void PathRacalculated();
+	void PathRequestDeferred(unsigned long cycle);
 
 	void Save(CFile &file) const;
 	void Load(lua_State *l);
@@ -95,6 +98,8 @@ private:
 	int minRange;
 	int maxRange;
 	bool isRecalculatePathNeeded;
+	bool isPathRequestDeferred;  /// no budget was left for the last path request
+	unsigned long deferredCycle; /// cycle the path request was first deferred
 };
 
 class PathFinderOutput
@@ -119,6 +124,53 @@ public:
 	PathFinderOutput output;
 };
 
+/**
+**  Share of the a* nodes budget of the game cycles between the path requests.
+**
+**  A request which can not be served is deferred and keeps the cycle it
+**  was first deferred. The requests deferred first are served first:
+**  while requests with the oldest deferred cycle still wait, the other
+**  requests only get the budget those may not use, guessed from the
+**  nodes the searches of the last cycle expanded. Some of them may never
+**  ask again (the unit died or got a new goal), so they can't hold the
+**  whole budget. Each cycle serves at least one of the oldest requests
+**  and new requests can not go before the waiting ones, so every request
+**  is served within a bounded number of cycles.
+*/
+class PathRequestBudget
+{
+public:
+	PathRequestBudget() : Budget(0), BudgetLeft(0), Cycle(0),
+		Oldest(0), OldestLeft(0), OldestServed(false), NextOldest(0), NextOldestCount(0),
+		SearchNodes(0), CycleNodes(0), CycleSearches(0) {}
+
+	/// Forget the deferred requests
+	void Reset(int budget, unsigned long cycle);
+	/// Start a game cycle with budget nodes to expand, 0 for no limit
+	void NewCycle(int budget, unsigned long cycle);
+	/// Can a request deferred since deferredCycle (the current cycle if new) search now
+	bool CanSearch(unsigned long deferredCycle) const;
+	/// Note that a request deferred since deferredCycle was served
+	void Served(unsigned long deferredCycle, int expandedNodes);
+	/// Note that a request deferred since deferredCycle is deferred again
+	void Deferred(unsigned long deferredCycle);
+
+	unsigned long GetCycle() const { return Cycle; }
+
+private:
+	int Budget;                    /// Nodes a cycle may expand
+	int BudgetLeft;                /// Nodes this cycle may still expand
+	unsigned long Cycle;           /// Current cycle
+	unsigned long Oldest;          /// Oldest deferred cycle of the requests waiting
+	int OldestLeft;                /// Requests of the oldest deferred cycle not served yet
+	bool OldestServed;             /// A request of the oldest deferred cycle was served this cycle
+	unsigned long NextOldest;      /// Oldest deferred cycle of the requests deferred in this cycle
+	int NextOldestCount;           /// Requests of NextOldest deferred in this cycle
+	int SearchNodes;               /// Nodes a search is expected to expand
+	int CycleNodes;                /// Nodes expanded by the searches of this cycle
+	int CycleSearches;             /// Searches of this cycle
+};
+
 
 //
 //  Terrain traversal stuff.
@@ -199,6 +251,10 @@ extern int AStarMovingUnitCrossingCost;
 extern bool AStarKnowUnseenTerrain;
 /// Cost of using a square we haven't seen before.
 extern int AStarUnknownTerrainCost;
+/// Whether long paths are planned on the cluster graph first
+extern bool HierarchicalPathfinding;
+/// Max number of a* nodes expanded by path requests in a game cycle, 0 for no limit
+extern int PathfinderCycleBudget;
 
 //
 //  Convert heading into direction.
@@ -215,6 +271,8 @@ extern const int XY2Heading[3][3];
 extern void InitPathfinder();
 /// Free the pathfinder
 extern void FreePathfinder();
+/// Start a new game cycle for the path requests
+extern void PathfinderNewCycle();
 
 /// Returns the next element of the path
 extern int NextPathElement(CUnit &unit, short int *xdp, short int *ydp);
@@ -226,6 +284,9 @@ extern int CalcPathLengthToUnit(const CUnit &src, const CUnit &dst,
 /// Can the unit 'src' reach the place x,y
 extern int PlaceReachable(const CUnit &src, const Vec2i &pos, int w, int h,
 						  int minrange, int maxrange);
+/// Find the step of a shared path where a unit at pos can join it
+extern int FindSharedPathJoin(const Vec2i &sharedStart, const char *sharedPath, int sharedLength,
+							  const Vec2i &pos, const Vec2i &goalPos, const Vec2i &goalSize, Vec2i &joinPos);
 
 //
 // in astar.cpp
@@ -243,6 +304,13 @@ extern int GetAStarUnknownTerrainCost();
 extern void SetAStarFixedEnemyUnitsUnpassable(const bool value);
 extern bool GetAStarFixedEnemyUnitsUnpassable();
 
+//
+// in hpastar.cpp
+//
+
+/// The terrain of an area has changed, the cluster graph must be updated
+extern void PathfinderTerrainChanged(const Vec2i &pos, int w, int h);
+
 extern void PathfinderCclRegister();
 
 //@}
@@ -391,6 +391,8 @@ extern PlayerRace PlayerRaces;  /// Player races
 */
 extern int PlayerColorIndexStart;
 extern int PlayerColorIndexCount;
+/// Changed each time the unit colors of the players change
+extern unsigned int PlayerColorsVersion;
 
 /*----------------------------------------------------------------------------
 --  Functions
@@ -68,8 +68,14 @@ extern void CommandLog(const char *action, const CUnit *unit, int flush,
 extern void SinglePlayerReplayEachCycle();
 /// Replay user commands from log each cycle, multiplayer games
 extern void MultiPlayerReplayEachCycle();
+/// Check if we're replaying a game
+extern bool IsReplayGame();
+/// Check if all the commands of the replay are replayed
+extern bool IsReplayFinished();
 /// Load replay
 extern int LoadReplay(const std::string &name);
+/// Go to a cycle of the replay being viewed
+extern void SeekReplay(unsigned long cycle);
 /// End logging
 extern void EndReplayLog();
 /// Clean replay
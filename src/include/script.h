@@ -69,6 +69,7 @@ enum {
 extern lua_State *Lua;
 
 extern int LuaLoadFile(const std::string &file, const std::string &strArg = "");
+extern int LuaLoadBuffer(const std::string &content, const std::string &name, const std::string &strArg = "");
 extern int LuaCall(int narg, int clear, bool exitOnError = true);
 
 #define LuaError(l, args) \
@@ -193,6 +194,12 @@ struct UnitDesc;
 */
 struct StringDesc;
 
+/**
+** Compiled number description
+**  Flat instructions computing a number description without recursion.
+*/
+struct NumberProgram;
+
 /// for Bin operand  a ?? b
 struct BinOp {
 	NumberDesc *Left;           /// Left operand.
@@ -203,6 +210,8 @@ struct BinOp {
 **  Number description.
 */
 struct NumberDesc {
+	NumberDesc();
+
 	ENumber e;       /// which number.
 	union {
 		unsigned int Index; /// index of the lua function.
@@ -240,6 +249,7 @@ struct NumberDesc {
 			StringDesc *ResType;  /// Resource type
 		} PlayerData; /// conditional string.
 	} D;
+	NumberProgram *Program; /// Compiled form, NULL to interpret the tree.
 };
 
 /**
@@ -137,7 +137,7 @@ class ConditionInfo
 {
 public:
 	ConditionInfo() : Alliance(0), Opponent(0), TargetSelf(1),
-		BoolFlag(NULL), Variable(NULL), CheckFunc(NULL) {};
+		BoolFlag(NULL), CheckBoolFlag(false), Variable(NULL), CheckFunc(NULL) {};
 	~ConditionInfo()
 	{
 		delete[] BoolFlag;
@@ -155,8 +155,10 @@ public:
 	char TargetSelf;        /// Target is the same as the caster.
 
 	char *BoolFlag;         /// User defined boolean flag.
+	bool CheckBoolFlag;     /// True if some BoolFlag is not CONDITION_TRUE.
 
 	ConditionInfoVariable *Variable;
+	std::vector<int> CheckedVariables; /// Index of the Variable which need a check.
 	LuaCallback *CheckFunc;
 	//
 	//  @todo more? feel free to add, here and to
@@ -173,6 +173,11 @@ extern std::string MenuRace;
 extern unsigned long GameCycle;             /// Game simulation cycle counter
 extern unsigned long FastForwardCycle;      /// Game Replay Fast Forward Counter
 
+extern bool HeadlessMode;                   /// Run the game without video, sound and input
+extern unsigned long HeadlessMaxCycles;     /// Stop a headless game after this cycle (0 = never)
+extern std::string HeadlessReplay;          /// Replay to run in headless mode instead of a map
+extern std::string HeadlessStatsFile;       /// File of the per minute stats of a headless game
+
 extern void Exit(int err);                  /// Exit
 extern void ExitFatal(int err);             /// Exit with fatal error
 
@@ -47,23 +47,10 @@
 **    This is the tile number, that the player sitting on the computer
 **    currently knows. Idea: Can be uses for illusions.
 **
-**  CMapFieldPlayerInfo::Visible[]
-**
-**    Counter how many units of the player can see this field. 0 the
-**    field is not explored, 1 explored, n-1 unit see it. Currently
-**    no more than 253 units can see a field.
-**
-**  CMapFieldPlayerInfo::VisCloak[]
-**
-**    Visiblity for cloaking.
-**
-**  CMapFieldPlayerInfo::Radar[]
-**
-**    Visiblity for radar.
-**
-**  CMapFieldPlayerInfo::RadarJammer[]
-**
-**    Jamming capabilities.
+**  The counters of each player for a field (seen counter, cloak
+**  detection, radar and radar jamming) are not stored in the field,
+**  but in the per player planes of CMap (CMap::Visible, ...).
+**  CMapFieldPlayerInfo only gives access to them.
 */
 
 /**
@@ -147,17 +134,68 @@ struct lua_State;
 --  Map - field
 ----------------------------------------------------------------------------*/
 
-class CMapFieldPlayerInfo
+/**
+**  Per player counters of all the map fields.
+**
+**  Each player has its own plane of MapWidth * MapHeight counters,
+**  so scanning the fields for one player walks contiguous memory.
+**  A plane is only allocated when first written: players without
+**  radar or cloak detection don't pay for these planes.
+*/
+template <typename T>
+class CMapPlayerPlanes
 {
 public:
-	CMapFieldPlayerInfo() : SeenTile(0)
+	CMapPlayerPlanes() : Size(0) { memset(Planes, 0, sizeof(Planes)); }
+	~CMapPlayerPlanes() { Free(); }
+
+	/// Forget all the counters, and set the number of fields.
+	void Init(unsigned int size)
 	{
-		memset(Visible, 0, sizeof(Visible));
-		memset(VisCloak, 0, sizeof(VisCloak));
-		memset(Radar, 0, sizeof(Radar));
-		memset(RadarJammer, 0, sizeof(RadarJammer));
+		Free();
+		Size = size;
 	}
 
+	void Free()
+	{
+		for (int i = 0; i < PlayerMax; ++i) {
+			delete[] Planes[i];
+			Planes[i] = NULL;
+		}
+		Size = 0;
+	}
+
+	/// Counter of player for the field index.
+	T Get(int player, unsigned int index) const
+	{
+		return Planes[player] ? Planes[player][index] : 0;
+	}
+	/// Plane of player, NULL when all its counters are 0.
+	const T *GetPlane(int player) const { return Planes[player]; }
+
+	/// Plane of player, to modify it.
+	T *GetWritablePlane(int player)
+	{
+		if (Planes[player] == NULL) {
+			Planes[player] = new T[Size];
+			memset(Planes[player], 0, Size * sizeof(T));
+		}
+		return Planes[player];
+	}
+
+private:
+	CMapPlayerPlanes(const CMapPlayerPlanes &); // not implemented
+	CMapPlayerPlanes &operator=(const CMapPlayerPlanes &); // not implemented
+
+	T *Planes[PlayerMax];  /// counters of each player, NULL if not allocated
+	unsigned int Size;     /// number of counters of a plane
+};
+
+class CMapFieldPlayerInfo
+{
+public:
+	CMapFieldPlayerInfo() : SeenTile(0) {}
+
 	/// Check if a field for the user is explored.
 	bool IsExplored(const CPlayer &player) const;
 
@@ -174,12 +212,12 @@ public:
 	*/
 	unsigned char TeamVisibilityState(const CPlayer &player) const;
 
+private:
+	/// Index of the field owning this, in Map.Fields.
+	unsigned int GetIndex() const;
+
 public:
 	unsigned short SeenTile;              /// last seen tile (FOW)
-	unsigned short Visible[PlayerMax];    /// Seen counter 0 unexplored
-	unsigned char VisCloak[PlayerMax];    /// Visiblity for cloaking.
-	unsigned char Radar[PlayerMax];       /// Visiblity for radar.
-	unsigned char RadarJammer[PlayerMax]; /// Jamming capabilities.
 };
 
 /// Describes a field of the map
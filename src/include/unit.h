@@ -130,6 +130,45 @@ enum _directions_ {
 #define NextDirection 32        /// Next direction N->NE->E...
 #define UnitNotSeen 0x7fffffff  /// Unit not seen, used by CUnit::SeenFrame
 
+/**
+**  Individual upgrades of a unit, one bit per upgrade id.
+**
+**  The bits are owned by the unit manager, which sizes them from the
+**  number of upgrades defined when the game starts.
+*/
+class CUnitUpgrades
+{
+public:
+	CUnitUpgrades() : Bits(NULL), Size(0) {}
+
+	/// Use the storage bits for size upgrades
+	void Assign(unsigned int *bits, unsigned int size) { Bits = bits; Size = size; }
+	void Clear() { if (Bits) { memset(Bits, 0, ((Size + 31) / 32) * sizeof(unsigned int)); } }
+
+	/// Has the unit the upgrade id
+	bool Test(int id) const
+	{
+		return (unsigned int)id < Size && ((Bits[id / 32] >> (id % 32)) & 1);
+	}
+	/// Give or take the upgrade id
+	void Set(int id, bool value)
+	{
+		Assert((unsigned int)id < Size);
+		if ((unsigned int)id >= Size) {
+			return;
+		}
+		if (value) {
+			Bits[id / 32] |= 1u << (id % 32);
+		} else {
+			Bits[id / 32] &= ~(1u << (id % 32));
+		}
+	}
+
+private:
+	unsigned int *Bits;  /// 32 upgrades per word
+	unsigned int Size;   /// Number of upgrades
+};
+
 /// The big unit structure
 class CUnit
 {
@@ -177,6 +216,9 @@ public:
 	/// Release a unit
 	void Release(bool final = false);
 
+	/// Handle the buffs and regeneration of the unit again, after its variables changed
+	void ActivateBuffs() { BuffsActive = 1; RegenActive = 1; }
+
 	bool RestoreOrder();
 	bool CanStoreOrder(COrder *order);
 
@@ -311,12 +353,18 @@ public:
 	{
 		friend class CUnitManager;
 	public:
-		CUnitManagerData() : slot(-1), unitSlot(-1) {}
+		CUnitManagerData() : slot(-1), unitSlot(-1), variables(NULL), autoCastSpell(NULL), spellCoolDownTimers(NULL) {}
 
 		int GetUnitId() const { return slot; }
+		CVariable *GetVariables() const { return variables; }
+		char *GetAutoCastSpell() const { return autoCastSpell; }
+		int *GetSpellCoolDownTimers() const { return spellCoolDownTimers; }
 	private:
 		int slot;           /// index in UnitManager::unitSlots
 		int unitSlot;       /// index in UnitManager::units
+		CVariable *variables;      /// slab storage of CUnit::Variable
+		char *autoCastSpell;       /// slab storage of CUnit::AutoCastSpell
+		int *spellCoolDownTimers;  /// slab storage of CUnit::SpellCoolDownTimers
 	};
 public:
 	// @note int is faster than shorts
@@ -354,7 +402,6 @@ public:
 	// DISPLAY:
 	int         Frame;      /// Image frame: <0 is mirrored
 	CUnitColors *Colors;    /// Player colors
-	bool IndividualUpgrades[UpgradeMax];      /// individual upgrades which the unit has
 
 	signed char IX;         /// X image displacement to map position
 	signed char IY;         /// Y image displacement to map position
@@ -382,25 +429,12 @@ public:
 
 	unsigned Waiting : 1;        /// Unit is waiting and playing its still animation
 	unsigned MineLow : 1;        /// This mine got a notification about its resources being low
+	unsigned BuffsActive : 1;    /// Spell effects or cooldowns of the unit run down each cycle
+	unsigned RegenActive : 1;    /// Variables of the unit change each second
 
 	unsigned TeamSelected;  /// unit is selected by a team member.
 	CPlayer *RescuedFrom;        /// The original owner of a rescued unit.
 	/// NULL if the unit was not rescued.
-	/* Seen stuff. */
-	int VisCount[PlayerMax];     /// Unit visibility counts
-	struct _seen_stuff_ {
-		_seen_stuff_() : CFrame(NULL), Type(NULL), tilePos(-1, -1) {}
-		const CConstructionFrame  *CFrame;  /// Seen construction frame
-		int         Frame;                  /// last seen frame/stage of buildings
-		const CUnitType  *Type;             /// Pointer to last seen unit-type
-		Vec2i       tilePos;                /// Last unit->tilePos Seen
-		signed char IX;                     /// Seen X image displacement to map position
-		signed char IY;                     /// seen Y image displacement to map position
-		unsigned    Constructed : 1;        /// Unit seen construction
-		unsigned    State : 3;              /// Unit seen build/upgrade state
-unsigned    Destroyed : PlayerMax;  /// Unit seen destroyed or not
-unsigned    ByPlayer : PlayerMax;   /// Track unit seen by player
-	} Seen;
 
 	CVariable *Variable; /// array of User Defined variables.
 
@@ -430,6 +464,26 @@ unsigned    ByPlayer : PlayerMax;   /// Track unit seen by player
 	int *SpellCoolDownTimers;   /// how much time unit need to wait before spell will be ready
 
 	CUnit *Goal; /// Generic/Teleporter goal pointer
+
+	// Data below is not used by the actions of each cycle.
+
+	CUnitUpgrades IndividualUpgrades;      /// individual upgrades which the unit has
+
+	/* Seen stuff. */
+	int VisCount[PlayerMax];     /// Unit visibility counts
+	struct _seen_stuff_ {
+		_seen_stuff_() : CFrame(NULL), Type(NULL), tilePos(-1, -1) {}
+		const CConstructionFrame  *CFrame;  /// Seen construction frame
+		int         Frame;                  /// last seen frame/stage of buildings
+		const CUnitType  *Type;             /// Pointer to last seen unit-type
+		Vec2i       tilePos;                /// Last unit->tilePos Seen
+		signed char IX;                     /// Seen X image displacement to map position
+		signed char IY;                     /// seen Y image displacement to map position
+		unsigned    Constructed : 1;        /// Unit seen construction
+		unsigned    State : 3;              /// Unit seen build/upgrade state
+unsigned    Destroyed : PlayerMax;  /// Unit seen destroyed or not
+unsigned    ByPlayer : PlayerMax;   /// Track unit seen by player
+	} Seen;
 };
 
 #define NoUnitP (CUnit *)0        /// return value: for no unit found
@@ -535,6 +589,10 @@ extern void UnitGoesOutOfFog(CUnit &unit, const CPlayer &player);
 
 /// Does a recount for VisCount
 extern void UnitCountSeen(CUnit &unit);
+/// Store the vision of each player, before a change of shared vision
+extern void UnitsSharedVisionMasks(int *share);
+/// Make the units go in or out of fog after a change of shared vision
+extern void UnitsUpdateSharedVision(const int *oldShare);
 
 /// Check for rescue each second
 extern void RescueUnits();
@@ -221,6 +221,79 @@ void Select(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &units)
 void SelectFixed(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &units);
 void SelectAroundUnit(const CUnit &unit, int range, std::vector<CUnit *> &around);
 
+/// Below this number of tiles, range queries scan the tile caches instead of the unit buckets
+#define UnitBucketMinArea (2 * UnitBucketSize * UnitBucketSize)
+
+/**
+**  Visit the units of the map buckets whose tiles are in [ltPos, rbPos].
+**
+**  Each unit is visited once, even if it covers several tiles.
+**
+**  @param ltPos    top left tile of the area, on map
+**  @param rbPos    bottom right tile of the area, on map
+**  @param visitor  called for each unit, stop when it returns false
+**
+**  @return         the unit on which visitor stopped, or NULL.
+*/
+template <typename Visitor>
+CUnit *VisitUnitBuckets(const Vec2i &ltPos, const Vec2i &rbPos, Visitor &visitor)
+{
+	// Units are in the bucket of their top left tile, which may be
+	// up to the biggest unit size away of the area.
+	const int reach = Map.GetMaxUnitTileSize() - 1;
+	const int minbx = std::max(0, ltPos.x - reach) >> UnitBucketShift;
+	const int minby = std::max(0, ltPos.y - reach) >> UnitBucketShift;
+	const int maxbx = rbPos.x >> UnitBucketShift;
+	const int maxby = rbPos.y >> UnitBucketShift;
+
+	for (int by = minby; by <= maxby; ++by) {
+		for (int bx = minbx; bx <= maxbx; ++bx) {
+			const CUnitCache &bucket = Map.UnitBucket(bx, by);
+
+			for (size_t i = 0; i != bucket.size(); ++i) {
+				CUnit &unit = *bucket[i];
+
+				if (unit.tilePos.x > rbPos.x || unit.tilePos.y > rbPos.y
+					|| unit.tilePos.x + unit.Type->TileWidth <= ltPos.x
+					|| unit.tilePos.y + unit.Type->TileHeight <= ltPos.y) {
+					continue;
+				}
+				if (visitor(&unit) == false) {
+					return &unit;
+				}
+			}
+		}
+	}
+	return NULL;
+}
+
+template <typename Pred>
+class UnitBucketSelector
+{
+public:
+	UnitBucketSelector(std::vector<CUnit *> &units, Pred pred) : units(&units), pred(pred) {}
+	bool operator()(CUnit *unit)
+	{
+		if (pred(unit)) {
+			units->push_back(unit);
+		}
+		return true;
+	}
+private:
+	std::vector<CUnit *> *units;
+	Pred pred;
+};
+
+template <typename Pred>
+class UnitBucketFinder
+{
+public:
+	explicit UnitBucketFinder(Pred pred) : pred(pred) {}
+	bool operator()(CUnit *unit) { return !pred(unit); }
+private:
+	Pred pred;
+};
+
 template <typename Pred>
 void SelectFixed(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &units, Pred pred)
 {
@@ -228,6 +301,11 @@ void SelectFixed(const Vec2i &ltPos, const Vec2i &rbPos, std::vector<CUnit *> &u
 	Assert(Map.Info.IsPointOnMap(rbPos));
 	Assert(units.empty());
 
+	if ((rbPos.x - ltPos.x + 1) * (rbPos.y - ltPos.y + 1) >= UnitBucketMinArea) {
+		UnitBucketSelector<Pred> selector(units, pred);
+		VisitUnitBuckets(ltPos, rbPos, selector);
+		return;
+	}
 	for (Vec2i posIt = ltPos; posIt.y != rbPos.y + 1; ++posIt.y) {
 		for (posIt.x = ltPos.x; posIt.x != rbPos.x + 1; ++posIt.x) {
 			const CMapField &mf = *Map.Field(posIt);
@@ -275,6 +353,10 @@ CUnit *FindUnit_IfFixed(const Vec2i &ltPos, const Vec2i &rbPos, Pred pred)
 	Assert(Map.Info.IsPointOnMap(ltPos));
 	Assert(Map.Info.IsPointOnMap(rbPos));
 
+	if ((rbPos.x - ltPos.x + 1) * (rbPos.y - ltPos.y + 1) >= UnitBucketMinArea) {
+		UnitBucketFinder<Pred> finder(pred);
+		return VisitUnitBuckets(ltPos, rbPos, finder);
+	}
 	for (Vec2i posIt = ltPos; posIt.y != rbPos.y + 1; ++posIt.y) {
 		for (posIt.x = ltPos.x; posIt.x != rbPos.x + 1; ++posIt.x) {
 			const CMapField &mf = *Map.Field(posIt);
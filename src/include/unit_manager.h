@@ -44,7 +44,9 @@
 ----------------------------------------------------------------------------*/
 
 class CUnit;
+class CUnitType;
 class CFile;
+class CVariable;
 struct lua_State;
 
 class CUnitManager
@@ -71,12 +73,56 @@ public:
 	// Following is mainly for scripting
 	CUnit &GetSlotUnit(int index) const;
 	unsigned int GetUsedSlotCount() const;
+	/// Are the unit arrays sized, so that no variable, spell or upgrade can be added
+	bool IsGameDataSized() const { return !slabs.empty(); }
+
+	// Following is for the loops of each cycle, which go through the slots
+	unsigned int StartLoop();
+	/// Unit of the slot if it was in the game when the loop started and is not destroyed
+	CUnit *GetLoopUnit(unsigned int slot) const
+	{
+		const _slot_state_ &state = slotStates[slot];
+		return state.Added != loopCount && !state.Destroyed ? state.Unit : NULL;
+	}
+	/// Type of the unit of the slot, when GetLoopUnit gives one
+	const CUnitType &GetLoopUnitType(unsigned int slot) const { return *slotStates[slot].Type; }
+	/// Copy the type and the destroyed flag of the unit to its slot state
+	void UpdateSlot(const CUnit &unit);
 
 private:
+	/// State of a slot read by the loops of each cycle, kept dense
+	struct _slot_state_ {
+		_slot_state_() : Unit(NULL), Type(NULL), Added(0), Destroyed(false) {}
+		CUnit *Unit;            /// Unit in the game in the slot, or NULL
+		const CUnitType *Type;  /// Copy of CUnit::Type, see UpdateSlot
+		unsigned int Added;     /// Value of loopCount when the unit was added
+		bool Destroyed;         /// Copy of CUnit::Destroyed, see UpdateSlot
+	};
+
+private:
+	CUnit *NewSlot();
+	void AllocSlab();
+	void FreeSlabs();
+
+private:
+	/// Contiguous storage of units and of their arrays
+	struct _unit_slab_ {
+		CUnit *Units;                  /// Units of the slab
+		CVariable *Variables;          /// variableCount per unit
+		char *AutoCastSpells;          /// spellCount per unit
+		int *SpellCoolDownTimers;      /// spellCount per unit
+		unsigned int *Upgrades;        /// upgrade bits of each unit
+	};
 	std::vector<CUnit *> units;
 	std::vector<CUnit *> unitSlots;
+	std::vector<_slot_state_> slotStates;
+	unsigned int loopCount;     /// Number of loops started
 	std::list<CUnit *> releasedUnits;
 	CUnit *lastCreated;
+	std::vector<_unit_slab_> slabs;
+	unsigned int variableCount;  /// Number of variables of a unit
+	unsigned int spellCount;     /// Number of spells of a unit
+	unsigned int upgradeCount;   /// Number of upgrades of a unit
 };
 
 
@@ -98,6 +98,12 @@ public:
 
 	inline bool IsLoaded() const { return Surface != NULL; }
 
+protected:
+	/// Called when the pixels or the palette of the surfaces changed
+	virtual void SurfaceChanged() {}
+
+public:
+
 	//guichan
 	virtual void *_getData() const { return Surface; }
 	virtual int getWidth() const { return Width; }
@@ -124,19 +130,42 @@ public:
 class CPlayerColorGraphic : public CGraphic
 {
 protected:
-	CPlayerColorGraphic()
+	CPlayerColorGraphic() : ColorsVersion(0)
 	{
+		memset(PlayerColorSurfaces, 0, sizeof(PlayerColorSurfaces));
+		memset(PlayerColorSurfacesFlip, 0, sizeof(PlayerColorSurfacesFlip));
 	}
 
+	~CPlayerColorGraphic() { FreePlayerColorSurfaces(); }
+
 public:
 	void DrawPlayerColorFrameClipX(int player, unsigned frame, int x, int y);
 	void DrawPlayerColorFrameClip(int player, unsigned frame, int x, int y);
 
+	/// Forget the recolored surfaces, they are rebuilt when needed
+	void FreePlayerColorSurfaces();
+
 	static CPlayerColorGraphic *New(const std::string &file, int w = 0, int h = 0);
 	static CPlayerColorGraphic *ForceNew(const std::string &file, int w = 0, int h = 0);
 	static CPlayerColorGraphic *Get(const std::string &file);
 
 	CPlayerColorGraphic *Clone(bool grayscale = false) const;
+
+protected:
+	virtual void SurfaceChanged() { FreePlayerColorSurfaces(); }
+
+private:
+	SDL_Surface *GetPlayerColorSurface(int player, bool flip);
+
+	/**
+	**  Copies of Surface and SurfaceFlip with the palette set to the
+	**  colors of each player, built on first draw for that player.
+	**  They are all dropped when the player colors change
+	**  (ColorsVersion != PlayerColorsVersion) or the surface changes.
+	*/
+	SDL_Surface *PlayerColorSurfaces[PlayerMax];
+	SDL_Surface *PlayerColorSurfacesFlip[PlayerMax];
+	unsigned int ColorsVersion;  /// PlayerColorsVersion of the copies
 };
 
 #ifdef USE_MNG
@@ -389,6 +418,15 @@ extern void SetClipping(int left, int top, int right, int bottom);
 
 /// Realize video memory.
 extern void RealizeVideoMemory();
+/// Forget what the screen texture holds, the next frame uploads it all
+extern void ForgetUploadedScreen();
+
+/// Upload the whole screen when the invalidated area is above this percentage
+extern int VideoFullUploadPercent;
+/// Bytes uploaded to the screen texture by the last realized frame
+extern unsigned int VideoUploadedBytes;
+/// Bytes uploaded to the screen texture since start
+extern unsigned long VideoUploadedBytesTotal;
 
 /// Save a screenshot to a PNG file
 extern void SaveScreenshotPNG(const char *name);
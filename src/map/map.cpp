@@ -39,6 +39,7 @@
 #include "map.h"
 
 #include "iolib.h"
+#include "pathfinder.h"
 #include "player.h"
 #include "tileset.h"
 #include "unit.h"
@@ -131,13 +132,15 @@ void CMap::MarkSeenTile(CMapField &mf)
 void CMap::Reveal()
 {
 	//  Mark every explored tile as visible. 1 turns into 2.
-	for (int i = 0; i != this->Info.MapWidth * this->Info.MapHeight; ++i) {
-		CMapField &mf = *this->Field(i);
-		CMapFieldPlayerInfo &playerInfo = mf.playerInfo;
-		for (int p = 0; p < PlayerMax; ++p) {
-			playerInfo.Visible[p] = std::max<unsigned short>(1, playerInfo.Visible[p]);
+	const int size = this->Info.MapWidth * this->Info.MapHeight;
+	for (int p = 0; p < PlayerMax; ++p) {
+		unsigned short *visible = this->Visible.GetWritablePlane(p);
+		for (int i = 0; i != size; ++i) {
+			visible[i] = std::max<unsigned short>(1, visible[i]);
 		}
-		MarkSeenTile(mf);
+	}
+	for (int i = 0; i != size; ++i) {
+		MarkSeenTile(*this->Field(i));
 	}
 	//  Global seen recount. Simple and effective.
 	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
@@ -308,7 +311,8 @@ void CMapInfo::Clear()
 	this->MapUID = 0;
 }
 
-CMap::CMap() : Fields(NULL), NoFogOfWar(false), TileGraphic(NULL)
+CMap::CMap() : Fields(NULL), UnitBucketsWidth(0), NoFogOfWar(false), TileGraphic(NULL),
+	MaxUnitTileSize(1)
 {
 	Tileset = new CTileset;
 }
@@ -325,7 +329,19 @@ void CMap::Create()
 {
 	Assert(!this->Fields);
 
-	this->Fields = new CMapField[this->Info.MapWidth * this->Info.MapHeight];
+	const unsigned int size = this->Info.MapWidth * this->Info.MapHeight;
+	this->Fields = new CMapField[size];
+	this->Visible.Init(size);
+	this->VisCloak.Init(size);
+	this->SightMask.assign(size, 0);
+	this->CloakMask.assign(size, 0);
+	this->Radar.Init(size);
+	this->RadarJammer.Init(size);
+
+	this->UnitBucketsWidth = (this->Info.MapWidth + UnitBucketSize - 1) >> UnitBucketShift;
+	const int bucketsHeight = (this->Info.MapHeight + UnitBucketSize - 1) >> UnitBucketShift;
+	this->UnitBuckets.assign(this->UnitBucketsWidth * bucketsHeight, CUnitCache());
+	this->MaxUnitTileSize = 1;
 }
 
 /**
@@ -343,6 +359,15 @@ void CMap::Init()
 void CMap::Clean()
 {
 	delete[] this->Fields;
+	this->Visible.Free();
+	this->VisCloak.Free();
+	this->SightMask.clear();
+	this->CloakMask.clear();
+	this->Radar.Free();
+	this->RadarJammer.Free();
+	this->UnitBuckets.clear();
+	this->UnitBucketsWidth = 0;
+	this->MaxUnitTileSize = 1;
 
 	// Tileset freed by Tileset?
 
@@ -524,6 +549,7 @@ void CMap::ClearWoodTile(const Vec2i &pos)
 	mf.setGraphicTile(this->Tileset->getRemovedTreeTile());
 	mf.Flags &= ~(MapFieldForest | MapFieldUnpassable);
 	mf.Value = 0;
+	PathfinderTerrainChanged(pos, 1, 1);
 
 	UI.Minimap.UpdateXY(pos);
 	FixNeighbors(MapFieldForest, 0, pos);
@@ -542,6 +568,7 @@ void CMap::ClearRockTile(const Vec2i &pos)
 	mf.setGraphicTile(this->Tileset->getRemovedRockTile());
 	mf.Flags &= ~(MapFieldRocks | MapFieldUnpassable);
 	mf.Value = 0;
+	PathfinderTerrainChanged(pos, 1, 1);
 
 	UI.Minimap.UpdateXY(pos);
 	FixNeighbors(MapFieldRocks, 0, pos);
@@ -603,6 +630,7 @@ void CMap::RegenerateForestTile(const Vec2i &pos)
 		mf.playerInfo.SeenTile = mf.getGraphicTile();
 		mf.Value = 0;
 		mf.Flags |= MapFieldForest | MapFieldUnpassable;
+		PathfinderTerrainChanged(pos + offset, 1, 2);
 		UI.Minimap.UpdateSeenXY(pos);
 		UI.Minimap.UpdateXY(pos);
 		if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
@@ -210,19 +210,20 @@ static void UnitsOnTileUnmarkSeen(const CPlayer &player, CMapField &mf, int cloa
 **  Mark a tile's sight. (Explore and make visible.)
 **
 **  @param player  Player to mark sight.
-**  @param index   tile to mark.
+**  @param mf      tile to mark.
+**  @param index   index of the tile.
+**  @param v       seen counter of player for the tile.
 */
-void MapMarkTileSight(const CPlayer &player, const unsigned int index)
+static inline void MarkTileSight(const CPlayer &player, CMapField &mf, unsigned int index, unsigned short *v)
 {
-	CMapField &mf = *Map.Field(index);
-	unsigned short *v = &(mf.playerInfo.Visible[player.Index]);
 	if (*v == 0 || *v == 1) { // Unexplored or unseen
 		// When there is no fog only unexplored tiles are marked.
 		if (!Map.NoFogOfWar || *v == 0) {
 			UnitsOnTileMarkSeen(player, mf, 0);
 		}
 		*v = 2;
-		if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
+		Map.SightMask[index] |= 1 << player.Index;
+		if (Map.FieldTeamVisibilityState(*ThisPlayer, index) == 2) {
 			Map.MarkSeenTile(mf);
 		}
 		return;
@@ -231,34 +232,29 @@ void MapMarkTileSight(const CPlayer &player, const unsigned int index)
 	++*v;
 }
 
-void MapMarkTileSight(const CPlayer &player, const Vec2i &pos)
-{
-	Assert(Map.Info.IsPointOnMap(pos));
-	MapMarkTileSight(player, Map.getIndex(pos));
-}
-
 /**
 **  Unmark a tile's sight. (Explore and make visible.)
 **
 **  @param player  Player to mark sight.
-**  @param indexx  tile to mark.
+**  @param mf      tile to mark.
+**  @param index   index of the tile.
+**  @param v       seen counter of player for the tile.
 */
-void MapUnmarkTileSight(const CPlayer &player, const unsigned int index)
+static inline void UnmarkTileSight(const CPlayer &player, CMapField &mf, unsigned int index, unsigned short *v)
 {
-	CMapField &mf = *Map.Field(index);
-	unsigned short *v = &mf.playerInfo.Visible[player.Index];
 	switch (*v) {
 		case 0:  // Unexplored
 		case 1:
-			// This happens when we unmark everything in CommandSharedVision
+			// Not seen by the player, so there is nothing to unmark
 			break;
 		case 2:
 			// When there is NoFogOfWar units never get unmarked.
 			if (!Map.NoFogOfWar) {
 				UnitsOnTileUnmarkSeen(player, mf, 0);
 			}
+			Map.SightMask[index] &= ~(1 << player.Index);
 			// Check visible Tile, then deduct...
-			if (mf.playerInfo.IsTeamVisible(*ThisPlayer)) {
+			if (Map.FieldTeamVisibilityState(*ThisPlayer, index) == 2) {
 				Map.MarkSeenTile(mf);
 			}
 		default:  // seen -> seen
@@ -267,56 +263,217 @@ void MapUnmarkTileSight(const CPlayer &player, const unsigned int index)
 	}
 }
 
-void MapUnmarkTileSight(const CPlayer &player, const Vec2i &pos)
-{
-	Assert(Map.Info.IsPointOnMap(pos));
-	MapUnmarkTileSight(player, Map.getIndex(pos));
-}
-
 /**
 **  Mark a tile for cloak detection.
 **
 **  @param player  Player to mark sight.
-**  @param index   Tile to mark.
+**  @param mf      Tile to mark.
+**  @param index   index of the tile.
+**  @param v       cloak detection counter of player for the tile.
 */
-void MapMarkTileDetectCloak(const CPlayer &player, const unsigned int index)
+static inline void MarkTileDetectCloak(const CPlayer &player, CMapField &mf, unsigned int index, unsigned char *v)
 {
-	CMapField &mf = *Map.Field(index);
-	unsigned char *v = &mf.playerInfo.VisCloak[player.Index];
 	if (*v == 0) {
 		UnitsOnTileMarkSeen(player, mf, 1);
+		Map.CloakMask[index] |= 1 << player.Index;
 	}
 	Assert(*v != 255);
 	++*v;
 }
 
-void MapMarkTileDetectCloak(const CPlayer &player, const Vec2i &pos)
-{
-	MapMarkTileDetectCloak(player, Map.getIndex(pos));
-}
-
 /**
 **  Unmark a tile for cloak detection.
 **
 **  @param player  Player to mark sight.
-**  @param index   tile to mark.
+**  @param mf      tile to mark.
+**  @param index   index of the tile.
+**  @param v       cloak detection counter of player for the tile.
 */
-void MapUnmarkTileDetectCloak(const CPlayer &player, const unsigned int index)
+static inline void UnmarkTileDetectCloak(const CPlayer &player, CMapField &mf, unsigned int index, unsigned char *v)
 {
-	CMapField &mf = *Map.Field(index);
-	unsigned char *v = &mf.playerInfo.VisCloak[player.Index];
 	Assert(*v != 0);
 	if (*v == 1) {
 		UnitsOnTileUnmarkSeen(player, mf, 1);
+		Map.CloakMask[index] &= ~(1 << player.Index);
 	}
 	--*v;
 }
 
+void MapMarkTileSight(const CPlayer &player, const unsigned int index)
+{
+	MarkTileSight(player, *Map.Field(index), index, Map.Visible.GetWritablePlane(player.Index) + index);
+}
+
+void MapMarkTileSight(const CPlayer &player, const Vec2i &pos)
+{
+	Assert(Map.Info.IsPointOnMap(pos));
+	MapMarkTileSight(player, Map.getIndex(pos));
+}
+
+void MapUnmarkTileSight(const CPlayer &player, const unsigned int index)
+{
+	UnmarkTileSight(player, *Map.Field(index), index, Map.Visible.GetWritablePlane(player.Index) + index);
+}
+
+void MapUnmarkTileSight(const CPlayer &player, const Vec2i &pos)
+{
+	Assert(Map.Info.IsPointOnMap(pos));
+	MapUnmarkTileSight(player, Map.getIndex(pos));
+}
+
+void MapMarkTileDetectCloak(const CPlayer &player, const unsigned int index)
+{
+	MarkTileDetectCloak(player, *Map.Field(index), index, Map.VisCloak.GetWritablePlane(player.Index) + index);
+}
+
+void MapMarkTileDetectCloak(const CPlayer &player, const Vec2i &pos)
+{
+	MapMarkTileDetectCloak(player, Map.getIndex(pos));
+}
+
+void MapUnmarkTileDetectCloak(const CPlayer &player, const unsigned int index)
+{
+	UnmarkTileDetectCloak(player, *Map.Field(index), index, Map.VisCloak.GetWritablePlane(player.Index) + index);
+}
+
 void MapUnmarkTileDetectCloak(const CPlayer &player, const Vec2i &pos)
 {
 	MapUnmarkTileDetectCloak(player, Map.getIndex(pos));
 }
 
+/**
+**  Mark the sight of count tiles of a row, starting at index.
+*/
+void MapMarkSpanSight(const CPlayer &player, const unsigned int index, int count)
+{
+	unsigned short *v = Map.Visible.GetWritablePlane(player.Index) + index;
+	CMapField *mf = Map.Field(index);
+	for (unsigned int i = index; count; --count, ++i, ++mf, ++v) {
+		MarkTileSight(player, *mf, i, v);
+	}
+}
+
+/**
+**  Unmark the sight of count tiles of a row, starting at index.
+*/
+void MapUnmarkSpanSight(const CPlayer &player, const unsigned int index, int count)
+{
+	unsigned short *v = Map.Visible.GetWritablePlane(player.Index) + index;
+	CMapField *mf = Map.Field(index);
+	for (unsigned int i = index; count; --count, ++i, ++mf, ++v) {
+		UnmarkTileSight(player, *mf, i, v);
+	}
+}
+
+/**
+**  Mark count tiles of a row for cloak detection, starting at index.
+*/
+void MapMarkSpanDetectCloak(const CPlayer &player, const unsigned int index, int count)
+{
+	unsigned char *v = Map.VisCloak.GetWritablePlane(player.Index) + index;
+	CMapField *mf = Map.Field(index);
+	for (unsigned int i = index; count; --count, ++i, ++mf, ++v) {
+		MarkTileDetectCloak(player, *mf, i, v);
+	}
+}
+
+/**
+**  Unmark count tiles of a row for cloak detection, starting at index.
+*/
+void MapUnmarkSpanDetectCloak(const CPlayer &player, const unsigned int index, int count)
+{
+	unsigned char *v = Map.VisCloak.GetWritablePlane(player.Index) + index;
+	CMapField *mf = Map.Field(index);
+	for (unsigned int i = index; count; --count, ++i, ++mf, ++v) {
+		UnmarkTileDetectCloak(player, *mf, i, v);
+	}
+}
+
+/**
+**  Calls a tile marker for each tile of a row.
+*/
+class _TileMarkerSpan
+{
+public:
+	explicit _TileMarkerSpan(MapMarkerFunc *marker) : marker(marker) {}
+
+	void operator()(const CPlayer &player, const unsigned int index, int count) const
+	{
+#ifdef MARKER_ON_INDEX
+		for (unsigned int i = index; count; --count, ++i) {
+			marker(player, i);
+		}
+#else
+		Vec2i mpos(index % Map.Info.MapWidth, index / Map.Info.MapWidth);
+		for (; count; --count, ++mpos.x) {
+			marker(player, mpos);
+		}
+#endif
+	}
+private:
+	MapMarkerFunc *marker;
+};
+
+/**
+**  Return the half widths of the sight circle of radius range.
+**
+**  Entry d is how far the sight reaches horizontally on the rows
+**  d tiles above or below the unit. The tables are computed once
+**  per range, instead of an isqrt for each row and each mark.
+**
+**  @param range  Radius of the sight, not 0.
+**
+**  @return       range + 1 half widths.
+*/
+static const int *GetSightSpans(int range)
+{
+	static std::vector<std::vector<int> > SightSpans;
+
+	if (range >= (int)SightSpans.size()) {
+		SightSpans.resize(range + 1);
+	}
+	std::vector<int> &spans = SightSpans[range];
+	if (spans.empty()) {
+		spans.resize(range + 1);
+		for (int d = 0; d <= range; ++d) {
+			spans[d] = isqrt(square(range + 1) - square(d) - 1);
+		}
+	}
+	return &spans[0];
+}
+
+/**
+**  Find the tiles of a map row seen by a sight.
+**
+**  @param pos     top left position of the sight
+**  @param w       width of the sight, in square
+**  @param h       height of the sight, in square
+**  @param range   Radius of the sight.
+**  @param spans   Result of GetSightSpans(range).
+**  @param y       map row
+**  @param minx    first tile of the row seen
+**  @param maxx    first tile after the seen tiles, minx if none
+*/
+static void GetSightRowSpan(const Vec2i &pos, int w, int h, int range, const int *spans,
+							int y, int *minx, int *maxx)
+{
+	int d;
+
+	if (y < pos.y) {
+		d = pos.y - y;
+	} else if (y < pos.y + h) {
+		d = 0;
+	} else {
+		d = y - (pos.y + h) + 1;
+	}
+	if (d > range) {
+		*minx = *maxx = 0;
+		return;
+	}
+	*minx = std::max(0, pos.x - spans[d]);
+	*maxx = std::max(*minx, std::min(Map.Info.MapWidth, pos.x + w + spans[d]));
+}
+
 /**
 **  Mark the sight of unit. (Explore and make visible.)
 **
@@ -325,70 +482,118 @@ void MapUnmarkTileDetectCloak(const CPlayer &player, const Vec2i &pos)
 **  @param w       width to mark, in square
 **  @param h       height to mark, in square
 **  @param range   Radius to mark.
-**  @param marker  Function to mark or unmark sight
+**  @param marker  Function to mark or unmark sight of a row of tiles
 */
-void MapSight(const CPlayer &player, const Vec2i &pos, int w, int h, int range, MapMarkerFunc *marker)
+template <typename SpanMarker>
+static void MapSightSpans(const CPlayer &player, const Vec2i &pos, int w, int h, int range, SpanMarker marker)
 {
 	// Units under construction have no sight range.
 	if (!range) {
 		return;
 	}
-	// Up hemi-cyle
-	const int miny = std::max(-range, 0 - pos.y);
-	for (int offsety = miny; offsety != 0; ++offsety) {
-		const int offsetx = isqrt(square(range + 1) - square(-offsety) - 1);
-		const int minx = std::max(0, pos.x - offsetx);
-		const int maxx = std::min(Map.Info.MapWidth, pos.x + w + offsetx);
-		Vec2i mpos(minx, pos.y + offsety);
-#ifdef MARKER_ON_INDEX
-		const unsigned int index = mpos.y * Map.Info.MapWidth;
-#endif
+	const int *spans = GetSightSpans(range);
+	const int miny = std::max(0, pos.y - range);
+	const int maxy = std::min(Map.Info.MapHeight, pos.y + h + range);
 
-		for (mpos.x = minx; mpos.x < maxx; ++mpos.x) {
-#ifdef MARKER_ON_INDEX
-			marker(player, mpos.x + index);
-#else
-			marker(player, mpos);
-#endif
+	for (int y = miny; y < maxy; ++y) {
+		int minx;
+		int maxx;
+
+		GetSightRowSpan(pos, w, h, range, spans, y, &minx, &maxx);
+		if (minx < maxx) {
+			marker(player, Map.getIndex(minx, y), maxx - minx);
 		}
 	}
-	for (int offsety = 0; offsety < h; ++offsety) {
-		const int minx = std::max(0, pos.x - range);
-		const int maxx = std::min(Map.Info.MapWidth, pos.x + w + range);
-		Vec2i mpos(minx, pos.y + offsety);
-#ifdef MARKER_ON_INDEX
-		const unsigned int index = mpos.y * Map.Info.MapWidth;
-#endif
+}
 
-		for (mpos.x = minx; mpos.x < maxx; ++mpos.x) {
-#ifdef MARKER_ON_INDEX
-			marker(player, mpos.x + index);
-#else
-			marker(player, mpos);
-#endif
-		}
+/**
+**  Call marker for the tiles of [minx, maxx) which are not in [minx2, maxx2).
+*/
+template <typename SpanMarker>
+static void MarkSpanDifference(const CPlayer &player, int y, int minx, int maxx,
+							   int minx2, int maxx2, SpanMarker marker)
+{
+	if (minx >= maxx) {
+		return;
 	}
-	// bottom hemi-cycle
-	const int maxy = std::min(range, Map.Info.MapHeight - pos.y - h);
-	for (int offsety = 0; offsety < maxy; ++offsety) {
-		const int offsetx = isqrt(square(range + 1) - square(offsety + 1) - 1);
-		const int minx = std::max(0, pos.x - offsetx);
-		const int maxx = std::min(Map.Info.MapWidth, pos.x + w + offsetx);
-		Vec2i mpos(minx, pos.y + h + offsety);
-#ifdef MARKER_ON_INDEX
-		const unsigned int index = mpos.y * Map.Info.MapWidth;
-#endif
+	if (minx2 >= maxx2) {
+		marker(player, Map.getIndex(minx, y), maxx - minx);
+		return;
+	}
+	const int leftEnd = std::min(maxx, minx2);
+	if (minx < leftEnd) {
+		marker(player, Map.getIndex(minx, y), leftEnd - minx);
+	}
+	const int rightBegin = std::max(minx, maxx2);
+	if (rightBegin < maxx) {
+		marker(player, Map.getIndex(rightBegin, y), maxx - rightBegin);
+	}
+}
 
-		for (mpos.x = minx; mpos.x < maxx; ++mpos.x) {
-#ifdef MARKER_ON_INDEX
-			marker(player, mpos.x + index);
-#else
-			marker(player, mpos);
-#endif
-		}
+/**
+**  Move the sight of unit from oldPos to newPos.
+**
+**  Only the tiles leaving or entering the sight are (un)marked, which
+**  for a move of one tile are a thin strip on each side. The tiles
+**  seen from both places are not touched, so the units on them
+**  don't go under fog and out again.
+**
+**  @param player    player to mark the sight for (not unit owner)
+**  @param oldPos    old location of the sight
+**  @param newPos    new location of the sight
+**  @param w         width to mark, in square
+**  @param h         height to mark, in square
+**  @param range     Radius to mark.
+**  @param marker    Function to mark sight of a row of tiles
+**  @param unmarker  Function to unmark sight of a row of tiles
+*/
+template <typename SpanMarker>
+static void MapSightMoveSpans(const CPlayer &player, const Vec2i &oldPos, const Vec2i &newPos,
+							  int w, int h, int range, SpanMarker marker, SpanMarker unmarker)
+{
+	if (!range) {
+		return;
+	}
+	const int *spans = GetSightSpans(range);
+	const int miny = std::max(0, std::min(oldPos.y, newPos.y) - range);
+	const int maxy = std::min(Map.Info.MapHeight, std::max(oldPos.y, newPos.y) + h + range);
+
+	for (int y = miny; y < maxy; ++y) {
+		int oldMinx;
+		int oldMaxx;
+		int newMinx;
+		int newMaxx;
+
+		GetSightRowSpan(oldPos, w, h, range, spans, y, &oldMinx, &oldMaxx);
+		GetSightRowSpan(newPos, w, h, range, spans, y, &newMinx, &newMaxx);
+		// Leading edge first, then trailing edge.
+		MarkSpanDifference(player, y, newMinx, newMaxx, oldMinx, oldMaxx, marker);
+		MarkSpanDifference(player, y, oldMinx, oldMaxx, newMinx, newMaxx, unmarker);
 	}
 }
 
+void MapSight(const CPlayer &player, const Vec2i &pos, int w, int h, int range, MapMarkerFunc *marker)
+{
+	MapSightSpans(player, pos, w, h, range, _TileMarkerSpan(marker));
+}
+
+void MapSight(const CPlayer &player, const Vec2i &pos, int w, int h, int range, MapSpanMarkerFunc *marker)
+{
+	MapSightSpans(player, pos, w, h, range, marker);
+}
+
+void MapSightMove(const CPlayer &player, const Vec2i &oldPos, const Vec2i &newPos,
+				  int w, int h, int range, MapMarkerFunc *marker, MapMarkerFunc *unmarker)
+{
+	MapSightMoveSpans(player, oldPos, newPos, w, h, range, _TileMarkerSpan(marker), _TileMarkerSpan(unmarker));
+}
+
+void MapSightMove(const CPlayer &player, const Vec2i &oldPos, const Vec2i &newPos,
+				  int w, int h, int range, MapSpanMarkerFunc *marker, MapSpanMarkerFunc *unmarker)
+{
+	MapSightMoveSpans(player, oldPos, newPos, w, h, range, marker, unmarker);
+}
+
 /**
 **  Update fog of war.
 */
@@ -398,10 +603,10 @@ void UpdateFogOfWarChange()
 	//  Mark all explored fields as visible again.
 	if (Map.NoFogOfWar) {
 		const unsigned int w = Map.Info.MapHeight * Map.Info.MapWidth;
-		for (unsigned int index = 0; index != w; ++index) {
-			CMapField &mf = *Map.Field(index);
-			if (mf.playerInfo.IsExplored(*ThisPlayer)) {
-				Map.MarkSeenTile(mf);
+		const unsigned short *visible = Map.Visible.GetPlane(ThisPlayer->Index);
+		for (unsigned int index = 0; visible && index != w; ++index) {
+			if (visible[index]) {
+				Map.MarkSeenTile(*Map.Field(index));
 			}
 		}
 	}
@@ -618,11 +823,23 @@ void CViewport::DrawMapFogOfWar() const
 	// and 1 tile around viewport (for fog-of-war connection display)
 
 	unsigned int my_index = my * Map.Info.MapWidth;
-	for (; my < ey; ++my) {
-		for (int mx = sx; mx < ex; ++mx) {
-			VisibleTable[my_index + mx] = Map.Field(mx + my_index)->playerInfo.TeamVisibilityState(*ThisPlayer);
+	const unsigned short *visible = Map.Visible.GetPlane(ThisPlayer->Index);
+	if (!ThisPlayer->IsVisionSharing() && !Map.NoFogOfWar) {
+		// Only our own plane matters: copy it row by row, clamped to 2.
+		for (; my < ey; ++my) {
+			for (int mx = sx; mx < ex; ++mx) {
+				const unsigned short v = visible ? visible[my_index + mx] : 0;
+				VisibleTable[my_index + mx] = std::min<unsigned short>(v, 2);
+			}
+			my_index += Map.Info.MapWidth;
+		}
+	} else {
+		for (; my < ey; ++my) {
+			for (int mx = sx; mx < ex; ++mx) {
+				VisibleTable[my_index + mx] = Map.FieldTeamVisibilityState(*ThisPlayer, mx + my_index);
+			}
+			my_index += Map.Info.MapWidth;
 		}
-		my_index += Map.Info.MapWidth;
 	}
 	ex = this->BottomRightPos.x;
 	int sy = MapPos.y * Map.Info.MapWidth;
@@ -47,33 +47,32 @@
 ----------------------------------------------------------------------------*/
 
 static inline unsigned char
-IsTileRadarVisible(const CPlayer &pradar, const CPlayer &punit, const CMapFieldPlayerInfo &mfp)
+IsTileRadarVisible(const CPlayer &pradar, const CPlayer &punit, unsigned int index)
 {
-	if (mfp.RadarJammer[punit.Index]) {
+	if (Map.RadarJammer.Get(punit.Index, index)) {
 		return 0;
 	}
 
 	int p = pradar.Index;
 	if (pradar.IsVisionSharing()) {
-		const unsigned char *const radar = mfp.Radar;
-		const unsigned char *const jamming = mfp.RadarJammer;
 		unsigned char radarvision = 0;
 		// Check jamming first, if we are jammed, exit
 		for (int i = 0; i < PlayerMax; ++i) {
 			if (i != p) {
-				if (jamming[i] > 0 && punit.HasMutualSharedVisionWith(Players[i])) {
+				if (Map.RadarJammer.Get(i, index) > 0 && punit.HasMutualSharedVisionWith(Players[i])) {
 					// We are jammed, return nothing
 					return 0;
 				}
-				if (radar[i] > 0 && pradar.HasMutualSharedVisionWith(Players[i])) {
-					radarvision |= radar[i];
+				const unsigned char radar = Map.Radar.Get(i, index);
+				if (radar > 0 && pradar.HasMutualSharedVisionWith(Players[i])) {
+					radarvision |= radar;
 				}
 			}
 		}
 		// Can't exit until the end, as we might be jammed
-		return (radarvision | mfp.Radar[p]);
+		return (radarvision | Map.Radar.Get(p, index));
 	}
-	return mfp.Radar[p];
+	return Map.Radar.Get(p, index);
 }
 
 
@@ -83,14 +82,11 @@ bool CUnit::IsVisibleOnRadar(const CPlayer &pradar) const
 	unsigned int index = Offset;
 	int j = Type->TileHeight;
 	do {
-		const CMapField *mf = Map.Field(index);
-		int i = x_max;
-		do {
-			if (IsTileRadarVisible(pradar, *Player, mf->playerInfo) != 0) {
+		for (unsigned int i = index; i != index + x_max; ++i) {
+			if (IsTileRadarVisible(pradar, *Player, i) != 0) {
 				return true;
 			}
-			++mf;
-		} while (--i);
+		}
 		index += Map.Info.MapWidth;
 	} while (--j);
 
@@ -108,8 +104,9 @@ bool CUnit::IsVisibleOnRadar(const CPlayer &pradar) const
 */
 void MapMarkTileRadar(const CPlayer &player, const unsigned int index)
 {
-	Assert(Map.Field(index)->playerInfo.Radar[player.Index] != 255);
-	Map.Field(index)->playerInfo.Radar[player.Index]++;
+	unsigned char *v = Map.Radar.GetWritablePlane(player.Index) + index;
+	Assert(*v != 255);
+	++*v;
 }
 
 void MapMarkTileRadar(const CPlayer &player, int x, int y)
@@ -129,7 +126,7 @@ void MapMarkTileRadar(const CPlayer &player, int x, int y)
 void MapUnmarkTileRadar(const CPlayer &player, const unsigned int index)
 {
 	// Reduce radar coverage if it exists.
-	unsigned char *v = &(Map.Field(index)->playerInfo.Radar[player.Index]);
+	unsigned char *v = Map.Radar.GetWritablePlane(player.Index) + index;
 	if (*v) {
 		--*v;
 	}
@@ -151,8 +148,9 @@ void MapUnmarkTileRadar(const CPlayer &player, int x, int y)
 */
 void MapMarkTileRadarJammer(const CPlayer &player, const unsigned int index)
 {
-	Assert(Map.Field(index)->playerInfo.RadarJammer[player.Index] != 255);
-	Map.Field(index)->playerInfo.RadarJammer[player.Index]++;
+	unsigned char *v = Map.RadarJammer.GetWritablePlane(player.Index) + index;
+	Assert(*v != 255);
+	++*v;
 }
 
 void MapMarkTileRadarJammer(const CPlayer &player, int x, int y)
@@ -171,7 +169,7 @@ void MapMarkTileRadarJammer(const CPlayer &player, int x, int y)
 void MapUnmarkTileRadarJammer(const CPlayer &player, const unsigned int index)
 {
 	// Reduce radar coverage if it exists.
-	unsigned char *v = &(Map.Field(index)->playerInfo.RadarJammer[player.Index]);
+	unsigned char *v = Map.RadarJammer.GetWritablePlane(player.Index) + index;
 	if (*v) {
 		--*v;
 	}
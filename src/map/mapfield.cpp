@@ -97,8 +97,9 @@ void CMapField::setTileIndex(const CTileset &tileset, unsigned int tileIndex, in
 void CMapField::Save(CFile &file) const
 {
 	file.printf("  {%3d, %3d, %2d, %2d", tile, playerInfo.SeenTile, Value, cost);
+	const unsigned int index = this - Map.Fields;
 	for (int i = 0; i != PlayerMax; ++i) {
-		if (playerInfo.Visible[i] == 1) {
+		if (Map.Visible.Get(i, index) == 1) {
 			file.printf(", \"explored\", %d", i);
 		}
 	}
@@ -170,7 +171,7 @@ void CMapField::parse(lua_State *l)
 
 		if (!strcmp(value, "explored")) {
 			++j;
-			this->playerInfo.Visible[LuaToNumber(l, -1, j + 1)] = 1;
+			Map.Visible.GetWritablePlane(LuaToNumber(l, -1, j + 1))[this - Map.Fields] = 1;
 		} else if (!strcmp(value, "human")) {
 			this->Flags |= MapFieldHuman;
 		} else if (!strcmp(value, "land")) {
@@ -263,45 +264,80 @@ bool CMapField::isAOrcWall() const
 //  CMapFieldPlayerInfo
 //
 
+unsigned int CMapFieldPlayerInfo::GetIndex() const
+{
+	// playerInfo is a member of the fields of Map.Fields
+	const char *first = reinterpret_cast<const char *>(&Map.Fields->playerInfo);
+	return (reinterpret_cast<const char *>(this) - first) / sizeof(CMapField);
+}
+
 unsigned char CMapFieldPlayerInfo::TeamVisibilityState(const CPlayer &player) const
 {
-	if (IsVisible(player)) {
+	return Map.FieldTeamVisibilityState(player, GetIndex());
+}
+
+bool CMapFieldPlayerInfo::IsExplored(const CPlayer &player) const
+{
+	return Map.IsFieldExplored(player, GetIndex());
+}
+
+bool CMapFieldPlayerInfo::IsVisible(const CPlayer &player) const
+{
+	return Map.IsFieldVisible(player, GetIndex());
+}
+
+bool CMapFieldPlayerInfo::IsTeamVisible(const CPlayer &player) const
+{
+	return TeamVisibilityState(player) == 2;
+}
+
+//
+//  CMap
+//
+
+bool CMap::IsFieldExplored(const CPlayer &player, unsigned int index) const
+{
+	return Visible.Get(player.Index, index) != 0;
+}
+
+bool CMap::IsFieldVisible(const CPlayer &player, unsigned int index) const
+{
+	const unsigned short v = Visible.Get(player.Index, index);
+	return v >= 2 || (NoFogOfWar && v != 0);
+}
+
+/**
+**  Find out how a field is seen (By player, or by shared vision)
+**
+**  @param player   Player to check for.
+**  @param index    field to check.
+**  @note manage fogOfWar (using Map.NoFogOfWar)
+**
+**  @return        0 unexplored, 1 explored, 2 visible.
+*/
+unsigned char CMap::FieldTeamVisibilityState(const CPlayer &player, unsigned int index) const
+{
+	if (IsFieldVisible(player, index)) {
 		return 2;
 	}
 	unsigned char maxVision = 0;
-	if (IsExplored(player)) {
+	if (IsFieldExplored(player, index)) {
 		maxVision = 1;
 	}
-	
+
 	for (const int i : player.GetSharedVision()) {
 		if (player.HasMutualSharedVisionWith(Players[i])) {
-			maxVision = std::max<unsigned char>(maxVision, Visible[i]);
+			maxVision = std::max<unsigned char>(maxVision, Visible.Get(i, index));
 			if (maxVision >= 2) {
 				return 2;
 			}
 		}
 	}
 
-	if (maxVision == 1 && Map.NoFogOfWar) {
+	if (maxVision == 1 && NoFogOfWar) {
 		return 2;
 	}
 	return maxVision;
 }
 
-bool CMapFieldPlayerInfo::IsExplored(const CPlayer &player) const
-{
-	return Visible[player.Index] != 0;
-}
-
-bool CMapFieldPlayerInfo::IsVisible(const CPlayer &player) const
-{
-	const bool fogOfWar = !Map.NoFogOfWar;
-	return Visible[player.Index] >= 2 || (!fogOfWar && IsExplored(player));
-}
-
-bool CMapFieldPlayerInfo::IsTeamVisible(const CPlayer &player) const
-{
-	return TeamVisibilityState(player) == 2;
-}
-
 //@}
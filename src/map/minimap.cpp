@@ -381,8 +381,7 @@ void CMinimap::Update()
 			if (ReplayRevealMap) {
 				visiontype = 2;
 			} else {
-				const Vec2i tilePos(Minimap2MapX[mx], Minimap2MapY[my] / Map.Info.MapWidth);
-				visiontype = Map.Field(tilePos)->playerInfo.TeamVisibilityState(*ThisPlayer);
+				visiontype = Map.FieldTeamVisibilityState(*ThisPlayer, Minimap2MapX[mx] + Minimap2MapY[my]);
 			}
 
 			if (visiontype == 0 || (visiontype == 1 && ((mx & 1) != (my & 1)))) {
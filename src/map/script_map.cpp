@@ -89,7 +89,8 @@ static int CclStratagusMap(lua_State *l)
 					lua_pop(l, 1);
 
 					delete[] Map.Fields;
-					Map.Fields = new CMapField[Map.Info.MapWidth * Map.Info.MapHeight];
+					Map.Fields = NULL;
+					Map.Create();
 					// FIXME: this should be CreateMap or InitMap?
 				} else if (!strcmp(value, "fog-of-war")) {
 					Map.NoFogOfWar = false;
@@ -358,6 +359,100 @@ void SetTile(unsigned int tileIndex, const Vec2i &pos, int value)
 	}
 }
 
+/**
+**  Return the 6 bits of a base64 character, -1 for other characters.
+*/
+static int Base64Value(unsigned char c)
+{
+	if (c >= 'A' && c <= 'Z') {
+		return c - 'A';
+	} else if (c >= 'a' && c <= 'z') {
+		return c - 'a' + 26;
+	} else if (c >= '0' && c <= '9') {
+		return c - '0' + 52;
+	} else if (c == '+') {
+		return 62;
+	} else if (c == '/') {
+		return 63;
+	}
+	return -1;
+}
+
+/**
+**  Set all the tiles of the map at once.
+**
+**  The tiles are written by SaveStratagusMap as base64 encoded runs of
+**  4 bytes: the run length, the tile index (low byte first) and the
+**  tile value.  Whitespace and padding in the string are ignored.
+**
+**  @param l  Lua state.
+*/
+static int CclSetTileMap(lua_State *l)
+{
+	LuaCheckArgs(l, 3);
+
+	const int width = LuaToNumber(l, 1);
+	const int height = LuaToNumber(l, 2);
+	size_t len;
+	const char *data = lua_tolstring(l, 3, &len);
+
+	if (!data) {
+		LuaError(l, "incorrect argument");
+	}
+	if (width != Map.Info.MapWidth || height != Map.Info.MapHeight) {
+		LuaError(l, "Tile map size %dx%d doesn't match the map size %dx%d" _C_
+				 width _C_ height _C_ Map.Info.MapWidth _C_ Map.Info.MapHeight);
+	}
+	if (!Map.Fields) {
+		return 0;
+	}
+
+	const CTileset &tileset = *Map.Tileset;
+	const unsigned int tileCount = tileset.getTileCount();
+	const int size = width * height;
+	unsigned char run[4];
+	int runPos = 0;
+	unsigned int bits = 0;
+	int nbits = 0;
+	int index = 0;
+
+	for (size_t i = 0; i < len; ++i) {
+		const int v = Base64Value(data[i]);
+		if (v == -1) {
+			continue;
+		}
+		bits = (bits << 6) | v;
+		nbits += 6;
+		if (nbits < 8) {
+			continue;
+		}
+		nbits -= 8;
+		run[runPos++] = (bits >> nbits) & 0xFF;
+		if (runPos < 4) {
+			continue;
+		}
+		runPos = 0;
+
+		const int count = run[0];
+		const unsigned int tileIndex = run[1] | (run[2] << 8);
+		const int value = run[3];
+
+		if (index + count > size) {
+			LuaError(l, "Tile map has more than %d tiles" _C_ size);
+		}
+		if (tileIndex >= tileCount) {
+			LuaError(l, "Invalid tile number: %d" _C_ tileIndex);
+		}
+		for (int j = 0; j < count; ++j, ++index) {
+			Map.Fields[index].setTileIndex(tileset, tileIndex, value);
+		}
+	}
+	if (index != size) {
+		LuaError(l, "Wrong tile map length: %d instead of %d" _C_ index _C_ size);
+	}
+	return 0;
+}
+
 /**
 **  Define the type of each player available for the map
 **
@@ -569,6 +664,7 @@ void MapCclRegister()
 
 	lua_register(Lua, "DefineTileset", CclDefineTileset);
 	lua_register(Lua, "SetTileFlags", CclSetTileFlags);
+	lua_register(Lua, "SetTileMap", CclSetTileMap);
 	lua_register(Lua, "BuildTilesetTables", CclBuildTilesetTables);
 
 	lua_register(Lua, "GetTileTerrainName", CclGetTileTerrainName);
@@ -330,6 +330,9 @@ int CalculateDamage(const CUnit &attacker, const CUnit &goal, const NumberDesc *
 	}
 	Assert(formula);
 
+	if (formula->e == ENumber_Dir) { // Folded when parsed.
+		return formula->D.Val;
+	}
 	UpdateUnitVariables(const_cast<CUnit &>(attacker));
 	UpdateUnitVariables(const_cast<CUnit &>(goal));
 	TriggerData.Attacker = const_cast<CUnit *>(&attacker);
@@ -1203,6 +1206,14 @@ void MissileActions()
 {
 	MissilesActionLoop(GlobalMissiles);
 	MissilesActionLoop(LocalMissiles);
+
+	// Only the global missiles are the same on all computers.
+	for (size_t i = 0; i != GlobalMissiles.size(); ++i) {
+		const Missile &missile = *GlobalMissiles[i];
+
+		SyncHashMix(SyncHashMissiles, (missile.position.x << 16) ^ missile.position.y);
+		SyncHashMix(SyncHashMissiles, (missile.TTL << 8) ^ missile.Damage);
+	}
 }
 
 /**
@@ -1301,6 +1312,24 @@ void SaveMissiles(CFile &file)
 	}
 }
 
+/**
+**  Write the global missiles one per line.
+**
+**  Only the fields which are hashed each cycle are written, so the
+**  output of two computers can be compared with diff after a desync.
+**
+**  @param file  Output file.
+*/
+void DumpGlobalMissiles(CFile &file)
+{
+	for (size_t i = 0; i != GlobalMissiles.size(); ++i) {
+		const Missile &missile = *GlobalMissiles[i];
+
+		file.printf("%d %s pos %d %d ttl %d damage %d\n", (int)i, missile.Type->Ident.c_str(),
+					missile.position.x, missile.position.y, missile.TTL, missile.Damage);
+	}
+}
+
 /**
 **  Initialize missile type.
 */
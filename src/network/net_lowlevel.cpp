@@ -517,6 +517,71 @@ int NetRecvUDP(Socket sockfd, void *buf, int len, unsigned long *hostFrom, int *
 	return l;
 }
 
+/**
+**  Receive all waiting messages from a UDP socket.
+**
+**  Waits for the first message, then takes the messages which are
+**  already there. Uses a single recvmmsg call where available.
+**
+**  @param sockfd     Socket
+**  @param bufs       Receive message buffers, maxCount buffers of len bytes.
+**  @param len        Length of each receive message buffer.
+**  @param maxCount   Max number of messages to receive.
+**  @param lens       Number of bytes placed in each buffer.
+**  @param hostsFrom  host of each sender.
+**  @param portsFrom  port of each sender.
+**
+**  @return Number of messages received, or -1 if failure.
+*/
+int NetRecvUDPBatch(Socket sockfd, unsigned char *bufs, int len, int maxCount,
+					int *lens, unsigned long *hostsFrom, int *portsFrom)
+{
+#ifdef HAVE_RECVMMSG
+	std::vector<struct mmsghdr> msgs(maxCount);
+	std::vector<struct iovec> iovecs(maxCount);
+	std::vector<struct sockaddr_in> addrs(maxCount);
+
+	memset(&msgs[0], 0, maxCount * sizeof(struct mmsghdr));
+	for (int i = 0; i != maxCount; ++i) {
+		iovecs[i].iov_base = bufs + i * len;
+		iovecs[i].iov_len = len;
+		msgs[i].msg_hdr.msg_iov = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+	}
+	int count;
+	do {
+		count = recvmmsg(sockfd, &msgs[0], maxCount, MSG_WAITFORONE, NULL);
+	} while (count == -1 && errno == EINTR);
+	if (count < 0) {
+		PrintFunction();
+		fprintf(stdout, "Could not read from UDP socket\n");
+		return -1;
+	}
+	for (int i = 0; i != count; ++i) {
+		lens[i] = msgs[i].msg_len;
+		hostsFrom[i] = addrs[i].sin_addr.s_addr;
+		portsFrom[i] = ntohs(addrs[i].sin_port);
+	}
+	return count;
+#else
+	int count = 0;
+	while (count != maxCount) {
+		if (count != 0 && NetSocketReady(sockfd, 0) <= 0) {
+			break;
+		}
+		const int l = NetRecvUDP(sockfd, bufs + count * len, len, &hostsFrom[count], &portsFrom[count]);
+		if (l < 0) {
+			return count != 0 ? count : -1;
+		}
+		lens[count] = l;
+		++count;
+	}
+	return count;
+#endif
+}
+
 /**
 **  Receive from a TCP socket.
 **
@@ -569,6 +634,67 @@ int NetSendUDP(Socket sockfd, unsigned long host, int port,
 	return sendto(sockfd, (sendtobuftype)buf, len, 0, (struct sockaddr *)&sock_addr, n);
 }
 
+/**
+**  Send the same message through a UDP socket to many hosts.
+**
+**  Uses a single sendmmsg call where available.
+**
+**  @param sockfd  Socket
+**  @param hosts   Hosts to send to (network byte order).
+**  @param ports   Ports of the hosts to send to.
+**  @param count   Number of hosts.
+**  @param buf     Send message buffer.
+**  @param len     Send message buffer length.
+**
+**  @return Number of messages sent.
+*/
+int NetSendUDPBatch(Socket sockfd, const unsigned long *hosts, const int *ports, int count,
+					const void *buf, int len)
+{
+#ifdef HAVE_SENDMMSG
+	if (count == 0) {
+		return 0;
+	}
+	std::vector<struct mmsghdr> msgs(count);
+	std::vector<struct sockaddr_in> addrs(count);
+	struct iovec iov;
+
+	iov.iov_base = const_cast<void *>(buf);
+	iov.iov_len = len;
+	memset(&msgs[0], 0, count * sizeof(struct mmsghdr));
+	memset(&addrs[0], 0, count * sizeof(struct sockaddr_in));
+	for (int i = 0; i != count; ++i) {
+		addrs[i].sin_addr.s_addr = hosts[i];
+		addrs[i].sin_port = htons(ports[i]);
+		addrs[i].sin_family = AF_INET;
+		msgs[i].msg_hdr.msg_iov = &iov;
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+	}
+	int sent = 0;
+	while (sent != count) {
+		const int res = sendmmsg(sockfd, &msgs[sent], count - sent, 0);
+		if (res <= 0) {
+			if (res == -1 && errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		sent += res;
+	}
+	return sent;
+#else
+	int sent = 0;
+	for (int i = 0; i != count; ++i) {
+		if (NetSendUDP(sockfd, hosts[i], ports[i], buf, len) >= 0) {
+			++sent;
+		}
+	}
+	return sent;
+#endif
+}
+
 /**
 **  Send through a TCP socket.
 **
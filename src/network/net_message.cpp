@@ -115,11 +115,11 @@ size_t serialize(unsigned char *buf, const std::string &s)
 size_t serialize(unsigned char *buf, const std::vector<unsigned char> &data)
 {
 	if (buf) {
-		if (data.empty()) {
-			return serialize16(buf, uint16_t(data.size()));
-		}
 		buf += serialize16(buf, uint16_t(data.size()));
-		memcpy(buf, &data[0], data.size());
+		// Empty data takes the same room, deserialize() expects it.
+		if (!data.empty()) {
+			memcpy(buf, &data[0], data.size());
+		}
 		buf += data.size();
 		//Wyrmgus start
 //		if ((data.size() & 0x03) != 0) {
@@ -180,11 +180,22 @@ size_t deserialize(const unsigned char *buf, std::string &s)
 	return 2 + (s.size() + 3);
 	//Wyrmgus end
 }
-size_t deserialize(const unsigned char *buf, std::vector<unsigned char> &data)
+/**
+**  Read a byte vector.
+**
+**  @return the bytes read, 0 if the size goes past end.
+*/
+size_t deserialize(const unsigned char *buf, const unsigned char *end, std::vector<unsigned char> &data)
 {
 	uint16_t size;
 
+	if (end - buf < 2) {
+		return 0;
+	}
 	buf += deserialize16(buf, &size);
+	if (end - buf < size) {
+		return 0;
+	}
 	data.assign(buf, buf + size);
 	//Wyrmgus start
 //	return 2 + ((data.size() + 3) & ~0x03); // round up to multiple of 4 for alignment.
@@ -349,7 +360,7 @@ CInitMessage_Hello::CInitMessage_Hello(const char *name) :
 	header(MessageInit_FromClient, ICMHello)
 {
 	strncpy_s(this->PlyName, sizeof(this->PlyName), name, _TRUNCATE);
-	this->Stratagus = StratagusVersion;
+	this->Stratagus = NetworkProtocolVersion;
 	this->Version = FileChecksums;
 }
 
@@ -413,7 +424,7 @@ void CInitMessage_Config::Deserialize(const unsigned char *p)
 CInitMessage_EngineMismatch::CInitMessage_EngineMismatch() :
 	header(MessageInit_FromServer, ICMEngineMismatch)
 {
-	this->Stratagus = StratagusVersion;
+	this->Stratagus = NetworkProtocolVersion;
 }
 
 const unsigned char *CInitMessage_EngineMismatch::Serialize() const
@@ -661,6 +672,11 @@ size_t CNetworkCommandSync::Serialize(unsigned char *buf) const
 	unsigned char *p = buf;
 	p += serialize32(p, this->syncSeed);
 	p += serialize32(p, this->syncHash);
+	p += serialize32(p, this->unitHash);
+	p += serialize32(p, this->missileHash);
+	p += serialize32(p, this->playerHash);
+	p += serialize32(p, this->sendTicks);
+	p += serialize32(p, this->echoTicks);
 	return p - buf;
 }
 
@@ -669,6 +685,11 @@ size_t CNetworkCommandSync::Deserialize(const unsigned char *buf)
 	const unsigned char *p = buf;
 	p += deserialize32(p, &this->syncSeed);
 	p += deserialize32(p, &this->syncHash);
+	p += deserialize32(p, &this->unitHash);
+	p += deserialize32(p, &this->missileHash);
+	p += deserialize32(p, &this->playerHash);
+	p += deserialize32(p, &this->sendTicks);
+	p += deserialize32(p, &this->echoTicks);
 	return p - buf;
 }
 
@@ -725,6 +746,147 @@ size_t CNetworkSelection::Size() const
 	return 2 + 2 + 2 * Units.size();
 }
 
+//
+// CNetworkRelayHeader
+//
+
+size_t CNetworkRelayHeader::Serialize(unsigned char *buf) const
+{
+	unsigned char *p = buf;
+
+	p += serialize8(p, uint8_t(MessageRelay));
+	p += serialize8(p, this->Subtype);
+	p += serialize32(p, this->Seq);
+	p += serialize32(p, this->Cycle);
+	return p - buf;
+}
+
+size_t CNetworkRelayHeader::Deserialize(const unsigned char *buf)
+{
+	const unsigned char *p = buf;
+	uint8_t type;
+
+	p += deserialize8(p, &type);
+	p += deserialize8(p, &this->Subtype);
+	p += deserialize32(p, &this->Seq);
+	p += deserialize32(p, &this->Cycle);
+	return p - buf;
+}
+
+//
+// CNetworkRelaySetup
+//
+
+CNetworkRelaySetup::CNetworkRelaySetup() : Game(0), MapUID(0), hostsCount(0)
+{
+	Header.Subtype = RelayMessageSetup;
+	memset(MapPath, 0, sizeof(MapPath));
+}
+
+size_t CNetworkRelaySetup::Serialize(unsigned char *buf) const
+{
+	unsigned char *p = buf;
+
+	p += Header.Serialize(p);
+	p += serialize32(p, this->Game);
+	p += serialize(p, MapPath);
+	p += serialize32(p, this->MapUID);
+	p += this->State.Serialize(p);
+	p += serialize8(p, this->hostsCount);
+	for (int i = 0; i != PlayerMax; ++i) {
+		p += this->hosts[i].Serialize(p);
+	}
+	return p - buf;
+}
+
+size_t CNetworkRelaySetup::Deserialize(const unsigned char *buf)
+{
+	const unsigned char *p = buf;
+
+	p += Header.Deserialize(p);
+	p += deserialize32(p, &this->Game);
+	p += deserialize(p, this->MapPath);
+	p += deserialize32(p, &this->MapUID);
+	p += this->State.Deserialize(p);
+	p += deserialize8(p, &this->hostsCount);
+	for (int i = 0; i != PlayerMax; ++i) {
+		p += this->hosts[i].Deserialize(p);
+	}
+	return p - buf;
+}
+
+//
+// CNetworkRelayCycle
+//
+
+size_t CNetworkRelayCycle::CommandSize(const CNetworkRelayCommand &command)
+{
+	return 1 + 1 + 2 + command.Data.size();
+}
+
+size_t CNetworkRelayCycle::Serialize(unsigned char *buf) const
+{
+	unsigned char *p = buf;
+
+	p += Header.Serialize(p);
+	p += serialize8(p, this->More);
+	p += serialize8(p, uint8_t(this->Commands.size()));
+	for (size_t i = 0; i != this->Commands.size(); ++i) {
+		const CNetworkRelayCommand &command = this->Commands[i];
+
+		p += serialize8(p, command.Player);
+		p += serialize8(p, command.Type);
+		p += serialize16(p, uint16_t(command.Data.size()));
+		if (!command.Data.empty()) {
+			memcpy(p, &command.Data[0], command.Data.size());
+		}
+		p += command.Data.size();
+	}
+	return p - buf;
+}
+
+size_t CNetworkRelayCycle::Deserialize(const unsigned char *buf, unsigned int len)
+{
+	const unsigned char *p = buf;
+	const unsigned char *end = buf + len;
+	uint8_t count;
+
+	if (len < CNetworkRelayHeader::Size() + 1 + 1) {
+		return 0;
+	}
+	p += Header.Deserialize(p);
+	p += deserialize8(p, &this->More);
+	p += deserialize8(p, &count);
+	this->Commands.resize(count);
+	for (int i = 0; i != count; ++i) {
+		CNetworkRelayCommand &command = this->Commands[i];
+		uint16_t size;
+
+		if (end - p < 1 + 1 + 2) {
+			return 0;
+		}
+		p += deserialize8(p, &command.Player);
+		p += deserialize8(p, &command.Type);
+		p += deserialize16(p, &size);
+		if (end - p < size) {
+			return 0;
+		}
+		command.Data.assign(p, p + size);
+		p += size;
+	}
+	return p - buf;
+}
+
+size_t CNetworkRelayCycle::Size() const
+{
+	size_t size = CNetworkRelayHeader::Size() + 1 + 1;
+
+	for (size_t i = 0; i != this->Commands.size(); ++i) {
+		size += CommandSize(this->Commands[i]);
+	}
+	return size;
+}
+
 //
 // CNetworkPacketHeader
 //
@@ -757,6 +919,162 @@ size_t CNetworkPacketHeader::Deserialize(const unsigned char *buf)
 // CNetworkPacket
 //
 
+/// Encoding of a repeated command
+enum _network_delta_ {
+	NetworkDeltaLiteral,  /// Size and data follow
+	NetworkDeltaSame,     /// Same data as the reference command
+	NetworkDeltaXor       /// Runs of unchanged bytes and of bytes xored with the reference command
+};
+
+/**
+**  Append a command delta encoded against a reference command.
+**
+**  @param out   Output bytes.
+**  @param type  Type of the command.
+**  @param data  Data of the command.
+**  @param ref   Data of the reference command, NULL if it has another type.
+*/
+static void EncodeDelta(std::vector<unsigned char> &out, uint8_t type,
+						const std::vector<unsigned char> &data, const std::vector<unsigned char> *ref)
+{
+	out.push_back(type);
+	if (ref == NULL || ref->size() != data.size()) {
+		out.push_back(NetworkDeltaLiteral);
+		out.push_back(uint8_t(data.size() >> 8));
+		out.push_back(uint8_t(data.size()));
+		out.insert(out.end(), data.begin(), data.end());
+		return;
+	}
+	if (data == *ref) {
+		out.push_back(NetworkDeltaSame);
+		return;
+	}
+	out.push_back(NetworkDeltaXor);
+	for (size_t i = 0; i != data.size(); /* empty */) {
+		uint8_t same = 0;
+		while (i != data.size() && same != 255 && data[i] == (*ref)[i]) {
+			++same;
+			++i;
+		}
+		const size_t start = i;
+		while (i != data.size() && i - start != 255 && data[i] != (*ref)[i]) {
+			++i;
+		}
+		out.push_back(same);
+		out.push_back(uint8_t(i - start));
+		for (size_t j = start; j != i; ++j) {
+			out.push_back(data[j] ^ (*ref)[j]);
+		}
+	}
+}
+
+/**
+**  Read a command delta encoded against a reference command.
+**
+**  @param p     Input bytes, moved past the command.
+**  @param end   End of the input bytes.
+**  @param type  Type of the command.
+**  @param data  Data of the command.
+**  @param ref   Data of the reference command, NULL if it has another type.
+**
+**  @return false if the input is bad.
+*/
+static bool DecodeDelta(const unsigned char *&p, const unsigned char *end, uint8_t *type,
+						std::vector<unsigned char> &data, const std::vector<unsigned char> *ref)
+{
+	if (end - p < 2) {
+		return false;
+	}
+	*type = *p++;
+	const uint8_t mode = *p++;
+	switch (mode) {
+		case NetworkDeltaLiteral: {
+			if (end - p < 2) {
+				return false;
+			}
+			const size_t size = (p[0] << 8) | p[1];
+			p += 2;
+			if (size_t(end - p) < size) {
+				return false;
+			}
+			data.assign(p, p + size);
+			p += size;
+			return true;
+		}
+		case NetworkDeltaSame:
+			if (ref == NULL) {
+				return false;
+			}
+			data = *ref;
+			return true;
+		case NetworkDeltaXor:
+			if (ref == NULL) {
+				return false;
+			}
+			data = *ref;
+			for (size_t i = 0; i != data.size(); /* empty */) {
+				if (end - p < 2) {
+					return false;
+				}
+				const size_t same = *p++;
+				const size_t changed = *p++;
+				if (same + changed == 0 || i + same + changed > data.size() || size_t(end - p) < changed) {
+					return false;
+				}
+				i += same;
+				for (size_t j = 0; j != changed; ++j, ++i) {
+					data[i] ^= *p++;
+				}
+			}
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+**  Delta encode the previous packets added since the last call, each
+**  against the newer one.
+**
+**  Size and Serialize use the encoded bytes, so that a packet filled one
+**  previous packet at a time is encoded only once.
+**
+**  @param numcommands  Number of commands of the packet itself.
+*/
+void CNetworkPacket::EncodePrevious(int numcommands)
+{
+	if (this->EncodedCount > this->PreviousCount) {
+		this->EncodedCount = this->PreviousCount;
+		this->EncodedPrevious.resize(this->PreviousCount == 0 ? 0 : this->EncodedEnd[this->PreviousCount - 1]);
+	}
+	for (int k = this->EncodedCount; k != this->PreviousCount; ++k) {
+		const CNetworkPacketHeader &newerHeader = k == 0 ? this->Header : this->PreviousHeader[k - 1];
+		const std::vector<unsigned char> *newerCommand = k == 0 ? this->Command : this->PreviousCommand[k - 1];
+		const int newerCount = k == 0 ? numcommands : PreviousCommandCount(k - 1);
+		const int count = PreviousCommandCount(k);
+
+		this->EncodedPrevious.push_back(this->PreviousHeader[k].Cycle);
+		this->EncodedPrevious.push_back(uint8_t(count));
+		for (int i = 0; i != count; ++i) {
+			const uint8_t type = this->PreviousHeader[k].Type[i];
+			const bool sameType = i < newerCount && newerHeader.Type[i] == type;
+
+			EncodeDelta(this->EncodedPrevious, type, this->PreviousCommand[k][i], sameType ? &newerCommand[i] : NULL);
+		}
+		this->EncodedEnd[k] = this->EncodedPrevious.size();
+	}
+	this->EncodedCount = this->PreviousCount;
+}
+
+int CNetworkPacket::PreviousCommandCount(int index) const
+{
+	int count = 0;
+	while (count != MaxNetworkCommands && this->PreviousHeader[index].Type[count] != MessageNone) {
+		++count;
+	}
+	return count;
+}
+
 size_t CNetworkPacket::Serialize(unsigned char *buf, int numcommands) const
 {
 	unsigned char *p = buf;
@@ -765,19 +1083,74 @@ size_t CNetworkPacket::Serialize(unsigned char *buf, int numcommands) const
 	for (int i = 0; i != numcommands; ++i) {
 		p += serialize(p, this->Command[i]);
 	}
+	if (this->PreviousCount != 0) {
+		Assert(this->EncodedCount >= this->PreviousCount);
+		const size_t size = this->EncodedEnd[this->PreviousCount - 1];
+
+		*p++ = uint8_t(this->PreviousCount);
+		memcpy(p, &this->EncodedPrevious[0], size);
+		p += size;
+	}
 	return p - buf;
 }
 
 void CNetworkPacket::Deserialize(const unsigned char *p, unsigned int len, int *commandCount)
 {
+	const unsigned char *end = p + len;
+
 	this->Header.Deserialize(p);
 	p += CNetworkPacketHeader::Size();
-	len -= CNetworkPacketHeader::Size();
+	this->PreviousCount = 0;
+	this->EncodedCount = 0;
+	this->EncodedPrevious.clear();
+
+	for (*commandCount = 0; *commandCount != MaxNetworkCommands && p < end; ++*commandCount) {
+		if (this->Header.Type[*commandCount] == MessageNone) {
+			break;
+		}
+		const size_t size = deserialize(p, end, this->Command[*commandCount]);
+		if (size == 0) {
+			*commandCount = -1;
+			return;
+		}
+		p += size;
+	}
+	if (p > end) {
+		*commandCount = -1;
+		return;
+	}
+	if (p == end) {
+		return;
+	}
+	// Previous packets
+	const int previousCount = *p++;
+	for (int k = 0; k != previousCount && k != MaxNetworkRedundancy; ++k) {
+		const CNetworkPacketHeader &newerHeader = k == 0 ? this->Header : this->PreviousHeader[k - 1];
+		const std::vector<unsigned char> *newerCommand = k == 0 ? this->Command : this->PreviousCommand[k - 1];
+		const int newerCount = k == 0 ? *commandCount : PreviousCommandCount(k - 1);
+		CNetworkPacketHeader &header = this->PreviousHeader[k];
+
+		if (end - p < 2) {
+			return;
+		}
+		header.Cycle = *p++;
+		header.OrigPlayer = this->Header.OrigPlayer;
+		const int count = *p++;
+		if (count > MaxNetworkCommands) {
+			return;
+		}
+		for (int i = 0; i != MaxNetworkCommands; ++i) {
+			header.Type[i] = MessageNone;
+		}
+		for (int i = 0; i != count; ++i) {
+			const bool sameType = i < newerCount && p < end && newerHeader.Type[i] == *p;
 
-	for (*commandCount = 0; len != 0; ++*commandCount) {
-		const size_t r = deserialize(p, this->Command[*commandCount]);
-		p += r;
-		len -= r;
+			if (DecodeDelta(p, end, &header.Type[i], this->PreviousCommand[k][i], sameType ? &newerCommand[i] : NULL) == false
+				|| header.Type[i] == MessageNone) {
+				return;
+			}
+		}
+		this->PreviousCount = k + 1;
 	}
 }
 
@@ -789,6 +1162,10 @@ size_t CNetworkPacket::Size(int numcommands) const
 	for (int i = 0; i != numcommands; ++i) {
 		size += serialize(NULL, this->Command[i]);
 	}
+	if (this->PreviousCount != 0) {
+		Assert(this->EncodedCount >= this->PreviousCount);
+		size += 1 + this->EncodedEnd[this->PreviousCount - 1];
+	}
 	return size;
 }
 
@@ -48,6 +48,8 @@
 #include "version.h"
 #include "video.h"
 
+#include <time.h>
+
 //----------------------------------------------------------------------------
 // Declaration
 //----------------------------------------------------------------------------
@@ -884,8 +886,8 @@ void CClient::Parse_EngineMismatch(const unsigned char *buf)
 
 	msg.Deserialize(buf);
 	const std::string serverHostStr = serverHost.toString();
-	fprintf(stderr, "Incompatible Stratagus version %d <-> %d\nfrom %s\n",
-			StratagusVersion, msg.Stratagus, serverHostStr.c_str());
+	fprintf(stderr, "Incompatible network protocol " NetworkProtocolFormatString " <-> " NetworkProtocolFormatString "\nfrom %s\n",
+			NetworkProtocolFormatArgs(NetworkProtocolVersion), NetworkProtocolFormatArgs(msg.Stratagus), serverHostStr.c_str());
 	networkState.State = ccs_incompatibleengine;
 }
 
@@ -1290,10 +1292,10 @@ void CServer::Parse_SeeYou(const int h)
 */
 static int CheckVersions(const CInitMessage_Hello &msg, CUDPSocket &socket, const CHost &host)
 {
-	if (msg.Stratagus != StratagusVersion) {
+	if (msg.Stratagus != NetworkProtocolVersion) {
 		const std::string hostStr = host.toString();
-		fprintf(stderr, "Incompatible Stratagus version %d <-> %d from %s\n",
-				StratagusVersion, msg.Stratagus, hostStr.c_str());
+		fprintf(stderr, "Incompatible network protocol " NetworkProtocolFormatString " <-> " NetworkProtocolFormatString " from %s\n",
+				NetworkProtocolFormatArgs(NetworkProtocolVersion), NetworkProtocolFormatArgs(msg.Stratagus), hostStr.c_str());
 
 		const CInitMessage_EngineMismatch message;
 		NetworkSendICMessage_Log(socket, host, message);
@@ -1746,6 +1748,70 @@ void NetworkDetachFromServer()
 	Client.DetachFromServer();
 }
 
+/**
+** Fill the game setup the server sends to the observer relay.
+**
+** The host addresses are left out, observers only talk to the relay.
+**
+** @param setup  Setup to fill.
+*/
+void NetworkFillRelaySetup(CNetworkRelaySetup &setup)
+{
+	// Not from SyncRand, which must stay the same on all the peers.
+	setup.Game = (uint32_t)time(NULL) ^ (uint32_t)(GetTicks() << 16);
+	strncpy_s(setup.MapPath, sizeof(setup.MapPath), NetworkMapName.c_str(), _TRUNCATE);
+	setup.MapUID = Map.Info.MapUID;
+	setup.State = ServerSetupState;
+	setup.hostsCount = 0;
+	for (int i = 0; i < HostsCount; ++i) {
+		setup.hosts[setup.hostsCount].PlyNr = Hosts[i].PlyNr;
+		setup.hosts[setup.hostsCount].SetName(Hosts[i].PlyName);
+		++setup.hostsCount;
+	}
+	// server is last:
+	setup.hosts[setup.hostsCount].PlyNr = NetLocalPlayerNumber;
+	setup.hosts[setup.hostsCount].SetName(Parameters::Instance.LocalPlayerName.c_str());
+	++setup.hostsCount;
+}
+
+/**
+** Setup the game of an observer from the setup sent by the relay.
+**
+** The observer sees the game as the server player.
+**
+** @param setup  Setup received from the relay.
+**
+** @return true if the map is safe and matches.
+*/
+bool NetworkSetupObserverGame(const CNetworkRelaySetup &setup)
+{
+	if (!IsSafeMapName(setup.MapPath)) {
+		fprintf(stderr, "Unsecure map name!\n");
+		return false;
+	}
+	if (setup.hostsCount == 0 || setup.hostsCount > PlayerMax) {
+		fprintf(stderr, "Bad observer setup, %d hosts\n", setup.hostsCount);
+		return false;
+	}
+	NetworkMapName = std::string(setup.MapPath, strnlen(setup.MapPath, sizeof(setup.MapPath)));
+	const std::string mappath = StratagusLibPath + "/" + NetworkMapName;
+	LoadStratagusMapInfo(mappath);
+	if (setup.MapUID != Map.Info.MapUID) {
+		fprintf(stderr, "Stratagus maps do not match (0x%08x) <-> (0x%08x)\n",
+				Map.Info.MapUID, static_cast<unsigned int>(setup.MapUID));
+		return false;
+	}
+	ServerSetupState = setup.State;
+	LocalSetupState = setup.State;
+	HostsCount = 0;
+	for (int i = 0; i != setup.hostsCount; ++i) {
+		Hosts[HostsCount++] = setup.hosts[i];
+	}
+	NetPlayers = HostsCount;
+	NetLocalPlayerNumber = Hosts[HostsCount - 1].PlyNr;
+	return true;
+}
+
 /**
 ** Setup Network connect state machine for the server
 */
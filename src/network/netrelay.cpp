@@ -0,0 +1,375 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name netrelay.cpp - The observer relay. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+//----------------------------------------------------------------------------
+//  Documentation
+//----------------------------------------------------------------------------
+
+/**
+** @page NetworkModule Module - Network
+**
+** @section Observer relay
+**
+** Observers do not join the game as hosts. The server sends the commands
+** it executes, once per update, to a relay. The relay keeps the whole
+** stream and sends it to every observer, held back by a delay so that
+** the observers can not give information to the players. Observers run
+** the simulation with these commands like any other peer, but never send
+** commands. All the players' peers see is one more packet per update on
+** the server.
+**
+** The stream starts with the game setup, then holds an entry per update
+** cycle, even without commands, so that the observers know how far they
+** can go. Every receiver acks the number of entries it has, which is also
+** how observers subscribe to the relay; unacked entries are sent again.
+**
+** The relay only takes the stream from the server given on its command
+** line. A new setup from that server, which is not a resend of the one
+** the relay has, starts a new game: the stream of the old game and its
+** observers are dropped.
+*/
+
+//----------------------------------------------------------------------------
+//  Includes
+//----------------------------------------------------------------------------
+
+#include "stratagus.h"
+
+#include "network/netrelay.h"
+
+#include "net_lowlevel.h"
+#include "net_message.h"
+#include "video.h"
+
+#include <stdio.h>
+
+//----------------------------------------------------------------------------
+//  Declaration
+//----------------------------------------------------------------------------
+
+#define NETWORK_RELAY_WINDOW 32          /// Max entries sent and not acked
+#define NETWORK_RELAY_RESEND_TICKS 500   /// Ticks without ack before sending again
+#define NETWORK_RELAY_TIMEOUT_TICKS 30000  /// Ticks without ack before dropping an observer
+#define NETWORK_RELAY_RECV_BATCH 16      /// Max messages read at once
+
+//----------------------------------------------------------------------------
+//  CNetworkRelayStream
+//----------------------------------------------------------------------------
+
+void CNetworkRelayStream::Clear()
+{
+	Entries.clear();
+	Cycles.clear();
+}
+
+void CNetworkRelayStream::Add(const unsigned char *buf, unsigned int len, uint32_t cycle)
+{
+	Entries.push_back(std::vector<unsigned char>(buf, buf + len));
+	Cycles.push_back(cycle);
+}
+
+bool CNetworkRelayStream::IsSameEntry(uint32_t seq, const unsigned char *buf, unsigned int len) const
+{
+	const std::vector<unsigned char> &entry = Entries[seq];
+
+	return entry.size() == len && memcmp(&entry[0], buf, len) == 0;
+}
+
+//----------------------------------------------------------------------------
+//  CNetworkRelayPeer
+//----------------------------------------------------------------------------
+
+CNetworkRelayPeer::CNetworkRelayPeer(const CHost &host, unsigned long ticks) :
+	Host(host), Acked(0), Sent(0), LastAckTicks(ticks), LastProgressTicks(ticks)
+{
+}
+
+void CNetworkRelayPeer::Ack(uint32_t next, unsigned long ticks)
+{
+	LastAckTicks = ticks;
+	if (next <= Acked) {
+		return;
+	}
+	Acked = next;
+	LastProgressTicks = ticks;
+	if (Sent < Acked) {
+		Sent = Acked;
+	}
+}
+
+void CNetworkRelayPeer::CheckResend(unsigned long ticks)
+{
+	if (Sent > Acked && ticks - LastProgressTicks >= NETWORK_RELAY_RESEND_TICKS) {
+		Sent = Acked;
+		LastProgressTicks = ticks;
+	}
+}
+
+bool CNetworkRelayPeer::CanSend(uint32_t end) const
+{
+	return Sent < end && Sent < Acked + NETWORK_RELAY_WINDOW;
+}
+
+void CNetworkRelayPeer::Send(CUDPSocket &socket, const CNetworkRelayStream &stream, uint32_t end, unsigned long ticks)
+{
+	CheckResend(ticks);
+	for (; CanSend(end); ++Sent) {
+		const std::vector<unsigned char> &entry = stream.GetEntry(Sent);
+		socket.Send(Host, &entry[0], entry.size());
+	}
+}
+
+bool CNetworkRelayPeer::IsTimedOut(unsigned long ticks) const
+{
+	return ticks - LastAckTicks >= NETWORK_RELAY_TIMEOUT_TICKS;
+}
+
+//----------------------------------------------------------------------------
+//  CNetworkRelay
+//----------------------------------------------------------------------------
+
+/**
+**  Open the relay endpoint.
+**
+**  @param host    Local address and port of the relay.
+**  @param delay   Number of game cycles the observers are behind the game.
+**  @param source  Server which sends the stream, port 0 for any port.
+*/
+bool CNetworkRelay::Open(const CHost &host, unsigned int delay, const CHost &source)
+{
+	if (!Socket.Open(host)) {
+		return false;
+	}
+	Delay = delay;
+	Source = source;
+	HasSource = false;
+	SourceHeard = false;
+	Stream.Clear();
+	Released = 0;
+	Observers.clear();
+	return true;
+}
+
+void CNetworkRelay::Close()
+{
+	Socket.Close();
+	Observers.clear();
+}
+
+/**
+**  Is host the server allowed to send the stream.
+*/
+bool CNetworkRelay::IsSource(const CHost &host) const
+{
+	return host.getIp() == Source.getIp() && (Source.getPort() == 0 || host.getPort() == Source.getPort());
+}
+
+/**
+**  Parse a message of the source or of an observer.
+*/
+void CNetworkRelay::Parse(const unsigned char *buf, int len, const CHost &host, unsigned long ticks)
+{
+	if (len < (int)CNetworkRelayHeader::Size() || buf[0] != MessageRelay) {
+		return;
+	}
+	CNetworkRelayHeader header;
+	header.Deserialize(buf);
+
+	switch (header.Subtype) {
+		case RelayMessageSetup:
+		case RelayMessageCycle:
+			if (!IsSource(host)) {
+				return;
+			}
+			if (header.Subtype == RelayMessageSetup && header.Seq == 0
+				&& Stream.GetSize() != 0 && !Stream.IsSameEntry(0, buf, len)) {
+				DebugPrint("New game from %s\n" _C_ host.toString().c_str());
+				Stream.Clear();
+				Released = 0;
+				Observers.clear();
+			}
+			SourceHost = host;
+			HasSource = true;
+			SourceHeard = true;
+			if (header.Seq != Stream.GetSize() || (header.Seq == 0) != (header.Subtype == RelayMessageSetup)) {
+				return;
+			}
+			Stream.Add(buf, len, header.Cycle);
+			break;
+		case RelayMessageAck: {
+			size_t i = 0;
+			while (i != Observers.size() && Observers[i].Host != host) {
+				++i;
+			}
+			if (i == Observers.size()) {
+				if (IsSource(host)) {
+					return;
+				}
+				Observers.push_back(CNetworkRelayPeer(host, ticks));
+				DebugPrint("Observer %s subscribed\n" _C_ host.toString().c_str());
+			}
+			Observers[i].Ack(std::min(header.Seq, Released), ticks);
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+/**
+**  Send the released entries to the observers.
+**
+**  Observers which are in step get each entry with a single batch send.
+*/
+void CNetworkRelay::SendEntries(unsigned long ticks)
+{
+	std::vector<CHost> hosts;
+	std::vector<CNetworkRelayPeer *> peers;
+
+	for (size_t i = 0; i != Observers.size(); ++i) {
+		Observers[i].CheckResend(ticks);
+	}
+	for (;;) {
+		uint32_t seq = Released;
+		for (size_t i = 0; i != Observers.size(); ++i) {
+			if (Observers[i].CanSend(Released)) {
+				seq = std::min(seq, Observers[i].Sent);
+			}
+		}
+		if (seq == Released) {
+			break;
+		}
+		hosts.clear();
+		peers.clear();
+		for (size_t i = 0; i != Observers.size(); ++i) {
+			if (Observers[i].Sent == seq && Observers[i].CanSend(Released)) {
+				hosts.push_back(Observers[i].Host);
+				peers.push_back(&Observers[i]);
+			}
+		}
+		const std::vector<unsigned char> &entry = Stream.GetEntry(seq);
+		Socket.SendBatch(&hosts[0], hosts.size(), &entry[0], entry.size());
+		for (size_t i = 0; i != peers.size(); ++i) {
+			++peers[i]->Sent;
+		}
+	}
+}
+
+/**
+**  Receive the waiting messages of the source and of the observers,
+**  ack the source and send the entries due to the observers.
+**
+**  The source is acked each time it sent something, even entries the
+**  relay already has, so that a lost ack doesn't stop it.
+**
+**  @param ticks  Current ticks in milliseconds.
+*/
+void CNetworkRelay::Update(unsigned long ticks)
+{
+	unsigned char bufs[NETWORK_RELAY_RECV_BATCH][MaxNetworkRelaySize];
+	int lens[NETWORK_RELAY_RECV_BATCH];
+	CHost hosts[NETWORK_RELAY_RECV_BATCH];
+
+	while (Socket.HasDataToRead(0) > 0) {
+		const int count = Socket.RecvBatch(&bufs[0][0], MaxNetworkRelaySize, NETWORK_RELAY_RECV_BATCH, lens, hosts);
+		if (count <= 0) {
+			break;
+		}
+		for (int i = 0; i != count; ++i) {
+			Parse(bufs[i], lens[i], hosts[i], ticks);
+		}
+	}
+	if (HasSource && SourceHeard) {
+		CNetworkRelayHeader ack;
+		unsigned char buf[32];
+
+		ack.Seq = Stream.GetSize();
+		Socket.Send(SourceHost, buf, ack.Serialize(buf));
+		SourceHeard = false;
+	}
+	// The setup goes out at once, the commands after the delay.
+	const uint32_t size = Stream.GetSize();
+	if (Released == 0 && size != 0) {
+		Released = 1;
+	}
+	if (size > 1) {
+		const uint32_t lastCycle = Stream.GetCycle(size - 1);
+		while (Released < size && Stream.GetCycle(Released) + Delay <= lastCycle) {
+			++Released;
+		}
+	}
+	for (size_t i = 0; i != Observers.size();) {
+		if (Observers[i].IsTimedOut(ticks)) {
+			DebugPrint("Observer %s timed out\n" _C_ Observers[i].Host.toString().c_str());
+			Observers.erase(Observers.begin() + i);
+		} else {
+			++i;
+		}
+	}
+	SendEntries(ticks);
+}
+
+/**
+**  Run a dedicated observer relay.
+**
+**  @param port    Port of the relay.
+**  @param delay   Number of game cycles the observers are behind the game.
+**  @param source  Server which sends the stream, as host[:port].
+**
+**  @return -1 if the relay can not be opened.
+*/
+int RunNetworkRelay(int port, unsigned int delay, const std::string &source)
+{
+	NetInit();
+
+	const size_t sep = source.find(':');
+	const int sourcePort = sep == std::string::npos ? 0 : atoi(source.c_str() + sep + 1);
+	const CHost sourceHost(source.substr(0, sep).c_str(), sourcePort);
+	if (sourceHost.getIp() == 0) {
+		fprintf(stderr, "NETWORK: Unknown server \"%s\" for the relay, aborting\n", source.c_str());
+		NetExit();
+		return -1;
+	}
+	CNetworkRelay relay;
+	const CHost host((const char *)NULL, port);
+	if (!relay.Open(host, delay, sourceHost)) {
+		fprintf(stderr, "NETWORK: No free port %d available, aborting\n", port);
+		NetExit();
+		return -1;
+	}
+	printf("Observer relay on port %d for %s, delay %u cycles\n", port, sourceHost.toString().c_str(), delay);
+	for (;;) {
+		relay.HasDataToRead(100);
+		relay.Update(GetTicks());
+	}
+}
+
+//@}
@@ -82,6 +82,8 @@ public:
 		*hostFrom = CHost(ip, port);
 		return res;
 	}
+	int SendBatch(const CHost *hosts, int count, const void *buf, unsigned int len);
+	int RecvBatch(unsigned char *bufs, int len, int maxCount, int *lens, CHost *hostsFrom);
 	void SetNonBlocking() { NetSetNonBlocking(socket); }
 	int HasDataToRead(int timeout) { return NetSocketReady(socket, timeout); }
 	bool IsValid() const { return socket != Socket(-1); }
@@ -90,6 +92,30 @@ private:
 	Socket socket;
 };
 
+int CUDPSocket_Impl::SendBatch(const CHost *hosts, int count, const void *buf, unsigned int len)
+{
+	std::vector<unsigned long> ips(count);
+	std::vector<int> ports(count);
+
+	for (int i = 0; i != count; ++i) {
+		ips[i] = hosts[i].getIp();
+		ports[i] = hosts[i].getPort();
+	}
+	return NetSendUDPBatch(socket, count ? &ips[0] : NULL, count ? &ports[0] : NULL, count, buf, len);
+}
+
+int CUDPSocket_Impl::RecvBatch(unsigned char *bufs, int len, int maxCount, int *lens, CHost *hostsFrom)
+{
+	std::vector<unsigned long> ips(maxCount);
+	std::vector<int> ports(maxCount);
+
+	const int res = NetRecvUDPBatch(socket, bufs, len, maxCount, lens, &ips[0], &ports[0]);
+	for (int i = 0; i < res; ++i) {
+		hostsFrom[i] = CHost(ips[i], ports[i]);
+	}
+	return res;
+}
+
 //
 // CUDPSocket
 //
@@ -111,6 +137,10 @@ void CUDPSocket::CStatistic::clear()
 	sentPacketsCount = 0;
 	biggestReceivedPacketSize = 0;
 	biggestSentPacketSize = 0;
+	sentBatchCount = 0;
+	receivedBatchCount = 0;
+	biggestSentBatchSize = 0;
+	biggestReceivedBatchSize = 0;
 }
 
 #endif
@@ -161,6 +191,50 @@ int CUDPSocket::Recv(void *buf, int len, CHost *hostFrom)
 	return res;
 }
 
+/**
+**  Send the same message to all the hosts, in one system call where
+**  the system supports it.
+*/
+void CUDPSocket::SendBatch(const CHost *hosts, int count, const void *buf, unsigned int len)
+{
+	const int sent = m_impl->SendBatch(hosts, count, buf, len);
+#ifdef DEBUG
+	++m_statistic.sentBatchCount;
+	m_statistic.sentPacketsCount += sent;
+	m_statistic.sentBytesCount += sent * len;
+	m_statistic.biggestSentPacketSize = std::max(m_statistic.biggestSentPacketSize, len);
+	m_statistic.biggestSentBatchSize = std::max(m_statistic.biggestSentBatchSize, (unsigned int)sent);
+#else
+	(void)sent;
+#endif
+}
+
+/**
+**  Receive the waiting messages, in one system call where the system
+**  supports it. Waits for the first message.
+**
+**  @return the number of messages received or -1 if failure.
+*/
+int CUDPSocket::RecvBatch(unsigned char *bufs, int len, int maxCount, int *lens, CHost *hostsFrom)
+{
+	const int res = m_impl->RecvBatch(bufs, len, maxCount, lens, hostsFrom);
+#ifdef DEBUG
+	++m_statistic.receivedBatchCount;
+	m_statistic.receivedBytesExpectedCount += len * maxCount;
+	if (res == -1) {
+		++m_statistic.receivedErrorCount;
+	} else {
+		m_statistic.receivedPacketsCount += res;
+		for (int i = 0; i != res; ++i) {
+			m_statistic.receivedBytesCount += lens[i];
+			m_statistic.biggestReceivedPacketSize = std::max(m_statistic.biggestReceivedPacketSize, (unsigned int)lens[i]);
+		}
+		m_statistic.biggestReceivedBatchSize = std::max(m_statistic.biggestReceivedBatchSize, (unsigned int)res);
+	}
+#endif
+	return res;
+}
+
 void CUDPSocket::SetNonBlocking()
 {
 	m_impl->SetNonBlocking();
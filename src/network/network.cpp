@@ -143,9 +143,22 @@
 ** are received for a specified gameNetCycle, all commands of this gameNetCycle
 ** Each gameNetCycle, a package must be send. if there is no user command,
 ** a "dummy" sync package is send (which checks that all players are still in sync).
-** If there are missing packages, the game is paused and old commands
+** Each package also repeats the commands of the previous packages of the
+** sender, so a single lost package is filled in from the next one.
+** If there are still missing packages, the game is paused and old commands
 ** are resend to all clients.
 **
+** The server measures the round trip time and its jitter to each client
+** from the sync packages: it stamps its own ones with its ticks and the
+** clients echo the last ticks they got. From time to time it sends an
+** extended command with a new lag and update interval. Like any other
+** command it is executed at the same game cycle on all computers, and the
+** new values apply to the game cycles after the last one already sent.
+**
+** Observers are not hosts of the game: the server sends the commands it
+** executes to an observer relay, which passes them on to the observers
+** (see netrelay.cpp).
+**
 ** @section missing What features are missing
 **
 ** @li The recover from lost packets can be improved, as the player knows
@@ -156,11 +169,7 @@
 **
 ** @li Add a server/client protocol, which allows more players per game.
 **
-** @li Lag (latency) and bandwidth should be automatic detected during game setup
-** and later during game automatic adapted.
-**
-** @li Also it would be nice, if we support viewing clients. This means
-** other people can view the game in progress.
+** @li Lag (latency) and bandwidth should be automatic detected during game setup.
 **
 ** @li The current protocol only uses single cast, for local LAN we
 ** should also support broadcast and multicast.
@@ -213,6 +222,12 @@
 **
 ** ::NetworkQuitGame()
 ** Warn other users that we leave.
+**
+** ::NetworkSetupRelayAddress()
+** Server: send the game to an observer relay.
+**
+** ::NetworkObserve()
+** Observe a game through an observer relay, instead of joining it.
 */
 
 //----------------------------------------------------------------------------
@@ -228,11 +243,16 @@
 
 #include "actions.h"
 #include "commands.h"
+#include "game.h"
 #include "interface.h"
+#include "iocompat.h"
+#include "iolib.h"
 #include "map.h"
+#include "missile.h"
 #include "net_lowlevel.h"
 #include "net_message.h"
 #include "netconnect.h"
+#include "network/netrelay.h"
 #include "parameters.h"
 #include "player.h"
 #include "replay.h"
@@ -282,12 +302,15 @@ CNetworkParameter::CNetworkParameter()
 	gameCyclesPerUpdate = 1;
 	NetworkLag = 10;
 	timeoutInS = 45;
+	adaptiveLag = true;
 }
 
 void CNetworkParameter::FixValues()
 {
 	gameCyclesPerUpdate = std::max(gameCyclesPerUpdate, 1u);
 	NetworkLag = std::max(NetworkLag, 2u * gameCyclesPerUpdate);
+	// Commands are only executed each gameCyclesPerUpdate cycles.
+	NetworkLag = (NetworkLag + gameCyclesPerUpdate - 1) / gameCyclesPerUpdate * gameCyclesPerUpdate;
 }
 
 bool NetworkInSync = true;                 /// Network is in sync
@@ -299,26 +322,65 @@ static unsigned long NetworkLastCycle[PlayerMax]; /// Last cycle received packet
 
 static int NetworkSyncSeeds[256];          /// Network sync seeds.
 static int NetworkSyncHashs[256];          /// Network sync hashs.
+static unsigned NetworkSyncPartHashs[256][SyncHashPartCount]; /// Network sync hashs of each part.
+static bool NetworkSyncPartDumped[SyncHashPartCount]; /// State dump written for the part.
 static CNetworkCommandQueue NetworkIn[256][PlayerMax][MaxNetworkCommands]; /// Per-player network packet input queue
 static std::deque<CNetworkCommandQueue> CommandsIn;    /// Network command input queue
 static std::deque<CNetworkCommandQueue> MsgCommandsIn; /// Network message input queue
 
+#define NETWORK_MAX_PACKET_SIZE 1024 /// Biggest packet we can receive
+#define NETWORK_RECV_BATCH 16        /// Most packets read at once
+
+#define NETWORK_ADAPT_CYCLES (CYCLES_PER_SECOND * 5) /// Game cycles between lag adaptations
+#define NETWORK_MAX_LAG 96         /// Biggest adapted lag, must stay below 128 for the packet cycle
+#define NETWORK_MAX_UPDATES 4      /// Biggest adapted update interval
+#define NETWORK_LAG_PER_UPDATE 8   /// Lag in game cycles for each cycle of update interval
+#define NETWORK_LAG_HYSTERESIS 5   /// Game cycles the lag must win before it is lowered
+
+static unsigned long NetworkLastSentCycle;    /// Last game cycle we have sent commands for
+static unsigned long NetworkUpdateBase;       /// First game cycle of the current update interval
+static unsigned long NetworkPrevUpdateBase;   /// First game cycle of the previous update interval
+static unsigned int NetworkPrevUpdates;       /// Previous update interval
+static int NetworkServerPlayer;               /// Player of the server
+static bool NetworkLagPending;                /// Server has sent a lag change not yet executed
+static unsigned long NetworkLastAdaptCycle;   /// Game cycle of the last lag adaptation
+static unsigned long NetworkServerTicks;      /// Last ticks of the server from its sync
+static unsigned long NetworkServerTicksTime;  /// Our ticks when NetworkServerTicks was received
+static unsigned long NetworkRtt[PlayerMax];    /// Smoothed round trip time in ms, 0 if unknown
+static unsigned long NetworkRttVar[PlayerMax]; /// Round trip time variation in ms
+static unsigned long NetworkSentCycles[MaxNetworkRedundancy]; /// Last game cycles we have sent, newest first
+
+#define NETWORK_OBSERVER_ACK_TICKS 1000  /// Ticks between acks of a waiting observer
+
+static CHost NetworkRelayHost;                  /// Observer relay to send the game to, or to observe
+static bool NetworkRelaying;                    /// Server sends the game to the relay
+static CNetworkRelayStream NetworkRelayStream;  /// Server: entries sent to the relay
+static CNetworkRelayPeer NetworkRelayPeer;      /// Server: what the relay has
+static bool NetworkObserving;                   /// We observe the game through the relay
+static bool NetworkObserverSetup;               /// Observer: game setup received
+static uint32_t NetworkObservedSeq;             /// Observer: number of entries received
+static unsigned long NetworkObservedCycle;      /// Observer: last game cycle with all its commands
+static unsigned long NetworkObserverAckTicks;   /// Observer: ticks of the last ack
+static std::deque<CNetworkRelayCycle> NetworkObservedCycles; /// Observer: entries to execute
+
 
 #ifdef DEBUG
 class CNetworkStat
 {
 public:
 	CNetworkStat() :
-		resentPacketCount(0)
+		resentPacketCount(0), filledPacketCount(0)
 	{}
 
 	void print() const
 	{
 		DebugPrint("resent: %d packets\n" _C_ resentPacketCount);
+		DebugPrint("filled: %d packets from repeated commands\n" _C_ filledPacketCount);
 	}
 
 public:
 	unsigned int resentPacketCount;
+	unsigned int filledPacketCount;
 };
 
 static void printStatistic(const CUDPSocket::CStatistic &statistic)
@@ -330,6 +392,9 @@ static void printStatistic(const CUDPSocket::CStatistic &statistic)
 			   statistic.receivedPacketsCount _C_ statistic.receivedBytesCount
 			   _C_ statistic.biggestReceivedPacketSize);
 	DebugPrint("Received: %d error(s).\n" _C_ statistic.receivedErrorCount);
+	DebugPrint("Batches: %d sent (max %d packets), %d received (max %d packets).\n"
+			   _C_ statistic.sentBatchCount _C_ statistic.biggestSentBatchSize
+			   _C_ statistic.receivedBatchCount _C_ statistic.biggestReceivedBatchSize);
 }
 
 static CNetworkStat NetworkStat;
@@ -355,13 +420,15 @@ static void NetworkBroadcast(const CNetworkPacket &packet, int numcommands, int
 
 	// Send to all clients.
 	if (NetConnectType == 1) { // server
+		CHost hosts[PlayerMax];
+		int count = 0;
 		for (int i = 0; i < HostsCount; ++i) {
-			const CHost host(Hosts[i].Host, Hosts[i].Port);
 			if (Hosts[i].PlyNr == player) {
 				continue;
 			}
-			NetworkFildes.Send(host, buf, size);
+			hosts[count++] = CHost(Hosts[i].Host, Hosts[i].Port);
 		}
+		NetworkFildes.SendBatch(hosts, count, buf, size);
 	} else { // client		
 		const CHost host(Hosts[HostsCount - 1].Host, Hosts[HostsCount - 1].Port);
 		NetworkFildes.Send(host, buf, size);
@@ -391,6 +458,34 @@ static void NetworkSendPacket(const CNetworkCommandQueue(&ncq)[MaxNetworkCommand
 	for (; i < MaxNetworkCommands; ++i) {
 		packet.Header.Type[i] = MessageNone;
 	}
+	// Repeat the previous packets, as long as they fit.
+	for (int k = 0; k != MaxNetworkRedundancy; ++k) {
+		const unsigned long cycle = NetworkSentCycles[k];
+		if (cycle == 0 || cycle >= ncq[0].Time || ncq[0].Time - cycle >= 128) {
+			continue;
+		}
+		const CNetworkCommandQueue(&previous)[MaxNetworkCommands] = NetworkIn[cycle & 0xFF][ThisPlayer->Index];
+		if (previous[0].Time != cycle) {
+			continue;
+		}
+		CNetworkPacketHeader &header = packet.PreviousHeader[packet.PreviousCount];
+		header.Cycle = cycle & 0xFF;
+		header.OrigPlayer = packet.Header.OrigPlayer;
+		int count = 0;
+		for (; count != MaxNetworkCommands && previous[count].Type != MessageNone; ++count) {
+			header.Type[count] = previous[count].Type;
+			packet.PreviousCommand[packet.PreviousCount][count] = previous[count].Data;
+		}
+		for (int j = count; j != MaxNetworkCommands; ++j) {
+			header.Type[j] = MessageNone;
+		}
+		++packet.PreviousCount;
+		packet.EncodePrevious(numcommands);
+		if (packet.Size(numcommands) > NETWORK_MAX_PACKET_SIZE) {
+			--packet.PreviousCount;
+			break;
+		}
+	}
 	NetworkBroadcast(packet, numcommands);
 }
 
@@ -453,6 +548,10 @@ void ExitNetwork1()
 	NetworkFildes.Close();
 	NetExit(); // machine dependent setup
 
+	NetworkRelaying = false;
+	NetworkRelayStream.Clear();
+	NetworkObserving = false;
+	NetworkObservedCycles.clear();
 	NetworkInSync = true;
 	NetPlayers = 0;
 	HostsCount = 0;
@@ -463,7 +562,9 @@ void ExitNetwork1()
 */
 void NetworkOnStartGame()
 {
-	ThisPlayer->SetName(Parameters::Instance.LocalPlayerName);
+	if (!NetworkObserving) {
+		ThisPlayer->SetName(Parameters::Instance.LocalPlayerName);
+	}
 	for (int i = 0; i < HostsCount; ++i) {
 		Players[Hosts[i].PlyNr].SetName(Hosts[i].PlyName);
 	}
@@ -497,12 +598,123 @@ void NetworkOnStartGame()
 			ncqs[1].Time = i;
 			ncqs[1].Type = MessageNone;
 		}
+		NetworkLastSentCycle = i;
 	}
+	NetworkUpdateBase = 0;
+	NetworkPrevUpdateBase = 0;
+	NetworkPrevUpdates = CNetworkParameter::Instance.gameCyclesPerUpdate;
+	// The server is the last host of the clients.
+	NetworkServerPlayer = NetConnectType == 1 ? ThisPlayer->Index : Hosts[HostsCount - 1].PlyNr;
+	NetworkLagPending = false;
+	NetworkLastAdaptCycle = 0;
+	NetworkServerTicks = 0;
+	NetworkServerTicksTime = 0;
+	memset(NetworkRtt, 0, sizeof(NetworkRtt));
+	memset(NetworkRttVar, 0, sizeof(NetworkRttVar));
+	memset(NetworkSentCycles, 0, sizeof(NetworkSentCycles));
 	memset(NetworkSyncSeeds, 0, sizeof(NetworkSyncSeeds));
 	memset(NetworkSyncHashs, 0, sizeof(NetworkSyncHashs));
+	memset(NetworkSyncPartHashs, 0, sizeof(NetworkSyncPartHashs));
+	memset(NetworkSyncPartDumped, 0, sizeof(NetworkSyncPartDumped));
 	memset(PlayerQuit, 0, sizeof(PlayerQuit));
 	memset(NetworkLastFrame, 0, sizeof(NetworkLastFrame));
 	memset(NetworkLastCycle, 0, sizeof(NetworkLastCycle));
+
+	NetworkRelaying = NetConnectType == 1 && NetworkRelayHost.isValid();
+	if (NetworkRelaying) {
+		CNetworkRelaySetup setup;
+		unsigned char buf[MaxNetworkRelaySize];
+
+		NetworkFillRelaySetup(setup);
+		NetworkRelayStream.Clear();
+		NetworkRelayStream.Add(buf, setup.Serialize(buf), 0);
+		NetworkRelayPeer = CNetworkRelayPeer(NetworkRelayHost, GetTicks());
+		NetworkRelayPeer.Send(NetworkFildes, NetworkRelayStream, NetworkRelayStream.GetSize(), GetTicks());
+	}
+	if (NetworkObserving) {
+		// Wait for the commands of the first cycles.
+		NetworkInSync = NetworkObservedCycle > GameCycle;
+	}
+}
+
+/**
+**  Setup the observer relay the server sends the game to.
+**
+**  @param relayaddr  Address of the relay.
+**  @param port       Port of the relay, 0 for the default one.
+**
+**  @return 0 if the address is valid.
+*/
+int NetworkSetupRelayAddress(const std::string &relayaddr, int port)
+{
+	if (port == 0) {
+		port = CNetworkParameter::defaultRelayPort;
+	}
+	const CHost host(relayaddr.c_str(), port);
+	if (host.isValid() == false) {
+		return 1;
+	}
+	NetworkRelayHost = host;
+#ifdef DEBUG
+	const std::string hostStr = host.toString();
+	DebugPrint("SELECTED RELAY: %s [%s]\n" _C_ hostStr.c_str() _C_ relayaddr.c_str());
+#endif
+	return 0;
+}
+
+/**
+**  Send to the relay the number of entries we have.
+*/
+static void NetworkObserverAck()
+{
+	CNetworkRelayHeader ack;
+	unsigned char buf[32];
+
+	ack.Seq = NetworkObservedSeq;
+	NetworkFildes.Send(NetworkRelayHost, buf, ack.Serialize(buf));
+	NetworkObserverAckTicks = GetTicks();
+}
+
+/**
+**  Observe a game through an observer relay. The network must be open.
+**
+**  The game setup comes first, when NetworkObserverReady() is true the
+**  game can be started like on a client.
+**
+**  @param relayaddr  Address of the relay.
+**  @param port       Port of the relay, 0 for the default one.
+**
+**  @return 0 if the relay has been asked for the game.
+*/
+int NetworkObserve(const std::string &relayaddr, int port)
+{
+	if (!IsNetworkGame() || NetworkSetupRelayAddress(relayaddr, port) != 0) {
+		return 1;
+	}
+	NetworkObserving = true;
+	NetworkObserverSetup = false;
+	NetworkObservedSeq = 0;
+	NetworkObservedCycle = 0;
+	NetworkObservedCycles.clear();
+	NetConnectType = 0; // Neither server nor client of the game setup
+	NetworkObserverAck();
+	return 0;
+}
+
+/**
+**  Observer: has the game setup been received.
+**
+**  Ask the relay again from time to time, until it is there.
+*/
+bool NetworkObserverReady()
+{
+	if (!NetworkObserving) {
+		return false;
+	}
+	if (!NetworkObserverSetup && GetTicks() - NetworkObserverAckTicks >= NETWORK_OBSERVER_ACK_TICKS) {
+		NetworkObserverAck();
+	}
+	return NetworkObserverSetup;
 }
 
 //----------------------------------------------------------------------------
@@ -527,6 +739,9 @@ void NetworkOnStartGame()
 void NetworkSendCommand(int command, const CUnit &unit, int x, int y,
 						const CUnit *dest, const CUnitType *type, int status)
 {
+	if (NetworkObserving) { // Observers only watch
+		return;
+	}
 	CNetworkCommandQueue ncq;
 
 	ncq.Time = GameCycle;
@@ -570,6 +785,9 @@ void NetworkSendCommand(int command, const CUnit &unit, int x, int y,
 void NetworkSendExtendedCommand(int command, int arg1, int arg2, int arg3,
 								int arg4, int status)
 {
+	if (NetworkObserving) { // Observers only watch
+		return;
+	}
 	CNetworkCommandQueue ncq;
 
 	ncq.Time = GameCycle;
@@ -629,7 +847,7 @@ void NetworkSendSelection(CUnit **units, int count)
 */
 void NetworkSendChatMessage(const std::string &msg)
 {
-	if (!IsNetworkGame()) {
+	if (!IsNetworkGame() || NetworkObserving) {
 		return;
 	}
 	CNetworkChat nc;
@@ -663,6 +881,36 @@ static void NetworkRemovePlayer(int player)
 	}
 }
 
+/**
+**  Check if commands are executed at a game cycle.
+**
+**  @param cycle  Game cycle, not before the previous update interval.
+*/
+static bool IsNetworkUpdateCycle(unsigned long cycle)
+{
+	if (cycle < NetworkUpdateBase) {
+		return (cycle - NetworkPrevUpdateBase) % NetworkPrevUpdates == 0;
+	}
+	return (cycle - NetworkUpdateBase) % CNetworkParameter::Instance.gameCyclesPerUpdate == 0;
+}
+
+/**
+**  Get the next game cycle at which commands are executed.
+**
+**  @param cycle  Game cycle, not before the previous update interval.
+**
+**  @return the first game cycle with commands after cycle.
+*/
+static unsigned long NextNetworkUpdateCycle(unsigned long cycle)
+{
+	if (cycle < NetworkUpdateBase) {
+		// NetworkUpdateBase is always a cycle of the previous interval.
+		return cycle - (cycle - NetworkPrevUpdateBase) % NetworkPrevUpdates + NetworkPrevUpdates;
+	}
+	const unsigned int updates = CNetworkParameter::Instance.gameCyclesPerUpdate;
+	return cycle - (cycle - NetworkUpdateBase) % updates + updates;
+}
+
 static bool IsNetworkCommandReady(int hostIndex, unsigned long gameNetCycle)
 {
 	const int ply = Hosts[hostIndex].PlyNr;
@@ -749,10 +997,22 @@ static bool IsAValidCommand_Dismiss(const CNetworkPacket &packet, int index, con
 	return IsAValidCommand_Command(packet, index, player);
 }
 
+static bool IsAValidCommand_ExtendedCommand(const CNetworkPacket &packet, int index, const int player)
+{
+	CNetworkExtendedCommand nec;
+	nec.Deserialize(&packet.Command[index][0]);
+
+	if (nec.ExtendedType == ExtendedMessageNetworkLag) {
+		return player == NetworkServerPlayer;
+	}
+	// FIXME: ensure the sender is part of the command
+	return true;
+}
+
 static bool IsAValidCommand(const CNetworkPacket &packet, int index, const int player)
 {
 	switch (packet.Header.Type[index] & 0x7F) {
-		case MessageExtendedCommand: // FIXME: ensure the sender is part of the command
+		case MessageExtendedCommand: return IsAValidCommand_ExtendedCommand(packet, index, player);
 		case MessageSync: // Sync does not matter
 		case MessageSelection: // FIXME: ensure it's from the right player
 		case MessageQuit:      // FIXME: ensure it's from the right player
@@ -765,6 +1025,98 @@ static bool IsAValidCommand(const CNetworkPacket &packet, int index, const int p
 	// FIXME: not all values in nc have been validated
 }
 
+/**
+**  Take the ticks of a received sync message into account.
+**
+**  The clients remember the ticks of the server, the server updates the
+**  round trip time to the client from the ticks echoed back.
+**
+**  @param data    Sync message (network format).
+**  @param player  Player who sent the message.
+*/
+static void NetworkMeasureSync(const std::vector<unsigned char> &data, int player)
+{
+	CNetworkCommandSync nc;
+	nc.Deserialize(&data[0]);
+	const unsigned long ticks = GetTicks();
+
+	if (NetConnectType != 1) {
+		if (player == NetworkServerPlayer) {
+			NetworkServerTicks = nc.sendTicks;
+			NetworkServerTicksTime = ticks;
+		}
+		return;
+	}
+	if (nc.echoTicks == 0) {
+		return;
+	}
+	const unsigned long sample = uint32_t(ticks - nc.echoTicks);
+	if (sample > 60000) { // Old or bogus echo
+		return;
+	}
+	if (NetworkRtt[player] == 0) {
+		NetworkRtt[player] = std::max(sample, 1ul);
+		NetworkRttVar[player] = sample / 2;
+	} else {
+		const unsigned long diff = NetworkRtt[player] > sample ? NetworkRtt[player] - sample : sample - NetworkRtt[player];
+		NetworkRttVar[player] = (3 * NetworkRttVar[player] + diff) / 4;
+		NetworkRtt[player] = std::max((7 * NetworkRtt[player] + sample) / 8, 1ul);
+	}
+}
+
+/**
+**  Fill in the commands of a lost packet from a repeated previous packet.
+**
+**  @param packet  Received packet.
+**  @param index   Index of the previous packet in packet.
+**  @param player  Player who sent the packet.
+*/
+static void NetworkFillMissingCycle(const CNetworkPacket &packet, int index, int player)
+{
+	const CNetworkPacketHeader &header = packet.PreviousHeader[index];
+	unsigned long n = ((GameCycle + 128) & ~0xFF) | header.Cycle;
+	if (n > GameCycle + 128) {
+		n -= 0x100;
+	}
+	CNetworkCommandQueue(&ncqs)[MaxNetworkCommands] = NetworkIn[header.Cycle][player];
+	if (n < GameCycle || ncqs[0].Time == n) {
+		// Too late or not lost
+		return;
+	}
+	CNetworkPacket previous;
+	previous.Header = header;
+	const int commands = packet.PreviousCommandCount(index);
+	for (int i = 0; i != commands; ++i) {
+		previous.Command[i] = packet.PreviousCommand[index][i];
+	}
+	for (int i = 0; i != commands; ++i) {
+		if (header.Type[i] == MessageQuit) {
+			CNetworkCommandQuit nc;
+			nc.Deserialize(&previous.Command[i][0]);
+			const int playerNum = nc.player;
+
+			if (playerNum >= 0 && playerNum < NumPlayers) {
+				PlayerQuit[playerNum] = 1;
+			}
+		}
+		if (IsAValidCommand(previous, i, player)) {
+			ncqs[i].Time = n;
+			ncqs[i].Type = header.Type[i];
+			ncqs[i].Data = previous.Command[i];
+		} else {
+			SetMessage(_("%s sent bad command"), Players[player].Name.c_str());
+			DebugPrint("%s sent bad command: 0x%x\n" _C_ Players[player].Name.c_str()
+					   _C_ header.Type[i] & 0x7F);
+		}
+	}
+	for (int i = commands; i != MaxNetworkCommands; ++i) {
+		ncqs[i].Time = 0;
+	}
+#ifdef DEBUG
+	++NetworkStat.filledPacketCount;
+#endif
+}
+
 static void NetworkParseInGameEvent(const unsigned char *buf, int len, const CHost &host)
 {
 	CNetworkPacket packet;
@@ -783,15 +1135,16 @@ static void NetworkParseInGameEvent(const unsigned char *buf, int len, const CHo
 		}
 		player = Hosts[index].PlyNr;
 	}
+	if (commands < 0) {
+		DebugPrint("Bad packet read\n");
+		return;
+	}
 	if (NetConnectType == 1) {
 		if (player != 255) {
+			packet.EncodePrevious(commands);
 			NetworkBroadcast(packet, commands, player);
 		}
 	}
-	if (commands < 0) {
-		DebugPrint("Bad packet read\n");
-		return;
-	}
 	NetworkLastCycle[player] = packet.Header.Cycle;
 	// Parse the packet commands.
 	for (int i = 0; i != commands; ++i) {
@@ -820,6 +1173,9 @@ static void NetworkParseInGameEvent(const unsigned char *buf, int len, const CHo
 			if (n > GameCycle + 128) {
 				n -= 0x100;
 			}
+			if (packet.Header.Type[i] == MessageSync && NetworkIn[packet.Header.Cycle][player][i].Time != n) {
+				NetworkMeasureSync(packet.Command[i], player);
+			}
 			NetworkIn[packet.Header.Cycle][player][i].Time = n;
 			NetworkIn[packet.Header.Cycle][player][i].Type = packet.Header.Type[i];
 			NetworkIn[packet.Header.Cycle][player][i].Data = packet.Command[i];
@@ -832,16 +1188,78 @@ static void NetworkParseInGameEvent(const unsigned char *buf, int len, const CHo
 	for (int i = commands; i != MaxNetworkCommands; ++i) {
 		NetworkIn[packet.Header.Cycle][player][i].Time = 0;
 	}
+	for (int k = 0; k != packet.PreviousCount; ++k) {
+		NetworkFillMissingCycle(packet, k, player);
+	}
 	// Waiting for this time slot
 	if (!NetworkInSync) {
-		const int networkUpdates = CNetworkParameter::Instance.gameCyclesPerUpdate;
-		unsigned long n = ((GameCycle / networkUpdates) + 1) * networkUpdates;
+		const unsigned long n = NextNetworkUpdateCycle(GameCycle);
 		if (IsNetworkCommandReady(n) == true) {
 			NetworkInSync = true;
 		}
 	}
 }
 
+/**
+**  Parse a message of the observer relay.
+**
+**  The server gets the acks of the relay, an observer the entries.
+**
+**  @return true if an observer has to ack.
+*/
+static bool NetworkParseRelayEvent(const unsigned char *buf, int len, const CHost &host)
+{
+	if (len < (int)CNetworkRelayHeader::Size() || host != NetworkRelayHost) {
+		return false;
+	}
+	CNetworkRelayHeader header;
+	header.Deserialize(buf);
+
+	if (NetworkRelaying) {
+		if (header.Subtype == RelayMessageAck) {
+			const unsigned long ticks = GetTicks();
+			NetworkRelayPeer.Ack(std::min(header.Seq, NetworkRelayStream.GetSize()), ticks);
+			NetworkRelayPeer.Send(NetworkFildes, NetworkRelayStream, NetworkRelayStream.GetSize(), ticks);
+		}
+		return false;
+	}
+	if (!NetworkObserving || header.Subtype == RelayMessageAck) {
+		return false;
+	}
+	if (header.Seq != NetworkObservedSeq) {
+		// Lost or repeated entry, the ack tells the relay what we have.
+		return true;
+	}
+	if (header.Subtype == RelayMessageSetup) {
+		if (header.Seq != 0 || len < (int)CNetworkRelaySetup::Size()) {
+			return false;
+		}
+		CNetworkRelaySetup setup;
+		setup.Deserialize(buf);
+		if (!NetworkSetupObserverGame(setup)) {
+			return false;
+		}
+		NetworkObserverSetup = true;
+	} else if (header.Subtype == RelayMessageCycle) {
+		CNetworkRelayCycle entry;
+		if (header.Seq == 0 || entry.Deserialize(buf, len) == 0) {
+			DebugPrint("Bad relay entry %u\n" _C_ header.Seq);
+			return false;
+		}
+		if (!entry.More) {
+			NetworkObservedCycle = entry.Header.Cycle;
+		}
+		NetworkObservedCycles.push_back(entry);
+	} else {
+		return false;
+	}
+	++NetworkObservedSeq;
+	if (!NetworkInSync && NetworkObservedCycle > GameCycle) {
+		NetworkInSync = true;
+	}
+	return true;
+}
+
 /**
 **  Called if message for the network is ready.
 **  (by WaitEventsOneFrame)
@@ -852,28 +1270,43 @@ void NetworkEvent()
 		NetworkInSync = true;
 		return;
 	}
-	// Read the packet.
-	unsigned char buf[1024];
-	CHost host;
-	int len = NetworkFildes.Recv(&buf, sizeof(buf), &host);
-	if (len < 0) {
+	// Read all the waiting packets.
+	unsigned char bufs[NETWORK_RECV_BATCH][NETWORK_MAX_PACKET_SIZE];
+	int lens[NETWORK_RECV_BATCH];
+	CHost hosts[NETWORK_RECV_BATCH];
+	const int count = NetworkFildes.RecvBatch(&bufs[0][0], NETWORK_MAX_PACKET_SIZE, NETWORK_RECV_BATCH, lens, hosts);
+	if (count < 0) {
 		DebugPrint("Server/Client gone?\n");
 		// just hope for an automatic recover right now..
 		NetworkInSync = false;
 		return;
 	}
+	bool relayAck = false;
+	for (int i = 0; i != count; ++i) {
+		const unsigned char *buf = bufs[i];
 
-	// Setup messages
-	if (NetConnectRunning) {
-		if (NetworkParseSetupEvent(buf, len, host)) {
-			return;
+		// Setup messages
+		if (NetConnectRunning) {
+			if (NetworkParseSetupEvent(buf, lens[i], hosts[i])) {
+				continue;
+			}
+		}
+		const unsigned char msgtype = buf[0];
+		if (msgtype == MessageInit_FromClient || msgtype == MessageInit_FromServer) {
+			continue;
+		}
+		if (msgtype == MessageRelay) {
+			relayAck |= NetworkParseRelayEvent(buf, lens[i], hosts[i]);
+			continue;
+		}
+		if (NetworkObserving) {
+			continue;
 		}
+		NetworkParseInGameEvent(buf, lens[i], hosts[i]);
 	}
-	const unsigned char msgtype = buf[0];
-	if (msgtype == MessageInit_FromClient || msgtype == MessageInit_FromServer) {
-		return;
+	if (relayAck) {
+		NetworkObserverAck();
 	}
-	NetworkParseInGameEvent(buf, len, host);
 }
 
 /**
@@ -881,12 +1314,10 @@ void NetworkEvent()
 */
 void NetworkQuitGame()
 {
-	if (!ThisPlayer || IsNetworkGame() == false) {
+	if (!ThisPlayer || IsNetworkGame() == false || NetworkObserving) {
 		return;
 	}
-	const int gameCyclesPerUpdate = CNetworkParameter::Instance.gameCyclesPerUpdate;
-	const int NetworkLag = CNetworkParameter::Instance.NetworkLag;
-	const int n = (GameCycle + gameCyclesPerUpdate) / gameCyclesPerUpdate * gameCyclesPerUpdate + NetworkLag;
+	const unsigned long n = NextNetworkUpdateCycle(NetworkLastSentCycle);
 	CNetworkCommandQueue(&ncqs)[MaxNetworkCommands] = NetworkIn[n & 0xFF][ThisPlayer->Index];
 	CNetworkCommandQuit nc;
 	nc.player = ThisPlayer->Index;
@@ -901,6 +1332,77 @@ void NetworkQuitGame()
 	NetworkSendPacket(ncqs);
 }
 
+/**
+**  Write the state of a part of the game which is out of sync.
+**
+**  All computers see the difference at the same game cycle, so the
+**  files written by two of them can be compared with diff.
+**
+**  @param part  Part of the state which is out of sync.
+*/
+static void NetworkDumpSyncPart(SyncHashPart part)
+{
+	static const char *const partNames[SyncHashPartCount] = {"units", "missiles", "players"};
+
+	if (NetworkSyncPartDumped[part]) {
+		return;
+	}
+	NetworkSyncPartDumped[part] = true;
+
+	std::string path(Parameters::Instance.GetUserDirectory());
+	if (!GameName.empty()) {
+		path += "/";
+		path += GameName;
+	}
+	path += "/logs";
+	struct stat tmp;
+	if (stat(path.c_str(), &tmp) < 0) {
+		makedir(path.c_str(), 0777);
+	}
+	char buf[64];
+	snprintf(buf, sizeof(buf), "/desync_%lu_%s_%d.log", GameCycle, partNames[part], ThisPlayer->Index);
+	path += buf;
+
+	CFile file;
+	if (file.open(path.c_str(), CL_OPEN_WRITE) == -1) {
+		fprintf(stderr, "Can't write desync dump '%s'\n", path.c_str());
+		return;
+	}
+	file.printf("cycle %lu %s hash %u seed %u\n", GameCycle, partNames[part], SyncHashes[part], SyncRandSeed);
+	switch (part) {
+		case SyncHashUnits:
+			for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
+				const CUnit &unit = **it;
+
+				file.printf("%d %s player %d pos %d %d %d %d hp %d action %d orders %d refs %d%s\n",
+							UnitNumber(unit), unit.Type->Ident.c_str(), unit.Player->Index,
+							unit.tilePos.x, unit.tilePos.y, unit.IX, unit.IY,
+							unit.Variable[HP_INDEX].Value,
+							unit.Orders.empty() ? -1 : (int)unit.CurrentAction(),
+							(int)unit.Orders.size(), unit.Refs, unit.Destroyed ? " destroyed" : "");
+			}
+			break;
+		case SyncHashMissiles:
+			DumpGlobalMissiles(file);
+			break;
+		case SyncHashPlayers:
+			for (int i = 0; i < NumPlayers; ++i) {
+				const CPlayer &player = Players[i];
+
+				file.printf("%d units %d buildings %d resources", i, player.GetUnitCount(), player.NumBuildings);
+				for (int res = 0; res < MaxCosts; ++res) {
+					file.printf(" %d/%d", player.Resources[res], player.StoredResources[res]);
+				}
+				file.printf("\n");
+			}
+			break;
+		default:
+			break;
+	}
+	file.close();
+	fprintf(stderr, "Network out of sync, %s written to '%s'\n", partNames[part], path.c_str());
+}
+
 static void NetworkExecCommand_Sync(const CNetworkCommandQueue &ncq)
 {
 	Assert((ncq.Type & 0x7F) == MessageSync);
@@ -917,6 +1419,17 @@ static void NetworkExecCommand_Sync(const CNetworkCommandQueue &ncq)
 		DebugPrint("\nNetwork out of sync %x!=%x! %d!=%d! Cycle %lu\n\n" _C_
 				   syncSeed _C_ NetworkSyncSeeds[gameNetCycle & 0xFF] _C_
 				   syncHash _C_ NetworkSyncHashs[gameNetCycle & 0xFF] _C_ GameCycle);
+
+		const unsigned *partHashs = NetworkSyncPartHashs[gameNetCycle & 0xFF];
+		if (nc.unitHash != partHashs[SyncHashUnits]) {
+			NetworkDumpSyncPart(SyncHashUnits);
+		}
+		if (nc.missileHash != partHashs[SyncHashMissiles]) {
+			NetworkDumpSyncPart(SyncHashMissiles);
+		}
+		if (nc.playerHash != partHashs[SyncHashPlayers]) {
+			NetworkDumpSyncPart(SyncHashPlayers);
+		}
 	}
 }
 
@@ -961,12 +1474,44 @@ static void NetworkExecCommand_Quit(const CNetworkCommandQueue &ncq)
 	CommandQuit(nc.player);
 }
 
+/**
+**  Change the lag and the update interval.
+**
+**  Called at the same game cycle on all computers. The new values apply
+**  to the game cycles after the last one we have already sent.
+**
+**  @param lag      New network lag in game cycles.
+**  @param updates  New number of game cycles between updates.
+*/
+static void NetworkChangeLag(unsigned int lag, unsigned int updates)
+{
+	if (updates < 1 || updates > NETWORK_MAX_UPDATES || lag < 2 * updates
+		|| lag > NETWORK_MAX_LAG || lag % updates != 0) {
+		DebugPrint("Bad network lag %d, updates %d\n" _C_ lag _C_ updates);
+		return;
+	}
+	CNetworkParameter &parameter = CNetworkParameter::Instance;
+
+	NetworkPrevUpdateBase = NetworkUpdateBase;
+	NetworkPrevUpdates = parameter.gameCyclesPerUpdate;
+	NetworkUpdateBase = NetworkLastSentCycle;
+	parameter.NetworkLag = lag;
+	parameter.gameCyclesPerUpdate = updates;
+	NetworkLagPending = false;
+	DebugPrint("Cycle %lu: updates %d, lag %d from cycle %lu\n" _C_
+			   GameCycle _C_ updates _C_ lag _C_ NetworkUpdateBase);
+}
+
 static void NetworkExecCommand_ExtendedCommand(const CNetworkCommandQueue &ncq)
 {
 	Assert((ncq.Type & 0x7F) == MessageExtendedCommand);
 	CNetworkExtendedCommand nec;
 
 	nec.Deserialize(&ncq.Data[0]);
+	if (nec.ExtendedType == ExtendedMessageNetworkLag) {
+		NetworkChangeLag(nec.Arg2, nec.Arg3);
+		return;
+	}
 	ExecExtendedCommand(nec.ExtendedType, (ncq.Type & 0x80) >> 7,
 						nec.Arg1, nec.Arg2, nec.Arg3, nec.Arg4);
 }
@@ -1014,6 +1559,14 @@ static void NetworkSendCommands(unsigned long gameNetCycle)
 		ncq[0].Type = MessageSync;
 		nc.syncHash = SyncHash;
 		nc.syncSeed = SyncRandSeed;
+		nc.unitHash = SyncHashes[SyncHashUnits];
+		nc.missileHash = SyncHashes[SyncHashMissiles];
+		nc.playerHash = SyncHashes[SyncHashPlayers];
+		nc.sendTicks = GetTicks();
+		if (NetConnectType != 1 && NetworkServerTicks) {
+			// Echo the ticks of the server, without the time we kept them.
+			nc.echoTicks = NetworkServerTicks + (nc.sendTicks - NetworkServerTicksTime);
+		}
 		ncq[0].Data.resize(nc.Size());
 		nc.Serialize(&ncq[0].Data[0]);
 		ncq[0].Time = gameNetCycle;
@@ -1051,7 +1604,13 @@ static void NetworkSendCommands(unsigned long gameNetCycle)
 	}
 	NetworkSyncSeeds[gameNetCycle & 0xFF] = SyncRandSeed;
 	NetworkSyncHashs[gameNetCycle & 0xFF] = SyncHash;
+	memcpy(NetworkSyncPartHashs[gameNetCycle & 0xFF], SyncHashes, sizeof(SyncHashes));
+	NetworkLastSentCycle = gameNetCycle;
 	NetworkSendPacket(ncq);
+	for (int k = MaxNetworkRedundancy - 1; k != 0; --k) {
+		NetworkSentCycles[k] = NetworkSentCycles[k - 1];
+	}
+	NetworkSentCycles[0] = gameNetCycle;
 }
 
 /**
@@ -1074,6 +1633,128 @@ static void NetworkExecCommands(unsigned long gameNetCycle)
 	}
 }
 
+/**
+**  Append an entry to the stream sent to the observer relay.
+*/
+static void NetworkRelayAdd(CNetworkRelayCycle &entry)
+{
+	unsigned char buf[MaxNetworkRelaySize];
+
+	entry.Header.Seq = NetworkRelayStream.GetSize();
+	NetworkRelayStream.Add(buf, entry.Serialize(buf), entry.Header.Cycle);
+}
+
+/**
+**  Server sends the commands executed at a game cycle to the observer relay.
+**
+**  Syncs, selections and lag changes only matter to the hosts.
+*/
+static void NetworkRelayCommands(unsigned long gameNetCycle)
+{
+	CNetworkRelayCycle entry;
+	entry.Header.Cycle = gameNetCycle;
+
+	for (int i = 0; i < NumPlayers; ++i) {
+		const CNetworkCommandQueue *ncqs = NetworkIn[gameNetCycle & 0xFF][i];
+		for (int c = 0; c < MaxNetworkCommands; ++c) {
+			const CNetworkCommandQueue &ncq = ncqs[c];
+			if (ncq.Type == MessageNone) {
+				break;
+			}
+			if (!ncq.Time || ncq.Time != gameNetCycle) {
+				continue;
+			}
+			const int type = ncq.Type & 0x7F;
+			if (type == MessageSync || type == MessageSelection) {
+				continue;
+			}
+			if (type == MessageExtendedCommand) {
+				CNetworkExtendedCommand nec;
+				nec.Deserialize(&ncq.Data[0]);
+				if (nec.ExtendedType == ExtendedMessageNetworkLag) {
+					continue;
+				}
+			}
+			CNetworkRelayCommand command;
+			command.Player = i;
+			command.Type = ncq.Type;
+			command.Data = ncq.Data;
+			if (entry.Size() + CNetworkRelayCycle::CommandSize(command) > MaxNetworkRelaySize) {
+				entry.More = 1;
+				NetworkRelayAdd(entry);
+				entry.More = 0;
+				entry.Commands.clear();
+			}
+			entry.Commands.push_back(command);
+		}
+	}
+	NetworkRelayAdd(entry);
+	NetworkRelayPeer.Send(NetworkFildes, NetworkRelayStream, NetworkRelayStream.GetSize(), GetTicks());
+}
+
+/**
+**  Observer executes the commands of the game cycle received from the relay.
+**
+**  The next game cycle can run once all its commands are there.
+*/
+static void NetworkObserverCommands()
+{
+	while (!NetworkObservedCycles.empty() && NetworkObservedCycles.front().Header.Cycle <= GameCycle) {
+		const CNetworkRelayCycle &entry = NetworkObservedCycles.front();
+		if (entry.Header.Cycle == GameCycle) {
+			for (size_t i = 0; i != entry.Commands.size(); ++i) {
+				CNetworkCommandQueue ncq;
+				ncq.Time = GameCycle;
+				ncq.Type = entry.Commands[i].Type;
+				ncq.Data = entry.Commands[i].Data;
+				NetworkExecCommand(ncq);
+			}
+		}
+		NetworkObservedCycles.pop_front();
+	}
+	NetworkInSync = NetworkObservedCycle > GameCycle;
+}
+
+/**
+**  Server chooses a new lag and update interval from the round trip times.
+**
+**  The lag must cover a command going from a client through the server to
+**  another client, which takes about the biggest round trip time. Bigger
+**  lags get a bigger update interval, to send less packets. The lag is
+**  raised at once but only lowered when it wins enough.
+*/
+static void NetworkAdaptLag()
+{
+	const CNetworkParameter &parameter = CNetworkParameter::Instance;
+
+	if (NetConnectType != 1 || !parameter.adaptiveLag || NetworkLagPending
+		|| GameCycle <= NetworkUpdateBase || GameCycle < NetworkLastAdaptCycle + NETWORK_ADAPT_CYCLES) {
+		return;
+	}
+	NetworkLastAdaptCycle = GameCycle;
+	unsigned long worst = 0;
+	for (int i = 0; i < HostsCount; ++i) {
+		const int ply = Hosts[i].PlyNr;
+		if (NetworkRtt[ply] == 0) {
+			return;
+		}
+		worst = std::max(worst, NetworkRtt[ply] + 4 * NetworkRttVar[ply]);
+	}
+	const unsigned long cycleTicks = std::max(100000 / (CYCLES_PER_SECOND * std::max(VideoSyncSpeed, 1)), 1);
+	unsigned int lag = (worst + cycleTicks - 1) / cycleTicks;
+	const unsigned int updates = std::min(std::max(lag / NETWORK_LAG_PER_UPDATE, 1u), (unsigned int)NETWORK_MAX_UPDATES);
+
+	// One more update for the command waiting in the queue.
+	lag = std::max(lag + updates, 2 * updates);
+	lag = std::min((lag + updates - 1) / updates * updates, NETWORK_MAX_LAG / updates * updates);
+	if (updates == parameter.gameCyclesPerUpdate
+		&& lag <= parameter.NetworkLag && lag + NETWORK_LAG_HYSTERESIS > parameter.NetworkLag) {
+		return;
+	}
+	NetworkSendExtendedCommand(ExtendedMessageNetworkLag, 0, lag, updates, 0, 0);
+	NetworkLagPending = true;
+}
+
 /**
 **  Handle network commands.
 */
@@ -1082,14 +1763,27 @@ void NetworkCommands()
 	if (!IsNetworkGame()) {
 		return;
 	}
-	if ((GameCycle % CNetworkParameter::Instance.gameCyclesPerUpdate) != 0) {
+	if (NetworkObserving) {
+		NetworkObserverCommands();
+		return;
+	}
+	if (!IsNetworkUpdateCycle(GameCycle)) {
 		return;
 	}
 	const unsigned long gameNetCycle = GameCycle;
-	// Send messages to all clients (other players)
-	NetworkSendCommands(gameNetCycle + CNetworkParameter::Instance.NetworkLag);
+	// Send messages to all clients (other players).
+	// After a lag change we may have to fill the gap up to the new lag,
+	// or already have sent the cycles up to it.
+	const unsigned long lastCycle = gameNetCycle + CNetworkParameter::Instance.NetworkLag;
+	for (unsigned long n = NextNetworkUpdateCycle(NetworkLastSentCycle); n <= lastCycle; n = NextNetworkUpdateCycle(n)) {
+		NetworkSendCommands(n);
+	}
 	NetworkExecCommands(gameNetCycle);
-	NetworkInSync = IsNetworkCommandReady(gameNetCycle + CNetworkParameter::Instance.gameCyclesPerUpdate);
+	if (NetworkRelaying) {
+		NetworkRelayCommands(gameNetCycle);
+	}
+	NetworkAdaptLag();
+	NetworkInSync = IsNetworkCommandReady(NextNetworkUpdateCycle(gameNetCycle));
 }
 
 static void CheckPlayerThatTimeOut(int hostIndex)
@@ -1108,11 +1802,11 @@ static void CheckPlayerThatTimeOut(int hostIndex)
 				   (timeoutInS - secs) / 60, (timeoutInS - secs) % 60);
 	}
 	if (secs >= timeoutInS) {
-		const unsigned int nextGameNetCycle = GameCycle / CNetworkParameter::Instance.gameCyclesPerUpdate + 1;
+		const unsigned long nextGameNetCycle = NextNetworkUpdateCycle(GameCycle);
 		CNetworkCommandQuit nc;
 		nc.player = playerIndex;
 		CNetworkCommandQueue *ncq = &NetworkIn[nextGameNetCycle & 0xFF][playerIndex][0];
-		ncq->Time = nextGameNetCycle * CNetworkParameter::Instance.gameCyclesPerUpdate;
+		ncq->Time = nextGameNetCycle;
 		ncq->Type = MessageQuit;
 		ncq->Data.resize(nc.Size());
 		nc.Serialize(&ncq->Data[0]);
@@ -1141,8 +1835,7 @@ static void NetworkResendCommands()
 	++NetworkStat.resentPacketCount;
 #endif
 
-	const int networkUpdates = CNetworkParameter::Instance.gameCyclesPerUpdate;
-	const int nextGameCycle = ((GameCycle / networkUpdates) + 1) * networkUpdates;
+	const unsigned long nextGameCycle = NextNetworkUpdateCycle(GameCycle);
 	// Build packet
 	CNetworkPacket packet;
 	packet.Header.Type[0] = MessageResend;
@@ -1157,6 +1850,13 @@ static void NetworkResendCommands()
 */
 void NetworkRecover()
 {
+	if (NetworkObserving) {
+		// Keep the relay subscription alive while waiting.
+		if (GetTicks() - NetworkObserverAckTicks >= NETWORK_OBSERVER_ACK_TICKS) {
+			NetworkObserverAck();
+		}
+		return;
+	}
 	if (HostsCount == 0) {
 		NetworkInSync = true;
 		return;
@@ -1168,8 +1868,7 @@ void NetworkRecover()
 		CheckPlayerThatTimeOut(i);
 	}
 	NetworkResendCommands();
-	const unsigned int nextGameNetCycle = GameCycle / CNetworkParameter::Instance.gameCyclesPerUpdate + 1;
-	NetworkInSync = IsNetworkCommandReady(nextGameNetCycle);
+	NetworkInSync = IsNetworkCommandReady(NextNetworkUpdateCycle(GameCycle));
 }
 
 //@}
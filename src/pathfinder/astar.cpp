@@ -44,6 +44,8 @@
 
 #include "pathfinder.h"
 
+#include "astar_openset.h"
+
 #include <stdio.h>
 
 /*----------------------------------------------------------------------------
@@ -55,12 +57,9 @@ struct Node {
 	short int CostToGoal;     /// Estimated cost to goal
 	char InGoal;        /// is this point in the goal
 	char Direction;     /// Direction for trace back
-};
-
-struct Open {
-	Vec2i pos;
-	short int Costs; /// complete costs to goal
-	unsigned short int O;     /// Offset into matrix
+#ifdef ASTAR_HEAP_OPEN_SET
+	int OpenIndex;      /// Position in the open set + 1, 0 if not in it
+#endif
 };
 
 //for 32 bit signed int
@@ -91,16 +90,16 @@ static Node *AStarMatrix;
 static int *CloseSet;
 static int CloseSetSize;
 static int Threshold;
-static int OpenSetMaxSize;
 static int AStarMatrixSize;
 #define MAX_CLOSE_SET_RATIO 4
-#define MAX_OPEN_SET_RATIO 8 // 10,16 to small
 
 /// see pathfinder.h
 int AStarFixedUnitCrossingCost;// = MaxMapWidth * MaxMapHeight;
 int AStarMovingUnitCrossingCost = 5;
 bool AStarKnowUnseenTerrain = false;
 int AStarUnknownTerrainCost = 2;
+/// Number of nodes expanded by AStarFindPath, used to budget the searches
+unsigned int AStarExpandedNodes;
 /// Used to temporary make enemy units unpassable (needs for correct path lenght calculating for automatic targeting alorithm)
 static bool AStarFixedEnemyUnitsUnpassable = false;
 
@@ -111,14 +110,25 @@ static int AStarGoalX;
 static int AStarGoalY;
 
 /**
-**  The Open set is handled by a stored array
-**  the end of the array holds the item with the smallest cost.
+**  The Open set is handled by a sorted array, the end of the array
+**  holds the item with the smallest cost.
+**
+**  Define ASTAR_HEAP_OPEN_SET to use a binary heap instead, where each
+**  node of AStarMatrix knows its position in the heap. To compare them,
+**  play the same replay with both builds and ASTAR_PROFILE defined, and
+**  look at the AStarFindPath line of profile.txt.
 */
+#ifdef ASTAR_HEAP_OPEN_SET
+struct AStarMatrixOpenIndex {
+	int &operator()(int o) const { return AStarMatrix[o].OpenIndex; }
+};
 
 /// The set of Open nodes
-static Open *OpenSet;
-/// The size of the open node set
-static int OpenSetSize;
+static AStarOpenSet<AStarMatrixOpenIndex> OpenSet((AStarMatrixOpenIndex()));
+#else
+/// The set of Open nodes
+static AStarSortedOpenSet OpenSet;
+#endif
 
 static int *CostMoveToCache;
 static const int CacheNotSet = -5;
@@ -265,8 +275,8 @@ void InitAStar(int mapWidth, int mapHeight)
 	Threshold = AStarMapWidth * AStarMapHeight / MAX_CLOSE_SET_RATIO;
 	CloseSet = new int[Threshold];
 
-	OpenSetMaxSize = AStarMapWidth * AStarMapHeight / MAX_OPEN_SET_RATIO;
-	OpenSet = new Open[OpenSetMaxSize];
+	// a node is never twice in the open set
+	OpenSet.Init(AStarMapWidth * AStarMapHeight);
 
 	CostMoveToCache = new int[AStarMapWidth * AStarMapHeight];
 
@@ -287,9 +297,7 @@ void FreeAStar()
 	delete[] CloseSet;
 	CloseSet = NULL;
 	CloseSetSize = 0;
-	delete[] OpenSet;
-	OpenSet = NULL;
-	OpenSetSize = 0;
+	OpenSet.Free();
 	delete[] CostMoveToCache;
 	CostMoveToCache = NULL;
 
@@ -311,6 +319,7 @@ static void AStarCleanUp()
 {
 	ProfileBegin("AStarCleanUp");
 
+	OpenSet.Clear();
 	if (CloseSetSize >= Threshold) {
 		AStarPrepare();
 	} else {
@@ -366,132 +375,39 @@ static void CostMoveToCacheCleanUp()
 	ProfileEnd("CostMoveToCacheCleanUp");
 }
 
-/**
-**  Find the best node in the current open node set
-**  Returns the position of this node in the open node set
-*/
-#define AStarFindMinimum() (OpenSetSize - 1)
-
-
-/**
-**  Remove the minimum from the open node set
-*/
-static void AStarRemoveMinimum(int pos)
-{
-	Assert(pos == OpenSetSize - 1);
-
-	OpenSetSize--;
-}
-
 /**
 **  Add a new node to the open set (and update the heap structure)
-**
-**  @return  0 or PF_FAILED
 */
-static inline int AStarAddNode(const Vec2i &pos, int o, int costs)
+static inline void AStarAddNode(const Vec2i &pos, int o, int costs)
 {
 	ProfileBegin("AStarAddNode");
 
-	int bigi = 0, smalli = OpenSetSize;
-	int midcost;
-	int midi;
-	int midCostToGoal;
-	int midDist;
-	const Open *open;
-
-	if (OpenSetSize + 1 >= OpenSetMaxSize) {
-		fprintf(stderr, "A* internal error: raise Open Set Max Size "
-				"(current value %d)\n", OpenSetMaxSize);
-		ProfileEnd("AStarAddNode");
-		return PF_FAILED;
-	}
-
-	const int costToGoal = AStarMatrix[o].CostToGoal;
-	const int dist = MyAbs(pos.x - AStarGoalX) + MyAbs(pos.y - AStarGoalY);
-
-	// find where we should insert this node.
-	// binary search where to insert the new node
-	while (bigi < smalli) {
-		midi = (smalli + bigi) >> 1;
-		open = &OpenSet[midi];
-		midcost = open->Costs;
-		midCostToGoal = AStarMatrix[open->O].CostToGoal;
-		midDist = MyAbs(open->pos.x - AStarGoalX) + MyAbs(open->pos.y - AStarGoalY);
-		if (costs > midcost || (costs == midcost
-								&& (costToGoal > midCostToGoal || (costToGoal == midCostToGoal
-																   && dist > midDist)))) {
-			smalli = midi;
-		} else if (costs < midcost || (costs == midcost
-									   && (costToGoal < midCostToGoal || (costToGoal == midCostToGoal
-											   && dist < midDist)))) {
-			if (bigi == midi) {
-				bigi++;
-			} else {
-				bigi = midi;
-			}
-		} else {
-			bigi = midi;
-			smalli = midi;
-		}
-	}
-
-	if (OpenSetSize > bigi) {
-		// free a the slot for our node
-		memmove(&OpenSet[bigi + 1], &OpenSet[bigi], (OpenSetSize - bigi) * sizeof(Open));
-	}
-
-	// fill our new node
-	OpenSet[bigi].pos = pos;
-	OpenSet[bigi].O = o;
-	OpenSet[bigi].Costs = costs;
-	++OpenSetSize;
+	AStarOpenNode node;
+	node.Costs = costs;
+	node.CostToGoal = AStarMatrix[o].CostToGoal;
+	node.Dist = MyAbs(pos.x - AStarGoalX) + MyAbs(pos.y - AStarGoalY);
+	node.O = o;
+	OpenSet.Push(node);
 
 	ProfileEnd("AStarAddNode");
-
-	return 0;
 }
 
 /**
 **  Change the cost associated to an open node.
-**  Can be further optimised knowing that the new cost MUST BE LOWER
-**  than the old one.
+**  The new cost MUST BE LOWER than the old one.
 */
-static void AStarReplaceNode(int pos)
+static void AStarReplaceNode(int pos, int costs)
 {
 	ProfileBegin("AStarReplaceNode");
 
-	Open node;
+	AStarOpenNode node = OpenSet[pos];
+	node.Costs = costs;
+	node.CostToGoal = AStarMatrix[node.O].CostToGoal;
+	OpenSet.Decrease(pos, node);
 
-	// Remove the outdated node
-	node = OpenSet[pos];
-	OpenSetSize--;
-	memmove(&OpenSet[pos], &OpenSet[pos+1], sizeof(Open) * (OpenSetSize-pos));
-
-	// Re-add the node with the new cost
-	AStarAddNode(node.pos, node.O, node.Costs);
 	ProfileEnd("AStarReplaceNode");
 }
 
-
-/**
-**  Check if a node is already in the open set.
-**
-**  @return  -1 if not found and the position of the node in the table if found.
-*/
-static int AStarFindNode(int eo)
-{
-	ProfileBegin("AStarFindNode");
-
-	for (int i = 0; i < OpenSetSize; ++i) {
-		if (OpenSet[i].O == eo) {
-			ProfileEnd("AStarFindNode");
-			return i;
-		}
-	}
-	ProfileEnd("AStarFindNode");
-	return -1;
-}
-
 /**
 **  Add a node to the closed set
 */
@@ -938,7 +854,6 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 	AStarCleanUp();
 	CostMoveToCacheCleanUp();
 
-	OpenSetSize = 0;
 	CloseSetSize = 0;
 
 	if (!AStarMarkGoal(goalPos, gw, gh, tilesizex, tilesizey, minrange, maxrange, unit)) {
@@ -955,15 +870,11 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 	// 8 to say we are came from nowhere.
 	AStarMatrix[eo].Direction = 8;
 
-	// place start point in open, it that failed, try another pathfinder
+	// place start point in open
 	int costToGoal = AStarCosts(startPos, goalPos);
 	AStarMatrix[eo].CostToGoal = costToGoal;
-	if (AStarAddNode(startPos, eo, 1 + costToGoal) == PF_FAILED) {
-		ret = PF_FAILED;
-		ProfileEnd("AStarFindPath");
-		return ret;
-	}
-	AStarAddToClose(OpenSet[0].O);
+	AStarAddNode(startPos, eo, 1 + costToGoal);
+	AStarAddToClose(eo);
 	if (AStarMatrix[eo].InGoal) {
 		ret = PF_REACHED;
 		ProfileEnd("AStarFindPath");
@@ -974,12 +885,12 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 	//  Begin search
 	while (1) {
 		// Find the best node of from the open set
-		const int shortest = AStarFindMinimum();
-		const int x = OpenSet[shortest].pos.x;
-		const int y = OpenSet[shortest].pos.y;
-		const int o = OpenSet[shortest].O;
+		const int o = OpenSet.Top().O;
+		const int y = o / AStarMapWidth;
+		const int x = o - y * AStarMapWidth;
 
-		AStarRemoveMinimum(shortest);
+		OpenSet.Pop();
+		++AStarExpandedNodes;
 
 		// If we have reached the goal, then exit.
 		if (AStarMatrix[o].InGoal == 1) {
@@ -1044,11 +955,7 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 				AStarMatrix[eo].Direction = i;
 				costToGoal = AStarCosts(endPos, goalPos);
 				AStarMatrix[eo].CostToGoal = costToGoal;
-				if (AStarAddNode(endPos, eo, AStarMatrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
-					ret = PF_FAILED;
-					ProfileEnd("AStarFindPath");
-					return ret;
-				}
+				AStarAddNode(endPos, eo, AStarMatrix[eo].CostFromStart + costToGoal);
 				// we add the point to the close set
 				AStarAddToClose(eo);
 			} else if (new_cost < AStarMatrix[eo].CostFromStart) {
@@ -1057,24 +964,18 @@ int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 				AStarMatrix[eo].CostFromStart = new_cost;
 				AStarMatrix[eo].Direction = i;
 				// this point might be already in the OpenSet
-				const int j = AStarFindNode(eo);
+				const int j = OpenSet.Find(eo);
+				costToGoal = AStarCosts(endPos, goalPos);
+				AStarMatrix[eo].CostToGoal = costToGoal;
 				if (j == -1) {
-					costToGoal = AStarCosts(endPos, goalPos);
-					AStarMatrix[eo].CostToGoal = costToGoal;
-					if (AStarAddNode(endPos, eo, AStarMatrix[eo].CostFromStart + costToGoal) == PF_FAILED) {
-						ret = PF_FAILED;
-						ProfileEnd("AStarFindPath");
-						return ret;
-					}
+					AStarAddNode(endPos, eo, AStarMatrix[eo].CostFromStart + costToGoal);
 				} else {
-					costToGoal = AStarCosts(endPos, goalPos);
-					AStarMatrix[eo].CostToGoal = costToGoal;
-					AStarReplaceNode(j);
+					AStarReplaceNode(j, AStarMatrix[eo].CostFromStart + costToGoal);
 				}
 				// we don't have to add this point to the close set
 			}
 		}
-		if (OpenSetSize <= 0) { // no new nodes generated
+		if (OpenSet.Empty()) { // no new nodes generated
 			ret = PF_UNREACHABLE;
 			ProfileEnd("AStarFindPath");
 			return ret;
@@ -1116,7 +1017,7 @@ StatsNode *AStarGetStats()
 		}
 	}
 
-	for (int i = 0; i < OpenSetSize; ++i) {
+	for (int i = 0; i < OpenSet.GetSize(); ++i) {
 		stats[OpenSet[i].O].Costs = OpenSet[i].Costs;
 	}
 	return stats;
@@ -0,0 +1,644 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name hpastar.cpp - The hierarchical path finder routines. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+//@{
+
+/*
+**  Hierarchical path finding (HPA*) on top of the a* of astar.cpp.
+**
+**  The map is split into clusters of HPAClusterSize x HPAClusterSize
+**  tiles. Where two neighbour clusters share passable border tiles we
+**  put entrance nodes, and the cost between the entrances of a cluster
+**  is computed once with a small dijkstra inside the cluster.
+**
+**  A long query is first solved on this abstract graph, then the real
+**  a* is only asked for a path to the next waypoint, which is close.
+**  Units only use the first PathFinderOutput::MAX_PATH_LENGTH steps of
+**  a path anyway, and ask again when they are consumed.
+**
+**  There is one graph per movement mask. It only knows the terrain
+**  (units and buildings flags of the map fields), it is built lazily
+**  and only the clusters touched by PathfinderTerrainChanged() are
+**  rebuilt on the next query.
+**
+**  Unless AStarKnowUnseenTerrain, the abstract search only goes through
+**  the clusters the player of the unit has fully explored, so the route
+**  doesn't depend on terrain the player can't know. Otherwise the plain
+**  a* is used, which handles the unexplored tiles.
+**
+**  It is off by default (see HierarchicalPathfinding), until it is tested
+**  and measured against the plain a*.
+*/
+
+/*----------------------------------------------------------------------------
+--  Includes
+----------------------------------------------------------------------------*/
+
+#include "stratagus.h"
+
+#include "map.h"
+#include "player.h"
+#include "tileset.h"
+#include "unit.h"
+#include "unittype.h"
+
+#include "pathfinder.h"
+
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <vector>
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+extern int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						 int tilesizex, int tilesizey, int minrange,
+						 int maxrange, char *path, int pathlen, const CUnit &unit);
+
+/// Size of a cluster side, in tiles
+static const int HPAClusterSize = 16;
+/// Border segments longer than that get two entrances, one at each end
+static const int HPAMaxEntranceWidth = 6;
+/// Under this distance to goal, the plain a* is used
+static const int HPAMinDistance = 4 * HPAClusterSize;
+/// Max distance of the waypoint given to a*
+static const int HPARefineDistance = 2 * HPAClusterSize;
+
+/// Flags of units moving on the map, ignored by the abstract graph
+static const unsigned int HPAUnitFlags = MapFieldLandUnit | MapFieldAirUnit | MapFieldSeaUnit;
+
+struct HPALink {
+	int Node;     /// node index in the cluster
+	int Partner;  /// map offset of the node in the neighbour cluster
+};
+
+struct HPACluster {
+	HPACluster() : Dirty(true) {}
+
+	std::vector<int> Nodes;      /// map offset of the entrance nodes
+	std::vector<HPALink> Links;  /// links to the neighbour clusters
+	std::vector<int> Costs;      /// Nodes.size()^2 costs between nodes, -1 if not connected
+	bool Dirty;                  /// must be rebuilt before use
+};
+
+/**
+**  Abstract graph of the map for one movement mask.
+*/
+class CHPAGraph
+{
+public:
+	explicit CHPAGraph(unsigned int mask);
+
+	void MarkDirty(int cx, int cy);
+	void Refine();
+
+	int ClusterIndex(int offset) const;
+	const HPACluster &GetCluster(int index) const { return Clusters[index]; }
+	int NodeIndex(int offset) const { return NodeIndexes[offset]; }
+
+	/// Costs of the tiles of a cluster from pos, -1 if not reachable
+	void Dijkstra(int cluster, const Vec2i &pos, std::vector<int> &costs) const;
+
+private:
+	bool IsPassable(int offset) const { return !(Map.Field(offset)->Flags & Mask); }
+	void BuildCluster(int cx, int cy);
+	void AddEntrances(int cluster, const Vec2i &first, const Vec2i &step, const Vec2i &normal, int length);
+	int AddNode(int cluster, int offset);
+
+private:
+	const unsigned int Mask;          /// blocking flags of the graph
+	std::vector<HPACluster> Clusters; /// clusters, row by row
+	std::vector<int> NodeIndexes;     /// index in its cluster of each map offset, -1 if not a node
+	bool Dirty;                       /// some clusters must be rebuilt
+};
+
+/*----------------------------------------------------------------------------
+--  Variables
+----------------------------------------------------------------------------*/
+
+/// see pathfinder.h
+bool HierarchicalPathfinding = false;
+
+static int HPAMapWidth;
+static int HPAMapHeight;
+static int HPAClustersWidth;
+static int HPAClustersHeight;
+
+/// Abstract graphs, by movement mask
+static std::map<unsigned int, CHPAGraph *> HPAGraphs;
+
+/// Abstract search data, indexed by map offset. Two extra slots are the start and the goal.
+static std::vector<int> HPACostFromStart;
+static std::vector<int> HPAParent;
+static std::vector<unsigned int> HPAVisited;
+static unsigned int HPASearchId;
+/// Search in which the explored state of each cluster was computed
+static std::vector<unsigned int> HPAClusterSearch;
+/// Whether the player of the search explored all the tiles of each cluster
+static std::vector<char> HPAClusterExplored;
+
+/*----------------------------------------------------------------------------
+--  Graph
+----------------------------------------------------------------------------*/
+
+CHPAGraph::CHPAGraph(unsigned int mask) : Mask(mask), Dirty(true)
+{
+	Clusters.resize(HPAClustersWidth * HPAClustersHeight);
+	NodeIndexes.resize(HPAMapWidth * HPAMapHeight, -1);
+}
+
+int CHPAGraph::ClusterIndex(int offset) const
+{
+	const int y = offset / HPAMapWidth;
+	const int x = offset - y * HPAMapWidth;
+	return (x / HPAClusterSize) + (y / HPAClusterSize) * HPAClustersWidth;
+}
+
+void CHPAGraph::MarkDirty(int cx, int cy)
+{
+	if (cx < 0 || cy < 0 || cx >= HPAClustersWidth || cy >= HPAClustersHeight) {
+		return;
+	}
+	Clusters[cx + cy * HPAClustersWidth].Dirty = true;
+	Dirty = true;
+}
+
+/**
+**  Rebuild all the dirty clusters.
+*/
+void CHPAGraph::Refine()
+{
+	if (!Dirty) {
+		return;
+	}
+	for (int cy = 0; cy < HPAClustersHeight; ++cy) {
+		for (int cx = 0; cx < HPAClustersWidth; ++cx) {
+			if (Clusters[cx + cy * HPAClustersWidth].Dirty) {
+				BuildCluster(cx, cy);
+			}
+		}
+	}
+	Dirty = false;
+}
+
+int CHPAGraph::AddNode(int cluster, int offset)
+{
+	HPACluster &c = Clusters[cluster];
+	if (NodeIndexes[offset] == -1) {
+		NodeIndexes[offset] = c.Nodes.size();
+		c.Nodes.push_back(offset);
+	}
+	return NodeIndexes[offset];
+}
+
+/**
+**  Add the entrances of one border of a cluster.
+**
+**  The neighbour cluster scans the same border in the same order,
+**  so both sides always agree on the entrances.
+**
+**  @param cluster  cluster index.
+**  @param first    first border tile of the cluster.
+**  @param step     direction along the border.
+**  @param normal   direction to the neighbour cluster.
+**  @param length   number of tiles of the border.
+*/
+void CHPAGraph::AddEntrances(int cluster, const Vec2i &first, const Vec2i &step, const Vec2i &normal, int length)
+{
+	int start = -1;
+	for (int i = 0; i <= length; ++i) {
+		bool open = false;
+		if (i < length) {
+			const Vec2i pos(first.x + i * step.x, first.y + i * step.y);
+			const Vec2i other = pos + normal;
+			open = IsPassable(Map.getIndex(pos)) && IsPassable(Map.getIndex(other));
+		}
+		if (open && start == -1) {
+			start = i;
+		} else if (!open && start != -1) {
+			const int end = i - 1;
+			int ends[2] = { (start + end) / 2, -1 };
+			if (end - start + 1 >= HPAMaxEntranceWidth) {
+				ends[0] = start;
+				ends[1] = end;
+			}
+			for (int j = 0; j < 2 && ends[j] != -1; ++j) {
+				const Vec2i pos(first.x + ends[j] * step.x, first.y + ends[j] * step.y);
+				HPALink link;
+				link.Node = AddNode(cluster, Map.getIndex(pos));
+				link.Partner = Map.getIndex(pos + normal);
+				Clusters[cluster].Links.push_back(link);
+			}
+			start = -1;
+		}
+	}
+}
+
+void CHPAGraph::BuildCluster(int cx, int cy)
+{
+	const int index = cx + cy * HPAClustersWidth;
+	HPACluster &cluster = Clusters[index];
+
+	for (size_t i = 0; i != cluster.Nodes.size(); ++i) {
+		NodeIndexes[cluster.Nodes[i]] = -1;
+	}
+	cluster.Nodes.clear();
+	cluster.Links.clear();
+
+	const Vec2i topLeft(cx * HPAClusterSize, cy * HPAClusterSize);
+	const int w = std::min(HPAClusterSize, HPAMapWidth - topLeft.x);
+	const int h = std::min(HPAClusterSize, HPAMapHeight - topLeft.y);
+	const Vec2i right(1, 0);
+	const Vec2i down(0, 1);
+
+	if (cy > 0) {
+		AddEntrances(index, topLeft, right, Vec2i(0, -1), w);
+	}
+	if (cy + 1 < HPAClustersHeight) {
+		AddEntrances(index, Vec2i(topLeft.x, topLeft.y + h - 1), right, down, w);
+	}
+	if (cx > 0) {
+		AddEntrances(index, topLeft, down, Vec2i(-1, 0), h);
+	}
+	if (cx + 1 < HPAClustersWidth) {
+		AddEntrances(index, Vec2i(topLeft.x + w - 1, topLeft.y), down, right, h);
+	}
+
+	const size_t n = cluster.Nodes.size();
+	cluster.Costs.assign(n * n, -1);
+	std::vector<int> costs;
+	for (size_t i = 0; i != n; ++i) {
+		const int offset = cluster.Nodes[i];
+		Dijkstra(index, Vec2i(offset % HPAMapWidth, offset / HPAMapWidth), costs);
+		for (size_t j = 0; j != n; ++j) {
+			const int node = cluster.Nodes[j];
+			const Vec2i pos(node % HPAMapWidth - topLeft.x, node / HPAMapWidth - topLeft.y);
+			cluster.Costs[i * n + j] = costs[pos.x + pos.y * HPAClusterSize];
+		}
+	}
+	cluster.Dirty = false;
+}
+
+/**
+**  Compute the cost to reach each tile of a cluster from pos.
+**  The costs are the ones of CostMoveTo without units.
+**
+**  @param cluster  cluster index.
+**  @param pos      start position, inside the cluster.
+**  @param costs    costs, HPAClusterSize x HPAClusterSize, -1 if unreachable.
+*/
+void CHPAGraph::Dijkstra(int cluster, const Vec2i &pos, std::vector<int> &costs) const
+{
+	const Vec2i topLeft((cluster % HPAClustersWidth) * HPAClusterSize,
+						(cluster / HPAClustersWidth) * HPAClusterSize);
+	const int w = std::min(HPAClusterSize, HPAMapWidth - topLeft.x);
+	const int h = std::min(HPAClusterSize, HPAMapHeight - topLeft.y);
+	typedef std::pair<int, int> CostIndex;
+	std::priority_queue<CostIndex, std::vector<CostIndex>, std::greater<CostIndex> > open;
+
+	costs.assign(HPAClusterSize * HPAClusterSize, -1);
+	const int start = (pos.x - topLeft.x) + (pos.y - topLeft.y) * HPAClusterSize;
+	costs[start] = 0;
+	open.push(CostIndex(0, start));
+	while (!open.empty()) {
+		const CostIndex current = open.top();
+		open.pop();
+		if (current.first != costs[current.second]) {
+			continue;
+		}
+		const int x = current.second % HPAClusterSize;
+		const int y = current.second / HPAClusterSize;
+		for (int i = 0; i < 8; ++i) {
+			const int ex = x + Heading2X[i];
+			const int ey = y + Heading2Y[i];
+			if (ex < 0 || ey < 0 || ex >= w || ey >= h) {
+				continue;
+			}
+			const int offset = Map.getIndex(topLeft.x + ex, topLeft.y + ey);
+			if (!IsPassable(offset)) {
+				continue;
+			}
+			const int cost = current.first + 1 + Map.Field(offset)->getCost();
+			int &c = costs[ex + ey * HPAClusterSize];
+			if (c == -1 || cost < c) {
+				c = cost;
+				open.push(CostIndex(cost, ex + ey * HPAClusterSize));
+			}
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+--  Functions
+----------------------------------------------------------------------------*/
+
+/**
+**  Init the hierarchical path finder.
+*/
+void InitHierarchicalPathfinder(int mapWidth, int mapHeight)
+{
+	Assert(HPAGraphs.empty());
+
+	HPAMapWidth = mapWidth;
+	HPAMapHeight = mapHeight;
+	HPAClustersWidth = (mapWidth + HPAClusterSize - 1) / HPAClusterSize;
+	HPAClustersHeight = (mapHeight + HPAClusterSize - 1) / HPAClusterSize;
+
+	HPACostFromStart.assign(mapWidth * mapHeight + 2, 0);
+	HPAParent.assign(mapWidth * mapHeight + 2, -1);
+	HPAVisited.assign(mapWidth * mapHeight + 2, 0);
+	HPAClusterSearch.assign(HPAClustersWidth * HPAClustersHeight, 0);
+	HPAClusterExplored.assign(HPAClustersWidth * HPAClustersHeight, 0);
+	HPASearchId = 0;
+}
+
+/**
+**  Free the hierarchical path finder.
+*/
+void FreeHierarchicalPathfinder()
+{
+	for (std::map<unsigned int, CHPAGraph *>::iterator it = HPAGraphs.begin(); it != HPAGraphs.end(); ++it) {
+		delete it->second;
+	}
+	HPAGraphs.clear();
+	HPACostFromStart.clear();
+	HPAParent.clear();
+	HPAVisited.clear();
+	HPAClusterSearch.clear();
+	HPAClusterExplored.clear();
+}
+
+/**
+**  The terrain of an area has changed (wood, rock, wall or building).
+**  Mark the clusters whose entrances or inner costs may change.
+**
+**  @param pos  top left tile of the area.
+**  @param w    width of the area.
+**  @param h    height of the area.
+*/
+void PathfinderTerrainChanged(const Vec2i &pos, int w, int h)
+{
+	if (HPAGraphs.empty()) {
+		return;
+	}
+	const int minx = pos.x / HPAClusterSize;
+	const int miny = pos.y / HPAClusterSize;
+	const int maxx = (pos.x + w - 1) / HPAClusterSize;
+	const int maxy = (pos.y + h - 1) / HPAClusterSize;
+	// Tiles on the border of a cluster also change the entrances of the neighbour
+	const bool left = pos.x % HPAClusterSize == 0;
+	const bool top = pos.y % HPAClusterSize == 0;
+	const bool right = (pos.x + w) % HPAClusterSize == 0;
+	const bool bottom = (pos.y + h) % HPAClusterSize == 0;
+
+	for (std::map<unsigned int, CHPAGraph *>::iterator it = HPAGraphs.begin(); it != HPAGraphs.end(); ++it) {
+		CHPAGraph &graph = *it->second;
+		for (int cy = miny - top; cy <= maxy + bottom; ++cy) {
+			for (int cx = minx - left; cx <= maxx + right; ++cx) {
+				graph.MarkDirty(cx, cy);
+			}
+		}
+	}
+}
+
+static CHPAGraph &GetHPAGraph(unsigned int mask)
+{
+	CHPAGraph *&graph = HPAGraphs[mask];
+	if (graph == NULL) {
+		graph = new CHPAGraph(mask);
+	}
+	graph->Refine();
+	return *graph;
+}
+
+static inline int HPACosts(int offset, const Vec2i &goalPos)
+{
+	const Vec2i pos(offset % HPAMapWidth, offset / HPAMapWidth);
+	return std::max(abs(pos.x - goalPos.x), abs(pos.y - goalPos.y));
+}
+
+/**
+**  Check if the abstract search may go through a cluster.
+**
+**  @param cluster  cluster index.
+**  @param player   player of the unit, NULL if it knows the unseen terrain.
+**
+**  @return true if player is NULL or explored all the tiles of the cluster.
+*/
+static bool HPAIsClusterKnown(int cluster, const CPlayer *player)
+{
+	if (player == NULL) {
+		return true;
+	}
+	if (HPAClusterSearch[cluster] != HPASearchId) {
+		const Vec2i topLeft((cluster % HPAClustersWidth) * HPAClusterSize,
+							(cluster / HPAClustersWidth) * HPAClusterSize);
+		const int w = std::min(HPAClusterSize, HPAMapWidth - topLeft.x);
+		const int h = std::min(HPAClusterSize, HPAMapHeight - topLeft.y);
+		bool explored = true;
+
+		for (int y = 0; y < h && explored; ++y) {
+			const CMapField *mf = Map.Field(topLeft.x, topLeft.y + y);
+			for (int x = 0; x < w; ++x, ++mf) {
+				if (!mf->playerInfo.IsExplored(*player)) {
+					explored = false;
+					break;
+				}
+			}
+		}
+		HPAClusterSearch[cluster] = HPASearchId;
+		HPAClusterExplored[cluster] = explored;
+	}
+	return HPAClusterExplored[cluster] != 0;
+}
+
+/**
+**  Search the abstract graph, from startPos to goalPos.
+**
+**  @param graph    abstract graph for the unit.
+**  @param startPos start tile.
+**  @param goalPos  goal tile.
+**  @param player   player of the unit, NULL if it knows the unseen terrain.
+**  @param path     where to store the map offsets of the nodes, from start to goal.
+**
+**  @return true if a path was found.
+*/
+static bool HPAFindAbstractPath(const CHPAGraph &graph, const Vec2i &startPos, const Vec2i &goalPos,
+								const CPlayer *player, std::vector<int> &path)
+{
+	const int startId = HPAMapWidth * HPAMapHeight;
+	const int goalId = startId + 1;
+	const int startCluster = graph.ClusterIndex(Map.getIndex(startPos));
+	const int goalCluster = graph.ClusterIndex(Map.getIndex(goalPos));
+
+	++HPASearchId;
+	if (!HPAIsClusterKnown(startCluster, player) || !HPAIsClusterKnown(goalCluster, player)) {
+		return false;
+	}
+
+	// Connect start and goal to the entrances of their cluster
+	std::vector<int> startCosts;
+	std::vector<int> goalCosts;
+	graph.Dijkstra(startCluster, startPos, startCosts);
+	graph.Dijkstra(goalCluster, goalPos, goalCosts);
+	const Vec2i goalTopLeft((goalCluster % HPAClustersWidth) * HPAClusterSize,
+							(goalCluster / HPAClustersWidth) * HPAClusterSize);
+	const Vec2i startTopLeft((startCluster % HPAClustersWidth) * HPAClusterSize,
+							 (startCluster / HPAClustersWidth) * HPAClusterSize);
+
+	typedef std::pair<int, int> CostId;
+	std::priority_queue<CostId, std::vector<CostId>, std::greater<CostId> > open;
+
+	const HPACluster &first = graph.GetCluster(startCluster);
+	for (size_t i = 0; i != first.Nodes.size(); ++i) {
+		const int node = first.Nodes[i];
+		const int cost = startCosts[(node % HPAMapWidth - startTopLeft.x) + (node / HPAMapWidth - startTopLeft.y) * HPAClusterSize];
+		if (cost < 0) {
+			continue;
+		}
+		HPAVisited[node] = HPASearchId;
+		HPACostFromStart[node] = cost;
+		HPAParent[node] = startId;
+		open.push(CostId(cost + HPACosts(node, goalPos), node));
+	}
+
+	while (!open.empty()) {
+		const CostId current = open.top();
+		open.pop();
+		const int id = current.second;
+		if (id == goalId) {
+			break;
+		}
+		const int costFromStart = HPACostFromStart[id];
+		if (current.first != costFromStart + HPACosts(id, goalPos)) {
+			continue; // outdated entry
+		}
+		const int clusterIndex = graph.ClusterIndex(id);
+		const HPACluster &cluster = graph.GetCluster(clusterIndex);
+		const int nodeIndex = graph.NodeIndex(id);
+		const size_t n = cluster.Nodes.size();
+
+		if (clusterIndex == goalCluster) {
+			const int cost = goalCosts[(id % HPAMapWidth - goalTopLeft.x) + (id / HPAMapWidth - goalTopLeft.y) * HPAClusterSize];
+			if (cost >= 0 && (HPAVisited[goalId] != HPASearchId || costFromStart + cost < HPACostFromStart[goalId])) {
+				HPAVisited[goalId] = HPASearchId;
+				HPACostFromStart[goalId] = costFromStart + cost;
+				HPAParent[goalId] = id;
+				open.push(CostId(costFromStart + cost, goalId));
+			}
+		}
+		for (size_t i = 0; i != n + cluster.Links.size(); ++i) {
+			int next;
+			int cost;
+			if (i < n) {
+				next = cluster.Nodes[i];
+				cost = cluster.Costs[nodeIndex * n + i];
+				if (next == id || cost < 0) {
+					continue;
+				}
+			} else {
+				const HPALink &link = cluster.Links[i - n];
+				if (link.Node != nodeIndex) {
+					continue;
+				}
+				next = link.Partner;
+				if (!HPAIsClusterKnown(graph.ClusterIndex(next), player)) {
+					continue;
+				}
+				cost = 1 + Map.Field(next)->getCost();
+			}
+			const int newCost = costFromStart + cost;
+			if (HPAVisited[next] != HPASearchId || newCost < HPACostFromStart[next]) {
+				HPAVisited[next] = HPASearchId;
+				HPACostFromStart[next] = newCost;
+				HPAParent[next] = id;
+				open.push(CostId(newCost + HPACosts(next, goalPos), next));
+			}
+		}
+	}
+	if (HPAVisited[goalId] != HPASearchId) {
+		return false;
+	}
+	path.clear();
+	for (int id = HPAParent[goalId]; id != startId; id = HPAParent[id]) {
+		path.push_back(id);
+	}
+	std::reverse(path.begin(), path.end());
+	return true;
+}
+
+/**
+**  Find path, using the abstract graph for long distances.
+**
+**  Same parameters and results as AStarFindPath, but the returned
+**  length may be the one to an intermediate waypoint.
+**  Falls back to AStarFindPath when the abstract graph can't help.
+*/
+int HierarchicalFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+						 int tilesizex, int tilesizey, int minrange, int maxrange,
+						 char *path, int pathlen, const CUnit &unit)
+{
+	const unsigned int mask = unit.Type->MovementMask & ~HPAUnitFlags;
+	const int distance = std::max(std::max(goalPos.x - startPos.x - (tilesizex - 1), startPos.x - (goalPos.x + std::max(gw, 1) - 1)),
+								  std::max(goalPos.y - startPos.y - (tilesizey - 1), startPos.y - (goalPos.y + std::max(gh, 1) - 1)));
+
+	if (!HierarchicalPathfinding || HPAMapWidth == 0 || path == NULL || mask == 0
+		|| tilesizex != 1 || tilesizey != 1 || distance - maxrange < HPAMinDistance) {
+		return AStarFindPath(startPos, goalPos, gw, gh, tilesizex, tilesizey, minrange, maxrange, path, pathlen, unit);
+	}
+
+	const CHPAGraph &graph = GetHPAGraph(mask);
+	std::vector<int> nodes;
+	const CPlayer *player = AStarKnowUnseenTerrain ? NULL : unit.Player;
+	if (HPAFindAbstractPath(graph, startPos, goalPos, player, nodes)) {
+		// Take the farthest waypoint still close to the unit
+		int waypoint = -1;
+		for (size_t i = 0; i != nodes.size(); ++i) {
+			if (HPACosts(nodes[i], startPos) > HPARefineDistance && waypoint != -1) {
+				break;
+			}
+			if (nodes[i] != (int)Map.getIndex(startPos)) {
+				waypoint = nodes[i];
+			}
+		}
+		if (waypoint != -1) {
+			const Vec2i waypointPos(waypoint % HPAMapWidth, waypoint / HPAMapWidth);
+			const int ret = AStarFindPath(startPos, waypointPos, 0, 0, 1, 1, 0, 0, path, pathlen, unit);
+			if (ret > 0) {
+				return ret;
+			}
+		}
+	}
+	// Blocked by units, or only reachable through unexplored terrain
+	return AStarFindPath(startPos, goalPos, gw, gh, tilesizex, tilesizey, minrange, maxrange, path, pathlen, unit);
+}
+
+//@}
@@ -41,9 +41,12 @@
 
 #include "actions.h"
 #include "map.h"
+#include "player.h"
 #include "unittype.h"
 #include "unit.h"
 
+#include <map>
+
 //astar.cpp
 
 /// Init the a* data structures
@@ -52,15 +55,114 @@ extern void InitAStar(int mapWidth, int mapHeight);
 /// free the a* data structures
 extern void FreeAStar();
 
+/// Number of nodes expanded by the a*
+extern unsigned int AStarExpandedNodes;
+
 /// Find and a* path for a unit
 extern int AStarFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
 						 int tilesizex, int tilesizey, int minrange,
 						 int maxrange, char *path, int pathlen, const CUnit &unit);
 
+//hpastar.cpp
+
+/// Init the hierarchical path finder data structures
+extern void InitHierarchicalPathfinder(int mapWidth, int mapHeight);
+
+/// Free the hierarchical path finder data structures
+extern void FreeHierarchicalPathfinder();
+
+/// Find a path for a unit, through the cluster graph for long distances
+extern int HierarchicalFindPath(const Vec2i &startPos, const Vec2i &goalPos, int gw, int gh,
+								int tilesizex, int tilesizey, int minrange,
+								int maxrange, char *path, int pathlen, const CUnit &unit);
+
 /*----------------------------------------------------------------------------
 --  Variables
 ----------------------------------------------------------------------------*/
 
+/// see pathfinder.h
+int PathfinderCycleBudget = 20000;
+
+/// Budget of the path requests
+static PathRequestBudget PathRequests;
+
+#define PATH_SHARE_DISTANCE 6      /// Max distance to the step of a shared path to join
+#define PATH_SHARE_LEG_LENGTH 12   /// Max length of the leg to the step of a shared path
+
+/**
+**  What makes two path requests share a path: the same goal for units
+**  which move the same way, whatever their start.
+*/
+struct PathRequestKey {
+	explicit PathRequestKey(const PathFinderInput &input) :
+		goalPos(input.GetGoalPos()), goalSize(input.GetGoalSize()),
+		minRange(input.GetMinRange()), maxRange(input.GetMaxRange()),
+		movementMask(input.GetUnit()->Type->MovementMask),
+		unitType(input.GetUnit()->Type->UnitType),
+		tileSize(input.GetUnitSize()),
+		player(input.GetUnit()->Player->Index),
+		agressive(input.GetUnit()->IsAgressive()),
+		// Agressive units go through the enemies they can attack.
+		type(agressive ? input.GetUnit()->Type : NULL)
+	{}
+
+	bool operator<(const PathRequestKey &rhs) const
+	{
+		if (goalPos != rhs.goalPos) {
+			return goalPos.y < rhs.goalPos.y || (goalPos.y == rhs.goalPos.y && goalPos.x < rhs.goalPos.x);
+		}
+		if (goalSize != rhs.goalSize) {
+			return goalSize.y < rhs.goalSize.y || (goalSize.y == rhs.goalSize.y && goalSize.x < rhs.goalSize.x);
+		}
+		if (minRange != rhs.minRange) {
+			return minRange < rhs.minRange;
+		}
+		if (maxRange != rhs.maxRange) {
+			return maxRange < rhs.maxRange;
+		}
+		if (movementMask != rhs.movementMask) {
+			return movementMask < rhs.movementMask;
+		}
+		if (unitType != rhs.unitType) {
+			return unitType < rhs.unitType;
+		}
+		if (tileSize != rhs.tileSize) {
+			return tileSize.y < rhs.tileSize.y || (tileSize.y == rhs.tileSize.y && tileSize.x < rhs.tileSize.x);
+		}
+		if (player != rhs.player) {
+			return player < rhs.player;
+		}
+		if (agressive != rhs.agressive) {
+			return agressive < rhs.agressive;
+		}
+		if (type != rhs.type) {
+			return type && (!rhs.type || type->Slot < rhs.type->Slot);
+		}
+		return false;
+	}
+
+	Vec2i goalPos;
+	Vec2i goalSize;
+	int minRange;
+	int maxRange;
+	unsigned int movementMask;
+	int unitType;
+	Vec2i tileSize;
+	int player;
+	bool agressive;
+	const CUnitType *type;
+};
+
+/// Path found for a request
+struct PathRequestResult {
+	Vec2i StartPos;
+	int Result;
+	char Path[PathFinderOutput::MAX_PATH_LENGTH];
+};
+
+/// Paths found in this cycle, shared by the units going to the same goal
+static std::map<PathRequestKey, PathRequestResult> PathRequestCache;
+
 void TerrainTraversal::SetSize(unsigned int width, unsigned int height)
 {
 	m_values.resize((width + 2) * (height + 2));
@@ -157,6 +259,9 @@ void TerrainTraversal::Set(const Vec2i &pos, TerrainTraversal::dataType value)
 void InitPathfinder()
 {
 	InitAStar(Map.Info.MapWidth, Map.Info.MapHeight);
+	InitHierarchicalPathfinder(Map.Info.MapWidth, Map.Info.MapHeight);
+	PathRequests.Reset(PathfinderCycleBudget, GameCycle);
+	PathRequestCache.clear();
 }
 
 /**
@@ -165,6 +270,92 @@ void InitPathfinder()
 void FreePathfinder()
 {
 	FreeAStar();
+	FreeHierarchicalPathfinder();
+	PathRequestCache.clear();
+}
+
+/**
+**  Start a new game cycle for the path requests.
+**
+**  Each cycle the path requests may expand PathfinderCycleBudget nodes,
+**  the other requests are deferred, see PathRequestBudget for the order.
+**  Everything depends on the game state only, so all the network peers
+**  defer the same requests.
+*/
+void PathfinderNewCycle()
+{
+	PathRequests.NewCycle(PathfinderCycleBudget, GameCycle);
+	PathRequestCache.clear();
+}
+
+void PathRequestBudget::Reset(int budget, unsigned long cycle)
+{
+	Budget = budget;
+	BudgetLeft = budget;
+	Cycle = cycle;
+	OldestLeft = 0;
+	OldestServed = false;
+	NextOldestCount = 0;
+	// Nothing measured yet, keep the whole budget for the oldest requests.
+	SearchNodes = budget;
+	CycleNodes = 0;
+	CycleSearches = 0;
+}
+
+void PathRequestBudget::NewCycle(int budget, unsigned long cycle)
+{
+	Budget = budget;
+	BudgetLeft = budget;
+	Cycle = cycle;
+	Oldest = NextOldest;
+	OldestLeft = NextOldestCount;
+	OldestServed = false;
+	NextOldestCount = 0;
+	if (CycleSearches > 0) {
+		SearchNodes = std::max(CycleNodes / CycleSearches, 1);
+	}
+	CycleNodes = 0;
+	CycleSearches = 0;
+}
+
+bool PathRequestBudget::CanSearch(unsigned long deferredCycle) const
+{
+	if (Budget == 0) {
+		return true;
+	}
+	if (OldestLeft > 0 && deferredCycle <= Oldest) {
+		// The requests waiting for the longest time go first,
+		// at least one of them each cycle.
+		return BudgetLeft > 0 || !OldestServed;
+	}
+	if (BudgetLeft <= 0) {
+		return false;
+	}
+	// Keep what the oldest requests may use if they ask again.
+	return OldestLeft == 0 || BudgetLeft > (long long)OldestLeft * SearchNodes;
+}
+
+void PathRequestBudget::Served(unsigned long deferredCycle, int expandedNodes)
+{
+	BudgetLeft -= expandedNodes;
+	if (Budget > 0 && expandedNodes > 0) {
+		CycleNodes += expandedNodes;
+		++CycleSearches;
+	}
+	if (OldestLeft > 0 && deferredCycle <= Oldest) {
+		--OldestLeft;
+		OldestServed = true;
+	}
+}
+
+void PathRequestBudget::Deferred(unsigned long deferredCycle)
+{
+	if (NextOldestCount == 0 || deferredCycle < NextOldest) {
+		NextOldest = deferredCycle;
+		NextOldestCount = 1;
+	} else if (deferredCycle == NextOldest) {
+		++NextOldestCount;
+	}
 }
 
 /*----------------------------------------------------------------------------
@@ -272,7 +463,7 @@ int CalcPathLengthToUnit(const CUnit &src, const CUnit &dst, const int minrange,
 ----------------------------------------------------------------------------*/
 
 PathFinderInput::PathFinderInput() : unit(NULL), minRange(0), maxRange(0),
-	isRecalculatePathNeeded(true)
+	isRecalculatePathNeeded(true), isPathRequestDeferred(false), deferredCycle(0)
 {
 	unitSize.x = 0;
 	unitSize.y = 0;
@@ -312,6 +503,8 @@ void PathFinderInput::SetGoal(const Vec2i &pos, const Vec2i &size)
 	}
 	if (goalPos != newPos || goalSize != size) {
 		isRecalculatePathNeeded = true;
+		// A new goal is a new request, it doesn't keep the turn of the old one.
+		isPathRequestDeferred = false;
 	}
 	goalPos = newPos;
 	goalSize = size;
@@ -339,14 +532,130 @@ void PathFinderInput::PathRacalculated()
 	unitSize.y = unit->Type->TileHeight;
 
 	isRecalculatePathNeeded = false;
+	isPathRequestDeferred = false;
 }
 
 
+void PathFinderInput::PathRequestDeferred(unsigned long cycle)
+{
+	if (!isPathRequestDeferred) {
+		isPathRequestDeferred = true;
+		deferredCycle = cycle;
+	}
+}
+
 PathFinderOutput::PathFinderOutput()
 {
 	memset(this, 0, sizeof(*this));
 }
 
+/**
+**  Distance from pos to the goal area.
+*/
+static int GoalDistance(const Vec2i &pos, const Vec2i &goalPos, const Vec2i &goalSize)
+{
+	const int right = goalPos.x + std::max<int>(goalSize.x, 1) - 1;
+	const int bottom = goalPos.y + std::max<int>(goalSize.y, 1) - 1;
+	const int dx = pos.x < goalPos.x ? goalPos.x - pos.x : std::max(pos.x - right, 0);
+	const int dy = pos.y < goalPos.y ? goalPos.y - pos.y : std::max(pos.y - bottom, 0);
+
+	return std::max(dx, dy);
+}
+
+/**
+**  Find the step of a shared path where a unit can join it.
+**
+**  The step is the nearest one to the unit, the furthest along the path
+**  on ties, among those closer to the goal than the unit: a unit ahead of
+**  the other one never goes back to join its path.
+**
+**  @param sharedStart   Start of the shared path.
+**  @param sharedPath    Shared path, with its first step last.
+**  @param sharedLength  Number of steps in sharedPath.
+**  @param pos           Position of the unit.
+**  @param goalPos       Top left of the goal.
+**  @param goalSize      Size of the goal.
+**  @param joinPos       Where to save the position of the step.
+**
+**  @return              the number of steps of the shared path before
+**                       the step, or -1 if no step is near enough.
+*/
+int FindSharedPathJoin(const Vec2i &sharedStart, const char *sharedPath, int sharedLength,
+					   const Vec2i &pos, const Vec2i &goalPos, const Vec2i &goalSize, Vec2i &joinPos)
+{
+	const int posGoalDistance = GoalDistance(pos, goalPos, goalSize);
+	int join = -1;
+	int joinDistance = 0;
+	Vec2i step = sharedStart;
+
+	for (int i = 0; ; ++i) {
+		const Vec2i diff = step - pos;
+		const int distance = std::max(abs(diff.x), abs(diff.y));
+
+		if (distance <= PATH_SHARE_DISTANCE && (join == -1 || distance <= joinDistance)
+			&& GoalDistance(step, goalPos, goalSize) < posGoalDistance) {
+			join = i;
+			joinDistance = distance;
+			joinPos = step;
+		}
+		if (i == sharedLength) {
+			break;
+		}
+		const int direction = sharedPath[sharedLength - 1 - i];
+		step.x += Heading2X[direction];
+		step.y += Heading2Y[direction];
+	}
+	return join;
+}
+
+/**
+**  Find the path of a unit from the path found for another unit going
+**  to the same goal: a short leg to the nearest step of the shared path
+**  toward the goal, then the rest of the shared path.
+**
+**  @param shared  Path found for the other unit.
+**  @param input   Path request of the unit.
+**  @param path    Where to save the path.
+**
+**  @return        the path length, or PF_FAILED if the paths can't be joined.
+*/
+static int JoinSharedPath(const PathRequestResult &shared, const PathFinderInput &input, char *path)
+{
+	if (shared.Result <= 0) {
+		return PF_FAILED;
+	}
+	// Paths are saved with their first step last.
+	const int sharedLength = std::min<int>(shared.Result, PathFinderOutput::MAX_PATH_LENGTH);
+	const Vec2i &startPos = input.GetUnitPos();
+	Vec2i joinPos;
+	const int join = FindSharedPathJoin(shared.StartPos, shared.Path, sharedLength, startPos,
+										input.GetGoalPos(), input.GetGoalSize(), joinPos);
+	if (join == -1) {
+		return PF_FAILED;
+	}
+	char leg[PATH_SHARE_LEG_LENGTH];
+	const int legLength = AStarFindPath(startPos, joinPos, 0, 0,
+										input.GetUnitSize().x, input.GetUnitSize().y, 0, 0,
+										leg, PATH_SHARE_LEG_LENGTH, *input.GetUnit());
+	if (legLength <= 0 || legLength > PATH_SHARE_LEG_LENGTH) {
+		return PF_FAILED;
+	}
+	int result = legLength + shared.Result - join;
+	if (shared.Result > sharedLength) {
+		// Only the start of the shared path is known, find the rest later.
+		result = std::min(result, legLength + sharedLength - join);
+	}
+	const int length = std::min<int>(result, PathFinderOutput::MAX_PATH_LENGTH);
+	for (int i = 0; i != length; ++i) {
+		if (i < legLength) {
+			path[length - 1 - i] = leg[legLength - 1 - i];
+		} else {
+			path[length - 1 - i] = shared.Path[sharedLength - 1 - (join + i - legLength)];
+		}
+	}
+	return result;
+}
+
 /**
 **  Find new path.
 **
@@ -359,17 +668,49 @@ PathFinderOutput::PathFinderOutput()
 **
 **  @return      >0 remaining path length, 0 wait for path, -1
 **               reached goal, -2 can't reach the goal.
+**
+**  @note  When the nodes budget of the cycle is spent, the request is
+**         deferred and PF_WAIT is returned.
 */
 static int NewPath(PathFinderInput &input, PathFinderOutput &output)
 {
 	char *path = output.Path;
-	int i = AStarFindPath(input.GetUnitPos(),
-						  input.GetGoalPos(),
-						  input.GetGoalSize().x, input.GetGoalSize().y,
-						  input.GetUnitSize().x, input.GetUnitSize().y,
-						  input.GetMinRange(), input.GetMaxRange(),
-						  path, PathFinderOutput::MAX_PATH_LENGTH,
-						  *input.GetUnit());
+	const PathRequestKey key(input);
+	std::map<PathRequestKey, PathRequestResult>::const_iterator it = PathRequestCache.find(key);
+	const unsigned long deferredCycle = input.IsPathRequestDeferred() ? input.GetDeferredCycle() : PathRequests.GetCycle();
+	const unsigned int expandedNodes = AStarExpandedNodes;
+	int i = PF_FAILED;
+
+	if (it != PathRequestCache.end() && it->second.StartPos == input.GetUnitPos()) {
+		i = it->second.Result;
+		memcpy(path, it->second.Path, sizeof(it->second.Path));
+		PathRequests.Served(deferredCycle, 0);
+	} else {
+		if (!PathRequests.CanSearch(deferredCycle)) {
+			input.PathRequestDeferred(PathRequests.GetCycle());
+			PathRequests.Deferred(deferredCycle);
+			return PF_WAIT;
+		}
+		if (it != PathRequestCache.end()) {
+			i = JoinSharedPath(it->second, input, path);
+		}
+		if (i == PF_FAILED) {
+			i = HierarchicalFindPath(input.GetUnitPos(),
+									 input.GetGoalPos(),
+									 input.GetGoalSize().x, input.GetGoalSize().y,
+									 input.GetUnitSize().x, input.GetUnitSize().y,
+									 input.GetMinRange(), input.GetMaxRange(),
+									 path, PathFinderOutput::MAX_PATH_LENGTH,
+									 *input.GetUnit());
+			if (it == PathRequestCache.end()) {
+				PathRequestResult &result = PathRequestCache[key];
+				result.StartPos = input.GetUnitPos();
+				result.Result = i;
+				memcpy(result.Path, path, sizeof(result.Path));
+			}
+		}
+		PathRequests.Served(deferredCycle, AStarExpandedNodes - expandedNodes);
+	}
 	input.PathRacalculated();
 	if (i == PF_FAILED) {
 		i = PF_UNREACHABLE;
@@ -415,7 +756,7 @@ int NextPathElement(CUnit &unit, short int *pxd, short int *pyd)
 			output.Length = 0;
 			return result;
 		}
-		if (result == PF_REACHED) {
+		if (result == PF_REACHED || result == PF_WAIT) {
 			return result;
 		}
 	}
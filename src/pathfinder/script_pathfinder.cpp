@@ -84,6 +84,19 @@ static int CclAStar(lua_State *l)
 			AStarKnowUnseenTerrain = true;
 		} else if (!strcmp(value, "dont-know-unseen-terrain")) {
 			AStarKnowUnseenTerrain = false;
+		} else if (!strcmp(value, "cycle-node-budget")) {
+			++j;
+			i = LuaToNumber(l, j + 1);
+			if (i < 0) {
+				PrintFunction();
+				fprintf(stdout, "Cycle node budget must be non-negative\n");
+			} else {
+				PathfinderCycleBudget = i;
+			}
+		} else if (!strcmp(value, "hierarchical")) {
+			HierarchicalPathfinding = true;
+		} else if (!strcmp(value, "no-hierarchical")) {
+			HierarchicalPathfinding = false;
 		} else if (!strcmp(value, "unseen-terrain-cost")) {
 			++j;
 			i = LuaToNumber(l, j + 1);
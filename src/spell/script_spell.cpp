@@ -51,6 +51,7 @@
 #include "luacallback.h"
 #include "script_sound.h"
 #include "script.h"
+#include "unit_manager.h"
 #include "unittype.h"
 #include "upgrade.h"
 
@@ -218,6 +219,19 @@ static void CclSpellCondition(lua_State *l, ConditionInfo *condition)
 			LuaError(l, "Unsuported condition tag: %s" _C_ value);
 		}
 	}
+	// Keep what PassCondition has to check.
+	condition->CheckBoolFlag = false;
+	for (size_t i = 0; i < new_bool_size; ++i) {
+		if (condition->BoolFlag[i] != CONDITION_TRUE) {
+			condition->CheckBoolFlag = true;
+		}
+	}
+	condition->CheckedVariables.clear();
+	for (unsigned int i = 0; i < UnitTypeVar.GetNumberVariable(); i++) {
+		if (condition->Variable[i].Check) {
+			condition->CheckedVariables.push_back(i);
+		}
+	}
 }
 
 /**
@@ -298,6 +312,9 @@ static int CclDefineSpell(lua_State *l)
 	if (spell != NULL) {
 		DebugPrint("Redefining spell-type '%s'\n" _C_ identname.c_str());
 	} else {
+		if (UnitManager.IsGameDataSized()) {
+			LuaError(l, "Can't define the spell \"%s\" once units are made" _C_ identname.c_str());
+		}
 		spell = new SpellType(SpellTypeTable.size(), identname);
 		for (std::vector<CUnitType *>::size_type i = 0; i < UnitTypes.size(); ++i) { // adjust array for caster already defined
 			if (UnitTypes[i]->CanCastSpell) {
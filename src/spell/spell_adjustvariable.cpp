@@ -150,6 +150,7 @@
 		unit->Variable[i].Value += this->Var[i].IncreaseTime * unit->Variable[i].Increase;
 
 		clamp(&unit->Variable[i].Value, 0, unit->Variable[i].Max);
+		unit->ActivateBuffs();
 	}
 	return 1;
 }
@@ -129,6 +129,7 @@
 		} else {
 			target->Variable[HP_INDEX].Value += castcount * hp;
 			target->Variable[HP_INDEX].Value = std::max(target->Variable[HP_INDEX].Value, 0);
+			target->RegenActive = 1;
 		}
 	} else {
 		target->Variable[HP_INDEX].Value += castcount * hp;
@@ -121,13 +121,10 @@ static bool PassCondition(const CUnit &caster, const SpellType &spell, const CUn
 	if (!condition) { // no condition, pass.
 		return true;
 	}
-	for (unsigned int i = 0; i < UnitTypeVar.GetNumberVariable(); i++) { // for custom variables
+	for (size_t j = 0; j != condition->CheckedVariables.size(); ++j) { // for custom variables
+		const int i = condition->CheckedVariables[j];
 		const CUnit *unit;
 
-		if (!condition->Variable[i].Check) {
-			continue;
-		}
-
 		unit = (condition->Variable[i].ConditionApplyOnCaster) ? &caster : target;
 		//  Spell should target location and have unit condition.
 		if (unit == NULL) {
@@ -172,7 +169,7 @@ static bool PassCondition(const CUnit &caster, const SpellType &spell, const CUn
 			return false;
 		}
 	}
-	if (target && !target->Type->CheckUserBoolFlags(condition->BoolFlag)) {
+	if (target && condition->CheckBoolFlag && !target->Type->CheckUserBoolFlags(condition->BoolFlag)) {
 		return false;
 	}
 
@@ -550,6 +547,7 @@ int SpellCast(CUnit &caster, const SpellType &spell, CUnit *target, const Vec2i
 		}
 		caster.Player->SubCosts(spell.Costs);
 		caster.SpellCoolDownTimers[spell.Slot] = spell.CoolDown;
+		caster.BuffsActive = 1;
 		//
 		// Spells like blizzard are casted again.
 		// This is sort of confusing, we do the test again, to
@@ -70,11 +70,18 @@ public:
 	int seek(long offset, int whence);
 	long tell();
 	int write(const void *buf, size_t len);
+	int vprintf(const char *format, va_list ap);
+	void takeMemory(std::string &data);
 
 private:
 	PImpl(const PImpl &rhs); // No implementation
 	const PImpl &operator = (const PImpl &rhs); // No implementation
 
+	char *reserve(size_t len);
+	int flushBuffer();
+	int rawWrite(const void *buf, size_t len);
+	bool streamPrintf(const char *format, va_list ap);
+
 private:
 	int   cl_type;   /// type of CFile
 	FILE *cl_plain;  /// standard file pointer
@@ -84,8 +91,14 @@ private:
 #ifdef USE_BZ2LIB
 	BZFILE *cl_bz;   /// bzip2 file pointer
 #endif // !USE_BZ2LIB
+	std::string cl_memory; /// memory buffer
+	std::vector<char> cl_buffer; /// pending writes
+	size_t cl_buffered;          /// bytes used in cl_buffer
 };
 
+/// Pending writes are given to the file in blocks of this size
+#define CL_WRITE_BUFFER_SIZE (64 * 1024)
+
 CFile::CFile() : pimpl(new CFile::PImpl)
 {
 }
@@ -152,6 +165,27 @@ long CFile::tell()
 	return pimpl->tell();
 }
 
+/**
+**  CLwrite Library file write
+**
+**  @param buf  Pointer to the data to write.
+**  @param len  number of bytes to write.
+*/
+int CFile::write(const void *buf, size_t len)
+{
+	return pimpl->write(buf, len);
+}
+
+/**
+**  Move the data written to a memory file into data.
+**
+**  @param data  Filled with the written data, the file buffer is left empty.
+*/
+void CFile::takeMemory(std::string &data)
+{
+	pimpl->takeMemory(data);
+}
+
 /**
 **  CLprintf Library file write
 **
@@ -160,36 +194,10 @@ long CFile::tell()
 */
 int CFile::printf(const char *format, ...)
 {
-	int size = 500;
-	char *p = new char[size];
-	if (p == NULL) {
-		return -1;
-	}
-	while (1) {
-		// Try to print in the allocated space.
-		va_list ap;
-		va_start(ap, format);
-		const int n = vsnprintf(p, size, format, ap);
-		va_end(ap);
-		// If that worked, string was processed.
-		if (n > -1 && n < size) {
-			break;
-		}
-		// Else try again with more space.
-		if (n > -1) { // glibc 2.1
-			size = n + 1; // precisely what is needed
-		} else {    /* glibc 2.0, vc++ */
-			size *= 2;  // twice the old size
-		}
-		delete[] p;
-		p = new char[size];
-		if (p == NULL) {
-			return -1;
-		}
-	}
-	size = strlen(p);
-	int ret = pimpl->write(p, size);
-	delete[] p;
+	va_list ap;
+	va_start(ap, format);
+	const int ret = pimpl->vprintf(format, ap);
+	va_end(ap);
 	return ret;
 }
 
@@ -231,7 +239,7 @@ SDL_RWops * CFile::as_SDL_RWops()
 //  Implementation.
 //
 
-CFile::PImpl::PImpl()
+CFile::PImpl::PImpl() : cl_buffered(0)
 {
 	cl_type = CLF_TYPE_INVALID;
 }
@@ -311,7 +319,10 @@ int CFile::PImpl::open(const char *name, long openflags)
 
 	cl_type = CLF_TYPE_INVALID;
 
-	if (openflags & CL_OPEN_WRITE) {
+	if ((openflags & CL_OPEN_WRITE) && (openflags & CL_WRITE_MEMORY)) {
+		cl_memory.clear();
+		cl_type = CLF_TYPE_MEMORY;
+	} else if (openflags & CL_OPEN_WRITE) {
 #ifdef USE_BZ2LIB
 		if ((openflags & CL_WRITE_BZ2)
 			&& (cl_bz = BZ2_bzopen(strcat(strcpy(buf, name), ".bz2"), openstring))) {
@@ -389,9 +400,13 @@ int CFile::PImpl::close()
 	int tp = cl_type;
 
 	if (tp != CLF_TYPE_INVALID) {
+		flushBuffer();
 		if (tp == CLF_TYPE_PLAIN) {
 			ret = fclose(cl_plain);
 		}
+		if (tp == CLF_TYPE_MEMORY) {
+			ret = 0;
+		}
 #ifdef USE_ZLIB
 		if (tp == CLF_TYPE_GZIP) {
 			ret = gzclose(cl_gz);
@@ -415,6 +430,7 @@ int CFile::PImpl::read(void *buf, size_t len)
 	int ret = 0;
 
 	if (cl_type != CLF_TYPE_INVALID) {
+		flushBuffer();
 		if (cl_type == CLF_TYPE_PLAIN) {
 			ret = fread(buf, 1, len, cl_plain);
 		}
@@ -437,6 +453,7 @@ int CFile::PImpl::read(void *buf, size_t len)
 void CFile::PImpl::flush()
 {
 	if (cl_type != CLF_TYPE_INVALID) {
+		flushBuffer();
 		if (cl_type == CLF_TYPE_PLAIN) {
 			fflush(cl_plain);
 		}
@@ -455,7 +472,181 @@ void CFile::PImpl::flush()
 	}
 }
 
+/**
+**  Return room for len more bytes at the end of the write buffer.
+**
+**  The pending bytes are given to the file first if they don't leave
+**  enough room, the buffer only grows for writes bigger than itself.
+*/
+char *CFile::PImpl::reserve(size_t len)
+{
+	if (cl_buffered + len > cl_buffer.size()) {
+		flushBuffer();
+		if (len > cl_buffer.size()) {
+			cl_buffer.resize(std::max<size_t>(len, CL_WRITE_BUFFER_SIZE));
+		}
+	}
+	return cl_buffer.data() + cl_buffered; // may be the end when len is 0
+}
+
+/**
+**  Give the pending writes to the file.
+*/
+int CFile::PImpl::flushBuffer()
+{
+	if (cl_buffered == 0) {
+		return 0;
+	}
+	const int ret = rawWrite(&cl_buffer[0], cl_buffered);
+	cl_buffered = 0;
+	return ret;
+}
+
 int CFile::PImpl::write(const void *buf, size_t size)
+{
+	if (cl_type == CLF_TYPE_INVALID) {
+		errno = EBADF;
+		return -1;
+	}
+	if (size >= CL_WRITE_BUFFER_SIZE) {
+		flushBuffer();
+		return rawWrite(buf, size);
+	}
+	memcpy(reserve(size), buf, size);
+	cl_buffered += size;
+	return size;
+}
+
+/**
+**  Format the common "%d", "%u", "%s" and "%c" conversions, with or
+**  without the 'l' modifier, straight into the write buffer.
+**
+**  @return false, without consuming ap, if the format has other
+**          conversions, flags, widths or precisions.
+*/
+bool CFile::PImpl::streamPrintf(const char *format, va_list ap)
+{
+	for (const char *p = format; *p; ++p) {
+		if (*p != '%') {
+			continue;
+		}
+		++p;
+		if (*p == 'l') {
+			++p;
+			if (*p != 'd' && *p != 'i' && *p != 'u') {
+				return false;
+			}
+		} else if (*p != 'd' && *p != 'i' && *p != 'u' && *p != 's' && *p != 'c' && *p != '%') {
+			return false;
+		}
+	}
+
+	for (const char *p = format; *p;) {
+		const char *text = p;
+		while (*p && *p != '%') {
+			++p;
+		}
+		if (p != text) {
+			memcpy(reserve(p - text), text, p - text);
+			cl_buffered += p - text;
+		}
+		if (!*p) {
+			break;
+		}
+		++p;
+		const bool isLong = *p == 'l';
+		if (isLong) {
+			++p;
+		}
+		char digits[24];
+		char *end = digits + sizeof(digits);
+		char *d = end;
+		switch (*p++) {
+			case 'd':
+			case 'i': {
+				const long value = isLong ? va_arg(ap, long) : va_arg(ap, int);
+				unsigned long u = value < 0 ? 0UL - value : value;
+				do {
+					*--d = '0' + u % 10;
+					u /= 10;
+				} while (u);
+				if (value < 0) {
+					*--d = '-';
+				}
+				break;
+			}
+			case 'u': {
+				unsigned long u = isLong ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int);
+				do {
+					*--d = '0' + u % 10;
+					u /= 10;
+				} while (u);
+				break;
+			}
+			case 'c':
+				*--d = va_arg(ap, int);
+				break;
+			case '%':
+				*--d = '%';
+				break;
+			case 's': {
+				const char *str = va_arg(ap, const char *);
+				if (str == NULL) {
+					str = "(null)";
+				}
+				const size_t len = strlen(str);
+				if (len >= CL_WRITE_BUFFER_SIZE) {
+					flushBuffer();
+					rawWrite(str, len);
+				} else {
+					memcpy(reserve(len), str, len);
+					cl_buffered += len;
+				}
+				continue;
+			}
+		}
+		memcpy(reserve(end - d), d, end - d);
+		cl_buffered += end - d;
+	}
+	return true;
+}
+
+/**
+**  Format into the write buffer.
+*/
+int CFile::PImpl::vprintf(const char *format, va_list ap)
+{
+	if (cl_type == CLF_TYPE_INVALID) {
+		errno = EBADF;
+		return -1;
+	}
+	const size_t start = cl_buffered;
+	va_list args;
+
+	va_copy(args, ap);
+	const bool streamed = streamPrintf(format, args);
+	va_end(args);
+	if (streamed) {
+		return cl_buffered - start;
+	}
+
+	size_t room = cl_buffer.size() - cl_buffered;
+	va_copy(args, ap);
+	int n = vsnprintf(room ? &cl_buffer[cl_buffered] : NULL, room, format, args);
+	va_end(args);
+	if (n < 0) {
+		return -1;
+	}
+	if (static_cast<size_t>(n) >= room) {
+		// Not enough room for the text and its '\0', start a new block.
+		char *buf = reserve(n + 1);
+		vsnprintf(buf, n + 1, format, ap);
+	}
+	cl_buffered += n;
+	return n;
+}
+
+int CFile::PImpl::rawWrite(const void *buf, size_t size)
 {
 	int tp = cl_type;
 	int ret = -1;
@@ -464,6 +655,10 @@ int CFile::PImpl::write(const void *buf, size_t size)
 		if (tp == CLF_TYPE_PLAIN) {
 			ret = fwrite(buf, size, 1, cl_plain);
 		}
+		if (tp == CLF_TYPE_MEMORY) {
+			cl_memory.append(static_cast<const char *>(buf), size);
+			ret = size;
+		}
 #ifdef USE_ZLIB
 		if (tp == CLF_TYPE_GZIP) {
 			ret = gzwrite(cl_gz, buf, size);
@@ -480,12 +675,20 @@ int CFile::PImpl::write(const void *buf, size_t size)
 	return ret;
 }
 
+void CFile::PImpl::takeMemory(std::string &data)
+{
+	flushBuffer();
+	data.clear();
+	data.swap(cl_memory);
+}
+
 int CFile::PImpl::seek(long offset, int whence)
 {
 	int ret = -1;
 	int tp = cl_type;
 
 	if (tp != CLF_TYPE_INVALID) {
+		flushBuffer();
 		if (tp == CLF_TYPE_PLAIN) {
 			ret = fseek(cl_plain, offset, whence);
 		}
@@ -512,9 +715,13 @@ long CFile::PImpl::tell()
 	int tp = cl_type;
 
 	if (tp != CLF_TYPE_INVALID) {
+		flushBuffer();
 		if (tp == CLF_TYPE_PLAIN) {
 			ret = ftell(cl_plain);
 		}
+		if (tp == CLF_TYPE_MEMORY) {
+			ret = cl_memory.size();
+		}
 #ifdef USE_ZLIB
 		if (tp == CLF_TYPE_GZIP) {
 			ret = gztell(cl_gz);
@@ -38,6 +38,7 @@
 #include "actions.h"
 #include "editor.h"
 #include "game.h"
+#include "iolib.h"
 #include "map.h"
 #include "missile.h"
 #include "network.h"
@@ -295,10 +296,10 @@ static void GameLogicLoop()
 			}
 		}
 		
-		if (Preference.AutosaveMinutes != 0 && !IsNetworkGame() && GameCycle > 0 && (GameCycle % (CYCLES_PER_SECOND * 60 * Preference.AutosaveMinutes)) == 0) { // autosave every X minutes (default is 5), if the option is enabled
+		if (Preference.AutosaveMinutes != 0 && !HeadlessMode && !IsNetworkGame() && GameCycle > 0 && (GameCycle % (CYCLES_PER_SECOND * 60 * Preference.AutosaveMinutes)) == 0) { // autosave every X minutes (default is 5), if the option is enabled
 		//Wyrmgus end
 			UI.StatusLine.Set(_("Autosave"));
-			SaveGame("autosave.sav");
+			SaveGameInBackground("autosave.sav");
 		}
 	}
 
@@ -306,7 +307,7 @@ static void GameLogicLoop()
 	ParticleManager.update(); // handle particles
 	CheckMusicFinished(); // Check for next song
 
-	if (FastForwardCycle <= GameCycle || !(GameCycle & 0x3f)) {
+	if (!HeadlessMode && (FastForwardCycle <= GameCycle || !(GameCycle & 0x3f))) {
 		WaitEventsOneFrame();
 	}
 
@@ -375,6 +376,158 @@ static void SingleGameLoop()
 	}
 }
 
+/**
+**  Check if the player takes part in the game.
+*/
+static bool IsHeadlessPlayer(const CPlayer &player)
+{
+	return player.Type == PlayerComputer || player.Type == PlayerPerson;
+}
+
+/**
+**  Write the stats of the current cycle to the stats file.
+**
+**  The csv file has one line per player, the json file one object
+**  per cycle.
+**
+**  @param file   The stats file.
+**  @param json   Write json instead of csv.
+**  @param first  This is the first entry of the file.
+*/
+static void WriteHeadlessStats(CFile &file, bool json, bool first)
+{
+	const unsigned long minute = GameCycle / (CYCLES_PER_SECOND * 60);
+
+	if (json) {
+		file.printf("%s{\"cycle\": %lu, \"minute\": %lu, \"synchash\": %u, \"players\": [",
+					first ? "" : ",\n", GameCycle, minute, SyncHash);
+	} else if (first) {
+		file.printf("cycle,minute,synchash,player,units,buildings");
+		for (int res = 1; res < MaxCosts; ++res) {
+			if (!DefaultResourceNames[res].empty()) {
+				file.printf(",%s", DefaultResourceNames[res].c_str());
+			}
+		}
+		file.printf("\n");
+	}
+	bool firstPlayer = true;
+	for (int i = 0; i < PlayerMax; ++i) {
+		const CPlayer &player = Players[i];
+
+		if (!IsHeadlessPlayer(player)) {
+			continue;
+		}
+		if (json) {
+			file.printf("%s{\"player\": %d, \"units\": %d, \"buildings\": %d, \"resources\": {",
+						firstPlayer ? "" : ", ", i, player.GetUnitCount(), player.NumBuildings);
+		} else {
+			file.printf("%lu,%lu,%u,%d,%d,%d", GameCycle, minute, SyncHash, i,
+						player.GetUnitCount(), player.NumBuildings);
+		}
+		bool firstResource = true;
+		for (int res = 1; res < MaxCosts; ++res) {
+			if (DefaultResourceNames[res].empty()) {
+				continue;
+			}
+			if (json) {
+				file.printf("%s\"%s\": %d", firstResource ? "" : ", ",
+							DefaultResourceNames[res].c_str(), player.Resources[res]);
+			} else {
+				file.printf(",%d", player.Resources[res]);
+			}
+			firstResource = false;
+		}
+		file.printf(json ? "}}" : "\n");
+		firstPlayer = false;
+	}
+	if (json) {
+		file.printf("]}");
+	}
+}
+
+/**
+**  Game loop without display, runs as fast as possible.
+**
+**  A replay stops when all its commands are replayed.
+*/
+static void HeadlessGameLoop()
+{
+	CFile stats;
+	bool json = false;
+	bool first = true;
+
+	if (!HeadlessStatsFile.empty()) {
+		const size_t len = HeadlessStatsFile.size();
+		json = len > 5 && !strcasecmp(HeadlessStatsFile.c_str() + len - 5, ".json");
+		if (stats.open(HeadlessStatsFile.c_str(), CL_OPEN_WRITE) == -1) {
+			fprintf(stderr, "Can't write the stats to '%s'\n", HeadlessStatsFile.c_str());
+			ExitFatal(-1);
+		}
+		if (json) {
+			stats.printf("[\n");
+		}
+	}
+	while (GameRunning) {
+		GameLogicLoop();
+		if (HeadlessMaxCycles && GameCycle >= HeadlessMaxCycles) {
+			StopGame(GameDraw);
+		}
+		if (IsReplayFinished()) {
+			StopGame(GameDraw);
+		}
+		if (!HeadlessStatsFile.empty()
+			&& (!GameRunning || GameCycle % (CYCLES_PER_SECOND * 60) == 0)) {
+			WriteHeadlessStats(stats, json, first);
+			first = false;
+		}
+	}
+	if (!HeadlessStatsFile.empty()) {
+		if (json) {
+			stats.printf("\n]\n");
+		}
+		stats.close();
+	}
+}
+
+/**
+**  Print the results of a headless game.
+**
+**  @param ticks  Real time used by the game in ms.
+*/
+static void PrintHeadlessSummary(Uint32 ticks)
+{
+	const char *result;
+
+	switch (GameResult) {
+		case GameVictory: result = "victory"; break;
+		case GameDefeat: result = "defeat"; break;
+		case GameDraw: result = "draw"; break;
+		default: result = "none"; break;
+	}
+	printf("Headless game summary\n");
+	printf("Map: %s\n", Map.Info.Filename.c_str());
+	printf("Cycles: %lu, time: %u ms, %lu cycles/s\n",
+		   GameCycle, ticks, ticks ? GameCycle * 1000 / ticks : 0);
+	printf("Result: %s\n", result);
+	for (int i = 0; i < PlayerMax; ++i) {
+		const CPlayer &player = Players[i];
+
+		if (player.Type != PlayerComputer && player.Type != PlayerPerson) {
+			continue;
+		}
+		printf("Player %d (%s): units %d, buildings %d, kills %d, razings %d, score %d",
+			   i, player.Name.c_str(), player.GetUnitCount(), player.NumBuildings,
+			   player.TotalKills, player.TotalRazings, player.Score);
+		for (int res = 1; res < MaxCosts; ++res) {
+			if (!DefaultResourceNames[res].empty()) {
+				printf(", %s %d", DefaultResourceNames[res].c_str(), player.TotalResources[res]);
+			}
+		}
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
 /**
 **  Game main loop.
 **
@@ -408,7 +561,14 @@ void GameMainLoop()
 
 	MultiPlayerReplayEachCycle();
 
-	SingleGameLoop();
+	if (HeadlessMode) {
+		const Uint32 startTicks = SDL_GetTicks();
+
+		HeadlessGameLoop();
+		PrintHeadlessSummary(SDL_GetTicks() - startTicks);
+	} else {
+		SingleGameLoop();
+	}
 
 	//
 	// Game over
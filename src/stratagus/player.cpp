@@ -328,6 +328,7 @@ std::string PlayerColorNames[PlayerMax];
 */
 int PlayerColorIndexStart;
 int PlayerColorIndexCount;
+unsigned int PlayerColorsVersion;
 
 /*----------------------------------------------------------------------------
 --  Functions
@@ -402,6 +403,7 @@ void FreePlayerColors()
 		PlayerColorsRGB[i].clear();
 		PlayerColors[i].clear();
 	}
+	++PlayerColorsVersion;
 }
 
 /**
@@ -1216,6 +1218,10 @@ void PlayersEachCycle()
 		if (p.AiEnabled) {
 			AiEachCycle(p);
 		}
+		for (int res = 0; res < MaxCosts; ++res) {
+			SyncHashMix(SyncHashPlayers, p.Resources[res] ^ (p.StoredResources[res] << 16));
+		}
+		SyncHashMix(SyncHashPlayers, (p.GetUnitCount() << 16) ^ p.NumBuildings);
 	}
 }
 
@@ -1272,6 +1278,7 @@ void SetPlayersPalette()
 	for (int i = 0; i < PlayerMax; ++i) {
 		Players[i].UnitColors.Colors = PlayerColorsRGB[i];
 	}
+	++PlayerColorsVersion;
 }
 
 /**
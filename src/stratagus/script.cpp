@@ -225,7 +225,21 @@ int LuaLoadFile(const std::string &file, const std::string &strArg)
 		// https://github.com/Wargus/stratagus/issues/196, disable for now.
 		FileChecksums = 0;
 	}
-	const int status = luaL_loadbuffer(Lua, content.c_str(), content.size(), file.c_str());
+	return LuaLoadBuffer(content, file, strArg);
+}
+
+/**
+**  Execute a lua script held in memory
+**
+**  @param content  The script
+**  @param name     Name of the script in the error messages
+**  @param strArg   Optional string argument given to the script
+**
+**  @return      0 for success, else exit.
+*/
+int LuaLoadBuffer(const std::string &content, const std::string &name, const std::string &strArg)
+{
+	const int status = luaL_loadbuffer(Lua, content.c_str(), content.size(), name.c_str());
 
 	if (!status) {
 		if (!strArg.empty()) {
@@ -406,6 +420,8 @@ void LuaGarbageCollect()
 
 // ////////////////////
 
+static NumberDesc *ParseNumberDesc(lua_State *l);
+
 /**
 **  Parse binary operation with number.
 **
@@ -420,9 +436,9 @@ static void ParseBinOp(lua_State *l, BinOp *binop)
 	Assert(lua_rawlen(l, -1) == 2);
 
 	lua_rawgeti(l, -1, 1); // left
-	binop->Left = CclParseNumberDesc(l);
+	binop->Left = ParseNumberDesc(l);
 	lua_rawgeti(l, -1, 2); // right
-	binop->Right = CclParseNumberDesc(l);
+	binop->Right = ParseNumberDesc(l);
 	lua_pop(l, 1); // table.
 }
 
@@ -590,14 +606,351 @@ static std::string CallLuaStringFunction(unsigned int handler)
 	return res;
 }
 
+/*............................................................................
+..  Compiled number description
+............................................................................*/
+
+#define NUMBER_REGISTER_MAX 32  /// Max registers of a compiled number description
+
+/// Operation of a compiled number instruction.
+enum ENumberOp {
+	NumberOp_Const,      /// Dest = Val.
+	NumberOp_BinOp,      /// Dest = Left (ENumber Val) Right.
+	NumberOp_Rand,       /// Dest = Rand(Left).
+	NumberOp_UnitStat,   /// Dest = property of unit of Node.
+	NumberOp_TypeStat,   /// Dest = property of unit type of Node.
+	NumberOp_Eval,       /// Dest = Node, with the tree interpreter.
+	NumberOp_JumpIfZero, /// Go to instruction Val if Left is 0.
+	NumberOp_Jump        /// Go to instruction Val.
+};
+
+/// Instruction of a compiled number description.
+struct NumberInstr {
+	ENumberOp Op;            /// Operation.
+	unsigned char Dest;      /// Register of the result.
+	unsigned char Left;      /// Register of the first operand.
+	unsigned char Right;     /// Register of the second operand.
+	int Val;                 /// Constant, binary operation or jump target.
+	const NumberDesc *Node;  /// Node of the stat and interpreted operations.
+};
+
+/**
+**  Number description compiled into a flat array of instructions.
+**
+**  Registers are allocated as a stack, so each node writes its result in
+**  the register of its depth and the result of the whole is in register 0.
+**  Only Lua functions and nodes using strings go back to the tree
+**  interpreter, other expressions are computed without recursion.
+*/
+struct NumberProgram {
+	std::vector<NumberInstr> Code;  /// Instructions, in order.
+};
+
+NumberDesc::NumberDesc() : e(ENumber_Dir), Program(NULL)
+{
+	memset(&D, 0, sizeof(D));
+}
+
 /**
-**  Return number.
+**  Compute a binary operation.
+**
+**  @param e  which operation.
+**  @param a  left operand.
+**  @param b  right operand.
+**
+**  @return   the result number.
+*/
+static int EvalBinOp(ENumber e, int a, int b)
+{
+	switch (e) {
+		case ENumber_Add :     // a + b.
+			return a + b;
+		case ENumber_Sub :     // a - b.
+			return a - b;
+		case ENumber_Mul :     // a * b.
+			return a * b;
+		case ENumber_Div :     // a / b.
+			if (!b) { // FIXME : manage better this.
+				return 0;
+			}
+			return a / b;
+		case ENumber_Min :     // a <= b ? a : b
+			return std::min(a, b);
+		case ENumber_Max :     // a >= b ? a : b
+			return std::max(a, b);
+		case ENumber_Gt  :     // a > b  ? 1 : 0
+			return (a > b ? 1 : 0);
+		case ENumber_GtEq :    // a >= b ? 1 : 0
+			return (a >= b ? 1 : 0);
+		case ENumber_Lt  :     // a < b  ? 1 : 0
+			return (a < b ? 1 : 0);
+		case ENumber_LtEq :    // a <= b ? 1 : 0
+			return (a <= b ? 1 : 0);
+		case ENumber_Eq  :     // a == b ? 1 : 0
+			return (a == b ? 1 : 0);
+		case ENumber_NEq  :    // a != b ? 1 : 0
+			return (a != b ? 1 : 0);
+		default:
+			Assert(0);
+			return 0;
+	}
+}
+
+/// Is the number a binary operation.
+static bool IsBinOp(ENumber e)
+{
+	return ENumber_Add <= e && e <= ENumber_NEq && e != ENumber_Rand;
+}
+
+/**
+**  Compute the property of the unit of number, 0 without unit.
+*/
+static int EvalUnitStat(const NumberDesc &number)
+{
+	const CUnit *unit = EvalUnit(number.D.UnitStat.Unit);
+
+	if (unit == NULL) { // ERROR.
+		return 0;
+	}
+	return GetComponent(*unit, number.D.UnitStat.Index,
+						number.D.UnitStat.Component, number.D.UnitStat.Loc).i;
+}
+
+/**
+**  Compute the property of the unit type of number, 0 without type.
+*/
+static int EvalTypeStat(const NumberDesc &number)
+{
+	const CUnitType *const *type = number.D.TypeStat.Type;
+
+	if (type == NULL) { // ERROR.
+		return 0;
+	}
+	return GetComponent(**type, number.D.TypeStat.Index,
+						number.D.TypeStat.Component, number.D.TypeStat.Loc).i;
+}
+
+/**
+**  Replace the constant parts of the number by their value.
+**
+**  Random numbers, Lua functions and stats are never constant.
+**
+**  @param number  number to fold, not compiled yet.
+*/
+static void FoldNumberDesc(NumberDesc &number)
+{
+	Assert(number.Program == NULL);
+
+	if (IsBinOp(number.e)) {
+		FoldNumberDesc(*number.D.binOp.Left);
+		FoldNumberDesc(*number.D.binOp.Right);
+		if (number.D.binOp.Left->e != ENumber_Dir || number.D.binOp.Right->e != ENumber_Dir) {
+			return;
+		}
+		const int val = EvalBinOp(number.e, number.D.binOp.Left->D.Val, number.D.binOp.Right->D.Val);
+
+		FreeNumberDesc(&number);
+		number.e = ENumber_Dir;
+		number.D.Val = val;
+	} else if (number.e == ENumber_Rand) {
+		FoldNumberDesc(*number.D.N);
+	} else if (number.e == ENumber_NumIf) {
+		FoldNumberDesc(*number.D.NumIf.Cond);
+		FoldNumberDesc(*number.D.NumIf.BTrue);
+		if (number.D.NumIf.BFalse) {
+			FoldNumberDesc(*number.D.NumIf.BFalse);
+		}
+		if (number.D.NumIf.Cond->e != ENumber_Dir) {
+			return;
+		}
+		// Keep the branch taken in place of the condition.
+		NumberDesc *branch;
+		if (number.D.NumIf.Cond->D.Val) {
+			branch = number.D.NumIf.BTrue;
+			number.D.NumIf.BTrue = NULL;
+		} else {
+			branch = number.D.NumIf.BFalse;
+			number.D.NumIf.BFalse = NULL;
+		}
+		FreeNumberDesc(&number);
+		if (branch) {
+			number = *branch;
+			delete branch;
+		} else {
+			number.e = ENumber_Dir;
+			number.D.Val = 0;
+		}
+	}
+}
+
+/**
+**  Append the instructions computing number into register reg.
+**
+**  @param number  number to compile.
+**  @param reg     register of the result.
+**  @param code    instructions to append to.
+**
+**  @return        false if the number needs too many registers.
+*/
+static bool CompileNumberNode(const NumberDesc &number, int reg, std::vector<NumberInstr> &code)
+{
+	if (reg >= NUMBER_REGISTER_MAX) {
+		return false;
+	}
+	NumberInstr instr;
+
+	instr.Dest = reg;
+	instr.Left = reg;
+	instr.Right = reg;
+	instr.Val = 0;
+	instr.Node = &number;
+	if (IsBinOp(number.e)) {
+		if (!CompileNumberNode(*number.D.binOp.Left, reg, code)
+			|| !CompileNumberNode(*number.D.binOp.Right, reg + 1, code)) {
+			return false;
+		}
+		instr.Op = NumberOp_BinOp;
+		instr.Right = reg + 1;
+		instr.Val = number.e;
+		code.push_back(instr);
+		return true;
+	}
+	switch (number.e) {
+		case ENumber_Dir :
+			instr.Op = NumberOp_Const;
+			instr.Val = number.D.Val;
+			break;
+		case ENumber_Rand :
+			if (!CompileNumberNode(*number.D.N, reg, code)) {
+				return false;
+			}
+			instr.Op = NumberOp_Rand;
+			break;
+		case ENumber_UnitStat :
+			instr.Op = NumberOp_UnitStat;
+			break;
+		case ENumber_TypeStat :
+			instr.Op = NumberOp_TypeStat;
+			break;
+		case ENumber_NumIf : {
+			if (!CompileNumberNode(*number.D.NumIf.Cond, reg, code)) {
+				return false;
+			}
+			const size_t jumpElse = code.size();
+			instr.Op = NumberOp_JumpIfZero;
+			code.push_back(instr);
+			if (!CompileNumberNode(*number.D.NumIf.BTrue, reg, code)) {
+				return false;
+			}
+			const size_t jumpEnd = code.size();
+			instr.Op = NumberOp_Jump;
+			code.push_back(instr);
+			code[jumpElse].Val = code.size();
+			if (number.D.NumIf.BFalse) {
+				if (!CompileNumberNode(*number.D.NumIf.BFalse, reg, code)) {
+					return false;
+				}
+			} else {
+				instr.Op = NumberOp_Const;
+				code.push_back(instr);
+			}
+			code[jumpEnd].Val = code.size();
+			return true;
+		}
+		default: // Lua function and strings.
+			instr.Op = NumberOp_Eval;
+			break;
+	}
+	code.push_back(instr);
+	return true;
+}
+
+/**
+**  Compile number, which keeps its tree for the nodes the compiled
+**  form gives back to the interpreter.
+**
+**  @param number  number to compile.
+*/
+static void CompileNumberDesc(NumberDesc &number)
+{
+	delete number.Program;
+	number.Program = NULL;
+	switch (number.e) {
+		case ENumber_Dir :
+		case ENumber_Lua :
+		case ENumber_VideoTextLength :
+		case ENumber_StringFind :
+		case ENumber_PlayerData :
+			return; // Nothing to gain, the interpreter does it.
+		default:
+			break;
+	}
+	NumberProgram *program = new NumberProgram;
+
+	if (!CompileNumberNode(number, 0, program->Code)) {
+		DebugPrint("Number description too deep to be compiled\n");
+		delete program;
+		return;
+	}
+	number.Program = program;
+}
+
+/**
+**  Compute a compiled number.
+**
+**  @param program  compiled number.
+**
+**  @return         the result number.
+*/
+static int RunNumberProgram(const NumberProgram &program)
+{
+	int reg[NUMBER_REGISTER_MAX];
+	const NumberInstr *code = &program.Code[0];
+	const int size = program.Code.size();
+
+	for (int i = 0; i < size; ++i) {
+		const NumberInstr &instr = code[i];
+
+		switch (instr.Op) {
+			case NumberOp_Const :
+				reg[instr.Dest] = instr.Val;
+				break;
+			case NumberOp_BinOp :
+				reg[instr.Dest] = EvalBinOp((ENumber)instr.Val, reg[instr.Left], reg[instr.Right]);
+				break;
+			case NumberOp_Rand :
+				reg[instr.Dest] = SyncRand() % reg[instr.Left];
+				break;
+			case NumberOp_UnitStat :
+				reg[instr.Dest] = EvalUnitStat(*instr.Node);
+				break;
+			case NumberOp_TypeStat :
+				reg[instr.Dest] = EvalTypeStat(*instr.Node);
+				break;
+			case NumberOp_Eval :
+				reg[instr.Dest] = EvalNumber(instr.Node);
+				break;
+			case NumberOp_JumpIfZero :
+				if (!reg[instr.Left]) {
+					i = instr.Val - 1;
+				}
+				break;
+			case NumberOp_Jump :
+				i = instr.Val - 1;
+				break;
+		}
+	}
+	return reg[0];
+}
+
+/**
+**  Return number, not compiled.
 **
 **  @param l  lua state.
 **
 **  @return   number.
 */
-NumberDesc *CclParseNumberDesc(lua_State *l)
+static NumberDesc *ParseNumberDesc(lua_State *l)
 {
 	NumberDesc *res = new NumberDesc;
 
@@ -636,7 +989,7 @@ NumberDesc *CclParseNumberDesc(lua_State *l)
 			ParseBinOp(l, &res->D.binOp);
 		} else if (!strcmp(key, "Rand")) {
 			res->e = ENumber_Rand;
-			res->D.N = CclParseNumberDesc(l);
+			res->D.N = ParseNumberDesc(l);
 		} else if (!strcmp(key, "GreaterThan")) {
 			res->e = ENumber_Gt;
 			ParseBinOp(l, &res->D.binOp);
@@ -748,12 +1101,12 @@ NumberDesc *CclParseNumberDesc(lua_State *l)
 				LuaError(l, "Bad number of args in NumIf\n");
 			}
 			lua_rawgeti(l, -1, 1); // Condition.
-			res->D.NumIf.Cond = CclParseNumberDesc(l);
+			res->D.NumIf.Cond = ParseNumberDesc(l);
 			lua_rawgeti(l, -1, 2); // Then.
-			res->D.NumIf.BTrue = CclParseNumberDesc(l);
+			res->D.NumIf.BTrue = ParseNumberDesc(l);
 			if (lua_rawlen(l, -1) == 3) {
 				lua_rawgeti(l, -1, 3); // Else.
-				res->D.NumIf.BFalse = CclParseNumberDesc(l);
+				res->D.NumIf.BFalse = ParseNumberDesc(l);
 			}
 			lua_pop(l, 1); // table.
 		} else if (!strcmp(key, "PlayerData")) {
@@ -762,7 +1115,7 @@ NumberDesc *CclParseNumberDesc(lua_State *l)
 				LuaError(l, "Bad number of args in PlayerData\n");
 			}
 			lua_rawgeti(l, -1, 1); // Player.
-			res->D.PlayerData.Player = CclParseNumberDesc(l);
+			res->D.PlayerData.Player = ParseNumberDesc(l);
 			lua_rawgeti(l, -1, 2); // DataType.
 			res->D.PlayerData.DataType = CclParseStringDesc(l);
 			if (lua_rawlen(l, -1) == 3) {
@@ -781,6 +1134,22 @@ NumberDesc *CclParseNumberDesc(lua_State *l)
 	return res;
 }
 
+/**
+**  Return number, with its constants folded and compiled.
+**
+**  @param l  lua state.
+**
+**  @return   number.
+*/
+NumberDesc *CclParseNumberDesc(lua_State *l)
+{
+	NumberDesc *res = ParseNumberDesc(l);
+
+	FoldNumberDesc(*res);
+	CompileNumberDesc(*res);
+	return res;
+}
+
 /**
 **  Return String description.
 **
@@ -925,87 +1294,48 @@ CUnit *EvalUnit(const UnitDesc *unitdesc)
 **
 **  @return        the result number.
 **
+**  @note Compiled numbers run their instructions instead of the tree.
+**
 **  @todo Manage better the error (div/0, unit==NULL, ...).
 */
 int EvalNumber(const NumberDesc *number)
 {
-	CUnit *unit;
-	CUnitType **type;
 	std::string s;
 	int a;
 	int b;
 
 	Assert(number);
+	if (number->Program) {
+		return RunNumberProgram(*number->Program);
+	}
 	switch (number->e) {
 		case ENumber_Lua :     // a lua function.
 			return CallLuaNumberFunction(number->D.Index);
 		case ENumber_Dir :     // directly a number.
 			return number->D.Val;
 		case ENumber_Add :     // a + b.
-			return EvalNumber(number->D.binOp.Left) + EvalNumber(number->D.binOp.Right);
 		case ENumber_Sub :     // a - b.
-			return EvalNumber(number->D.binOp.Left) - EvalNumber(number->D.binOp.Right);
 		case ENumber_Mul :     // a * b.
-			return EvalNumber(number->D.binOp.Left) * EvalNumber(number->D.binOp.Right);
 		case ENumber_Div :     // a / b.
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
-			if (!b) { // FIXME : manage better this.
-				return 0;
-			}
-			return a / b;
 		case ENumber_Min :     // a <= b ? a : b
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
-			return std::min(a, b);
 		case ENumber_Max :     // a >= b ? a : b
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
-			return std::max(a, b);
 		case ENumber_Gt  :     // a > b  ? 1 : 0
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
-			return (a > b ? 1 : 0);
 		case ENumber_GtEq :    // a >= b ? 1 : 0
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
-			return (a >= b ? 1 : 0);
 		case ENumber_Lt  :     // a < b  ? 1 : 0
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
-			return (a < b ? 1 : 0);
 		case ENumber_LtEq :    // a <= b ? 1 : 0
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
-			return (a <= b ? 1 : 0);
 		case ENumber_Eq  :     // a == b ? 1 : 0
-			a = EvalNumber(number->D.binOp.Left);
-			b = EvalNumber(number->D.binOp.Right);
-			return (a == b ? 1 : 0);
 		case ENumber_NEq  :    // a != b ? 1 : 0
 			a = EvalNumber(number->D.binOp.Left);
 			b = EvalNumber(number->D.binOp.Right);
-			return (a != b ? 1 : 0);
+			return EvalBinOp(number->e, a, b);
 
 		case ENumber_Rand :    // random(a) [0..a-1]
 			a = EvalNumber(number->D.N);
 			return SyncRand() % a;
 		case ENumber_UnitStat : // property of unit.
-			unit = EvalUnit(number->D.UnitStat.Unit);
-			if (unit != NULL) {
-				return GetComponent(*unit, number->D.UnitStat.Index,
-									number->D.UnitStat.Component, number->D.UnitStat.Loc).i;
-			} else { // ERROR.
-				return 0;
-			}
+			return EvalUnitStat(*number);
 		case ENumber_TypeStat : // property of unit type.
-			type = number->D.TypeStat.Type;
-			if (type != NULL) {
-				return GetComponent(**type, number->D.TypeStat.Index,
-									number->D.TypeStat.Component, number->D.TypeStat.Loc).i;
-			} else { // ERROR.
-				return 0;
-			}
+			return EvalTypeStat(*number);
 		case ENumber_VideoTextLength : // VideoTextLength(font, s)
 			if (number->D.VideoTextLength.String != NULL
 				&& !(s = EvalString(number->D.VideoTextLength.String)).empty()) {
@@ -1166,6 +1496,8 @@ void FreeNumberDesc(NumberDesc *number)
 	if (number == 0) {
 		return;
 	}
+	delete number->Program;
+	number->Program = NULL;
 	switch (number->e) {
 		case ENumber_Lua :     // a lua function.
 		// FIXME: when lua table should be freed ?
@@ -189,6 +189,7 @@ extern void beos_init(int argc, char **argv);
 #include "map.h"
 #include "netconnect.h"
 #include "network.h"
+#include "network/netrelay.h"
 #include "parameters.h"
 #include "player.h"
 #include "replay.h"
@@ -231,6 +232,8 @@ extern void beos_init(int argc, char **argv);
 #include "SetupConsole_win32.h"
 #endif
 
+extern void StartMap(const std::string &filename, bool clean);
+
 /*----------------------------------------------------------------------------
 --  Variables
 ----------------------------------------------------------------------------*/
@@ -247,6 +250,15 @@ bool EnableDebugPrint;           /// if enabled, print the debug messages
 bool EnableAssert;               /// if enabled, halt on assertion failures
 bool EnableUnitDebug;            /// if enabled, a unit info dump will be created
 
+bool HeadlessMode;               /// if enabled, simulate the map without video, sound and input
+unsigned long HeadlessMaxCycles; /// stop the headless game after this cycle (0 = never)
+std::string HeadlessReplay;      /// replay to run in headless mode instead of a map
+std::string HeadlessStatsFile;   /// file of the per minute stats of a headless game
+
+static int RelayPort;                /// run an observer relay on this port instead of the game
+static unsigned int RelayDelay;      /// seconds the observers of the relay are behind the game
+static std::string RelaySource;      /// server allowed to send the game to the relay
+
 /*============================================================================
 ==  MAIN
 ============================================================================*/
@@ -305,6 +317,27 @@ static int MenuLoop()
 	return status;
 }
 
+/**
+**  Play the command line map or replay without menus, video or input.
+**
+**  Every person slot of a map is played by the computer.
+*/
+static void HeadlessLoop()
+{
+	initGuichan();
+	InterfaceState = IfaceStateMenu;
+	CursorState = CursorStatePoint;
+	GameCursor = UI.Point.Cursor;
+
+	if (!HeadlessReplay.empty()) {
+		CleanPlayers();
+		LoadReplay(HeadlessReplay);
+		StartMap(CurrentMapPath, false);
+	} else {
+		StartMap(CliMapName, true);
+	}
+}
+
 //----------------------------------------------------------------------------
 
 /**
@@ -384,6 +417,7 @@ void Exit(int err)
 		return;
 	}
 
+	WaitForSaveGame();
 	StopMusic();
 	QuitSound();
 	NetworkQuitGame();
@@ -434,6 +468,7 @@ static void Usage()
 	printf(
 		"\n\nUsage: %s [OPTIONS] [map.smp|map.smp.gz]\n"
 		"\t-a\t\tEnables asserts check in engine code (for debugging)\n"
+		"\t-B port[:delay]@server[:port]\n\t\t\tRun an observer relay for the game of server, observers are delay seconds behind\n"
 		"\t-c file.lua\tConfiguration start file (default stratagus.lua)\n"
 		"\t-d datapath\tPath to stratagus data (default current directory)\n"
 		"\t-D depth\tVideo mode depth = pixel per point\n"
@@ -442,14 +477,17 @@ static void Usage()
 		"\t-F\t\tFull screen video mode\n"
 		"\t-G \"options\"\tGame options (passed to game scripts)\n"
 		"\t-h\t\tHelp shows this page\n"
+		"\t-H cycles\tHeadless simulation of the map, stop after cycles (0 = at game end)\n"
 		"\t-i\t\tEnables unit info dumping into log (for debugging)\n"
 		"\t-I addr\t\tNetwork address to use\n"
 		"\t-l\t\tDisable command log\n"
 		"\t-N name\t\tName of the player\n"
 		"\t-p\t\tEnables debug messages printing in console\n"
 		"\t-P port\t\tNetwork port to use\n"
+		"\t-R replay\tHeadless run of the replay as fast as possible\n"
 		"\t-s sleep\tNumber of frames for the AI to sleep before it starts\n"
 		"\t-S speed\tSync speed (100 = 30 frames/s)\n"
+		"\t-T file\t\tWrite per minute stats of a headless game (.csv or .json)\n"
 		"\t-u userpath\tPath where stratagus saves preferences, log and savegame\n"
 		"\t-v mode\t\tVideo mode resolution in format <xres>x<yres>\n"
 		"\t-W\t\tWindowed video mode. Optionally takes a window size in <xres>x<yres>\n"
@@ -499,10 +537,25 @@ void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 {
 	char *sep;
 	for (;;) {
-		switch (getopt(argc, argv, "ac:d:D:eE:FG:hiI:lN:oOP:ps:S:u:v:W?-")) {
+		switch (getopt(argc, argv, "aB:c:d:D:eE:FG:hH:iI:lN:oOP:pR:s:S:T:u:v:W?-")) {
 			case 'a':
 				EnableAssert = true;
 				continue;
+			case 'B':
+				RelayPort = strtol(optarg, &sep, 10);
+				if (*sep == ':') {
+					RelayDelay = strtoul(sep + 1, &sep, 10);
+				}
+				if (*sep != '@' || sep[1] == '\0') {
+					fprintf(stderr, "%s: -B needs the server which sends the game -- '%s'\n", argv[0], optarg);
+					Usage();
+					exit(-1);
+				}
+				RelaySource = sep + 1;
+				if (RelayPort <= 0) {
+					RelayPort = CNetworkParameter::defaultRelayPort;
+				}
+				continue;
 			case 'c':
 				parameters.luaStartFilename = optarg;
 				if (strlen(optarg) > 4 &&
@@ -534,6 +587,14 @@ void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 			case 'G':
 				parameters.luaScriptArguments = optarg;
 				continue;
+			case 'H':
+				HeadlessMode = true;
+				HeadlessMaxCycles = strtoul(optarg, NULL, 10);
+				continue;
+			case 'R':
+				HeadlessMode = true;
+				HeadlessReplay = optarg;
+				continue;
 			case 'i':
 				EnableUnitDebug = true;
 				continue;
@@ -555,6 +616,9 @@ void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 			case 's':
 				AiSleepCycles = atoi(optarg);
 				continue;
+			case 'T':
+				HeadlessStatsFile = optarg;
+				continue;
 			case 'S':
 				VideoSyncSpeed = atoi(optarg);
 				continue;
@@ -625,6 +689,12 @@ void ParseCommandLine(int argc, char **argv, Parameters &parameters)
 			CliMapName[index] = '/';
 		}
 	}
+
+	if (HeadlessMode && CliMapName.empty() && HeadlessReplay.empty()) {
+		fprintf(stderr, "headless mode needs a map file\n");
+		Usage();
+		ExitFatal(-1);
+	}
 }
 
 #ifdef USE_WIN32
@@ -693,6 +763,9 @@ int stratagusMain(int argc, char **argv)
 
 		// FIXME: Parse options before or after scripts?
 		ParseCommandLine(argc, argv, parameters);
+		if (RelayPort) {
+			return RunNetworkRelay(RelayPort, RelayDelay * CYCLES_PER_SECOND, RelaySource);
+		}
 		// Init the random number generator.
 		InitSyncRand();
 
@@ -707,7 +780,7 @@ int stratagusMain(int argc, char **argv)
 
 		// Setup sound card, must be done before loading sounds, so that
 		// SDL_mixer can auto-convert to the target format
-		if (!InitSound()) {
+		if (!HeadlessMode && !InitSound()) {
 			InitMusic();
 		}
 
@@ -739,7 +812,11 @@ int stratagusMain(int argc, char **argv)
 		UnitManager.Init(); // Units memory management
 		PreMenuSetup();     // Load everything needed for menus
 
-		MenuLoop();
+		if (HeadlessMode) {
+			HeadlessLoop();
+		} else {
+			MenuLoop();
+		}
 
 		Exit(0);
 	} catch (const std::exception &e) {
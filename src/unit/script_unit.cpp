@@ -199,6 +199,9 @@ void PathFinderInput::Load(lua_State *l)
 		} else if (!strcmp(tag, "invalid")) {
 			this->isRecalculatePathNeeded = true;
 			--i;
+		} else if (!strcmp(tag, "deferred")) {
+			this->isPathRequestDeferred = true;
+			this->deferredCycle = LuaToNumber(l, -1, i);
 		} else {
 			LuaError(l, "PathFinderInput::Load: Unsupported tag: %s" _C_ tag);
 		}
@@ -551,7 +554,7 @@ static int CclUnit(lua_State *l)
 			const char *s = LuaToString(l, 2, j + 1);
 			Assert(SpellTypeByIdent(s));
 			if (!unit->AutoCastSpell) {
-				unit->AutoCastSpell = new char[SpellTypeTable.size()];
+				unit->AutoCastSpell = unit->UnitManagerData.GetAutoCastSpell();
 				memset(unit->AutoCastSpell, 0, SpellTypeTable.size());
 			}
 			unit->AutoCastSpell[SpellTypeByIdent(s)->Slot] = 1;
@@ -561,7 +564,7 @@ static int CclUnit(lua_State *l)
 				LuaError(l, "incorrect argument");
 			}
 			if (!unit->SpellCoolDownTimers) {
-				unit->SpellCoolDownTimers = new int[SpellTypeTable.size()];
+				unit->SpellCoolDownTimers = unit->UnitManagerData.GetSpellCoolDownTimers();
 				memset(unit->SpellCoolDownTimers, 0, SpellTypeTable.size() * sizeof(int));
 			}
 			for (size_t k = 0; k < SpellTypeTable.size(); ++k) {
@@ -600,6 +603,8 @@ static int CclUnit(lua_State *l)
 	if (unit->RescuedFrom) {
 		unit->Colors = &unit->RescuedFrom->UnitColors;
 	}
+	// The type and the destroyed flag were read after the unit was added.
+	UnitManager.UpdateSlot(*unit);
 
 	return 0;
 }
@@ -1120,7 +1125,7 @@ static int CclGetUnitVariable(lua_State *l)
 		LuaCheckArgs(l, 3);
 		std::string upgrade_ident = LuaToString(l, 3);
 		if (CUpgrade::Get(upgrade_ident)) {
-			lua_pushboolean(l, unit->IndividualUpgrades[CUpgrade::Get(upgrade_ident)->ID]);
+			lua_pushboolean(l, unit->IndividualUpgrades.Test(CUpgrade::Get(upgrade_ident)->ID));
 		} else {
 			LuaError(l, "Individual upgrade \"%s\" doesn't exist." _C_ upgrade_ident.c_str());
 		}
@@ -1185,14 +1190,15 @@ static int CclSetUnitVariable(lua_State *l)
 	} else if (!strcmp(name, "RegenerationRate")) {
 		value = LuaToNumber(l, 3);
 		unit->Variable[HP_INDEX].Increase = std::min(unit->Variable[HP_INDEX].Max, value);
+		unit->RegenActive = 1;
 	} else if (!strcmp(name, "IndividualUpgrade")) {
 		LuaCheckArgs(l, 4);
 		std::string upgrade_ident = LuaToString(l, 3);
 		bool has_upgrade = LuaToBoolean(l, 4);
 		if (CUpgrade::Get(upgrade_ident)) {
-			if (has_upgrade && unit->IndividualUpgrades[CUpgrade::Get(upgrade_ident)->ID] == false) {
+			if (has_upgrade && !unit->IndividualUpgrades.Test(CUpgrade::Get(upgrade_ident)->ID)) {
 				IndividualUpgradeAcquire(*unit, CUpgrade::Get(upgrade_ident));
-			} else if (!has_upgrade && unit->IndividualUpgrades[CUpgrade::Get(upgrade_ident)->ID]) {
+			} else if (!has_upgrade && unit->IndividualUpgrades.Test(CUpgrade::Get(upgrade_ident)->ID)) {
 				IndividualUpgradeLost(*unit, CUpgrade::Get(upgrade_ident));
 			}
 		} else {
@@ -1250,6 +1256,7 @@ static int CclSetUnitVariable(lua_State *l)
 				LuaError(l, "Bad variable type '%s'\n" _C_ type);
 			}
 		}
+		unit->ActivateBuffs();
 	}
 	lua_pushnumber(l, value);
 	return 1;
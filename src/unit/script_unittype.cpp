@@ -1631,6 +1631,9 @@ static int CclDefineVariables(lua_State *l)
 	for (int j = 0; j < args; ++j) {
 		const char *str = LuaToString(l, j + 1);
 
+		if (UnitManager.IsGameDataSized() && UnitTypeVar.VariableNameLookup[str] == -1) {
+			LuaError(l, "Can't define the variable \"%s\" once units are made" _C_ str);
+		}
 		const int index = UnitTypeVar.VariableNameLookup.AddKey(str);
 		if (index == old) {
 			old++;
@@ -462,6 +462,8 @@ void CUnit::Init()
 	Summoned = 0;
 	Waiting = 0;
 	MineLow = 0;
+	BuffsActive = 0;
+	RegenActive = 0;
 	memset(&Anim, 0, sizeof(Anim));
 	memset(&WaitBackup, 0, sizeof(WaitBackup));
 	CurrentResource = 0;
@@ -476,7 +478,7 @@ void CUnit::Init()
 	SpellCoolDownTimers = NULL;
 	AutoRepair = 0;
 	Goal = NULL;
-	memset(IndividualUpgrades, 0, sizeof(IndividualUpgrades));
+	IndividualUpgrades.Clear();
 }
 
 
@@ -501,6 +503,7 @@ void CUnit::Release(bool final)
 
 		// Are more references remaining?
 		Destroyed = 1; // mark as destroyed
+		UnitManager.UpdateSlot(*this);
 
 		if (Container && !final) {
 			if (Boarded) {
@@ -530,9 +533,8 @@ void CUnit::Release(bool final)
 	Type = NULL;
 
 	delete pathFinderData;
-	delete[] AutoCastSpell;
-	delete[] SpellCoolDownTimers;
-	delete[] Variable;
+	pathFinderData = NULL;
+	// Variable, AutoCastSpell and SpellCoolDownTimers belong to the unit manager.
 	for (std::vector<COrder *>::iterator order = Orders.begin(); order != Orders.end(); ++order) {
 		delete *order;
 	}
@@ -584,12 +586,12 @@ void CUnit::Init(const CUnitType &type)
 	//  Set refs to 1. This is the "I am alive ref", lost in ReleaseUnit.
 	Refs = 1;
 
-	//  Build all unit table
-	UnitManager.Add(this);
-
 	//  Initialise unit structure (must be zero filled!)
 	Type = &type;
 
+	//  Build all unit table
+	UnitManager.Add(this);
+
 	Seen.Frame = UnitNotSeen; // Unit isn't yet seen
 
 	Frame = type.StillFrame;
@@ -597,13 +599,14 @@ void CUnit::Init(const CUnitType &type)
 	if (UnitTypeVar.GetNumberVariable()) {
 		Assert(!Variable);
 		const unsigned int size = UnitTypeVar.GetNumberVariable();
-		Variable = new CVariable[size];
+		Variable = UnitManagerData.GetVariables();
 		std::copy(type.MapDefaultStat.Variables, type.MapDefaultStat.Variables + size, Variable);
 	} else {
 		Variable = NULL;
 	}
 
-	memset(IndividualUpgrades, 0, sizeof(IndividualUpgrades));
+	IndividualUpgrades.Clear();
+	ActivateBuffs();
 
 	// Set a heading for the unit if it Handles Directions
 	// Don't set a building heading, as only 1 construction direction
@@ -615,8 +618,8 @@ void CUnit::Init(const CUnitType &type)
 
 	// Create AutoCastSpell and SpellCoolDownTimers arrays for casters
 	if (type.CanCastSpell) {
-		AutoCastSpell = new char[SpellTypeTable.size()];
-		SpellCoolDownTimers = new int[SpellTypeTable.size()];
+		AutoCastSpell = UnitManagerData.GetAutoCastSpell();
+		SpellCoolDownTimers = UnitManagerData.GetSpellCoolDownTimers();
 		memset(SpellCoolDownTimers, 0, SpellTypeTable.size() * sizeof(int));
 		if (Type->AutoCastActive) {
 			memcpy(AutoCastSpell, Type->AutoCastActive, SpellTypeTable.size());
@@ -786,7 +789,7 @@ CUnit *MakeUnit(const CUnitType &type, CPlayer *player)
 **  @param f2        Function to (un)mark for cloaking vision.
 */
 static void MapMarkUnitSightRec(const CUnit &unit, const Vec2i &pos, int width, int height,
-								MapMarkerFunc *f, MapMarkerFunc *f2)
+								MapSpanMarkerFunc *f, MapSpanMarkerFunc *f2)
 {
 	Assert(f);
 	MapSight(*unit.Player, pos, width, height,
@@ -803,6 +806,34 @@ static void MapMarkUnitSightRec(const CUnit &unit, const Vec2i &pos, int width,
 	}
 }
 
+/**
+**  Move on vision table the Sight of the unit
+**  (and units inside for transporter (recursively))
+**
+**  @param unit    Unit to move the sight of.
+**  @param oldPos  old coord of first container of unit.
+**  @param newPos  new coord of first container of unit.
+**  @param width   Width of the first container of unit.
+**  @param height  Height of the first container of unit.
+*/
+static void MapMoveUnitSightRec(const CUnit &unit, const Vec2i &oldPos, const Vec2i &newPos,
+								int width, int height)
+{
+	const int range = unit.Container ? unit.Container->CurrentSightRange : unit.CurrentSightRange;
+
+	MapSightMove(*unit.Player, oldPos, newPos, width, height, range,
+				 MapMarkSpanSight, MapUnmarkSpanSight);
+	if (unit.Type && unit.Type->BoolFlag[DETECTCLOAK_INDEX].value) {
+		MapSightMove(*unit.Player, oldPos, newPos, width, height, range,
+					 MapMarkSpanDetectCloak, MapUnmarkSpanDetectCloak);
+	}
+
+	CUnit *unit_inside = unit.UnitInside;
+	for (int i = unit.InsideCount; i--; unit_inside = unit_inside->NextContained) {
+		MapMoveUnitSightRec(*unit_inside, oldPos, newPos, width, height);
+	}
+}
+
 /**
 **  Return the unit not transported, by viewing the container recursively.
 **
@@ -833,7 +864,7 @@ void MapMarkUnitSight(CUnit &unit)
 	Assert(container->Type);
 
 	MapMarkUnitSightRec(unit, container->tilePos, container->Type->TileWidth, container->Type->TileHeight,
-						MapMarkTileSight, MapMarkTileDetectCloak);
+						MapMarkSpanSight, MapMarkSpanDetectCloak);
 
 	// Never mark radar, except if the top unit, and unit is usable
 	if (&unit == container && !unit.IsUnusable()) {
@@ -863,7 +894,7 @@ void MapUnmarkUnitSight(CUnit &unit)
 	Assert(container->Type);
 	MapMarkUnitSightRec(unit,
 						container->tilePos, container->Type->TileWidth, container->Type->TileHeight,
-						MapUnmarkTileSight, MapUnmarkTileDetectCloak);
+						MapUnmarkSpanSight, MapUnmarkSpanDetectCloak);
 
 	// Never mark radar, except if the top unit?
 	if (&unit == container && !unit.IsUnusable()) {
@@ -878,6 +909,37 @@ void MapUnmarkUnitSight(CUnit &unit)
 	}
 }
 
+/**
+**  Update on vision table the Sight of a unit which was moved,
+**  (and units inside for transporter)
+**
+**  Only the tiles entering or leaving the sight are updated.
+**
+**  @param unit    unit moved, not inside a container.
+**  @param oldPos  where the unit was.
+**  @see MapMarkUnitSight.
+*/
+void MapMoveUnitSight(CUnit &unit, const Vec2i &oldPos)
+{
+	Assert(unit.Type);
+	Assert(!unit.Container);
+
+	const int width = unit.Type->TileWidth;
+	const int height = unit.Type->TileHeight;
+	MapMoveUnitSightRec(unit, oldPos, unit.tilePos, width, height);
+
+	if (!unit.IsUnusable()) {
+		if (unit.Stats->Variables[RADAR_INDEX].Value) {
+			MapSightMove(*unit.Player, oldPos, unit.tilePos, width, height,
+						 unit.Stats->Variables[RADAR_INDEX].Value, MapMarkTileRadar, MapUnmarkTileRadar);
+		}
+		if (unit.Stats->Variables[RADARJAMMER_INDEX].Value) {
+			MapSightMove(*unit.Player, oldPos, unit.tilePos, width, height,
+						 unit.Stats->Variables[RADARJAMMER_INDEX].Value, MapMarkTileRadarJammer, MapUnmarkTileRadarJammer);
+		}
+	}
+}
+
 /**
 **  Update the Unit Current sight range to good value and transported units inside.
 **
@@ -938,6 +1000,9 @@ void MarkUnitFieldFlags(const CUnit &unit)
 		} while (--w);
 		index += Map.Info.MapWidth;
 	} while (--h);
+	if (unit.Type->Building) {
+		PathfinderTerrainChanged(unit.tilePos, width, unit.Type->TileHeight);
+	}
 }
 
 class _UnmarkUnitFieldFlags
@@ -986,6 +1051,9 @@ void UnmarkUnitFieldFlags(const CUnit &unit)
 		} while (--w);
 		index += Map.Info.MapWidth;
 	} while (--h);
+	if (unit.Type->Building) {
+		PathfinderTerrainChanged(unit.tilePos, width, unit.Type->TileHeight);
+	}
 }
 
 /**
@@ -1065,7 +1133,8 @@ static void UnitInXY(CUnit &unit, const Vec2i &pos)
 */
 void CUnit::MoveToXY(const Vec2i &pos)
 {
-	MapUnmarkUnitSight(*this);
+	const Vec2i oldPos = tilePos;
+
 	Map.Remove(*this);
 	UnmarkUnitFieldFlags(*this);
 
@@ -1075,9 +1144,10 @@ void CUnit::MoveToXY(const Vec2i &pos)
 
 	Map.Insert(*this);
 	MarkUnitFieldFlags(*this);
-	//  Recalculate the seen count.
+	//  Recalculate the seen count, with the sight still at oldPos.
 	UnitCountSeen(*this);
-	MapMarkUnitSight(*this);
+	//  Then only (un)mark the tiles entering or leaving the sight.
+	MapMoveUnitSight(*this, oldPos);
 }
 
 /**
@@ -1578,57 +1648,55 @@ void UnitGoesOutOfFog(CUnit &unit, const CPlayer &player)
 }
 
 /**
-**  Recalculates a units visiblity count. This happens really often,
-**  Like every time a unit moves. It's really fast though, since we
-**  have per-tile counts.
+**  Players which see the unit with their own sight, whose count is kept.
 **
-**  @param unit  pointer to the unit to check if seen
+**  @param unit  unit to check.
 */
-void UnitCountSeen(CUnit &unit)
+static int UnitVisCountMask(const CUnit &unit)
 {
-	Assert(unit.Type);
-
-	// FIXME: optimize, only work on certain players?
-	// This is for instance good for updating shared vision...
+	int mask = 0;
 
-	//  Store old values in oldv[p]. This store if the player could see the
-	//  unit before this calc.
-	int oldv[PlayerMax];
 	for (int p = 0; p < PlayerMax; ++p) {
-		if (Players[p].Type != PlayerNobody || p == ThisPlayer->Index) {
-			oldv[p] = unit.IsVisible(Players[p]);
+		if (unit.VisCount[p]) {
+			mask |= 1 << p;
 		}
 	}
+	return mask;
+}
 
-	//  Calculate new VisCount values.
-	const int height = unit.Type->TileHeight;
-	const int width = unit.Type->TileWidth;
+/**
+**  Players whose sight is used by the player: itself, and the players
+**  it shares vision with mutually. CUnit::IsVisible is true when one of
+**  them has the unit in sight.
+*/
+static int PlayerVisionMask(const CPlayer &player)
+{
+	int mask = 1 << player.Index;
 
-	for (int p = 0; p < PlayerMax; ++p) {
-		if (Players[p].Type != PlayerNobody || p == ThisPlayer->Index) {
-			int newv = 0;
-			int y = height;
-			unsigned int index = unit.Offset;
-			do {
-				CMapField *mf = Map.Field(index);
-				int x = width;
-				do {
-					if (unit.Type->BoolFlag[PERMANENTCLOAK_INDEX].value && unit.Player != &Players[p]) {
-						if (mf->playerInfo.VisCloak[p] || Players[p].Type == PlayerNobody) {
-							newv++;
-						}
-					} else {
-						if (mf->playerInfo.IsVisible(Players[p])) {
-							newv++;
-						}
-					}
-					++mf;
-				} while (--x);
-				index += Map.Info.MapWidth;
-			} while (--y);
-			unit.VisCount[p] = newv;
+	for (const int p : player.GetSharedVision()) {
+		if (player.HasMutualSharedVisionWith(Players[p])) {
+			mask |= 1 << p;
 		}
 	}
+	return mask;
+}
+
+/**
+**  Make the unit go in or out of fog for the players whose sight of it
+**  changed.
+**
+**  @param unit      the unit.
+**  @param oldMask   players which had the unit in sight before, see UnitVisCountMask.
+**  @param oldShare  vision of each player before, see PlayerVisionMask, NULL if unchanged.
+*/
+static void UnitUpdateFog(CUnit &unit, int oldMask, const int *oldShare)
+{
+	const int newMask = UnitVisCountMask(unit);
+
+	if (newMask == oldMask && oldShare == NULL) {
+		return;
+	}
+	const int changed = oldMask ^ newMask;
 
 	//
 	// Now here comes the tricky part. We have to go in and out of fog
@@ -1636,8 +1704,13 @@ void UnitCountSeen(CUnit &unit)
 	//
 	for (int p = 0; p < PlayerMax; ++p) {
 		if (Players[p].Type != PlayerNobody || p == ThisPlayer->Index) {
-			int newv = unit.IsVisible(Players[p]);
-			if (!oldv[p] && newv) {
+			const int share = PlayerVisionMask(Players[p]);
+			if (oldShare == NULL && !(share & changed)) {
+				continue;
+			}
+			const bool oldv = (oldMask & (oldShare ? oldShare[p] : share)) != 0;
+			const bool newv = (newMask & share) != 0;
+			if (!oldv && newv) {
 				// Might have revealed a destroyed unit which caused it to
 				// be released
 				if (!unit.Type) {
@@ -1645,13 +1718,108 @@ void UnitCountSeen(CUnit &unit)
 				}
 				UnitGoesOutOfFog(unit, Players[p]);
 			}
-			if (oldv[p] && !newv) {
+			if (oldv && !newv) {
 				UnitGoesUnderFog(unit, Players[p]);
 			}
 		}
 	}
 }
 
+/**
+**  Recalculates a units visiblity count. This happens really often,
+**  Like every time a unit moves. It's really fast though, since we
+**  have per-tile counts.
+**
+**  The fields keep a mask of the players which see them, so that each
+**  field of the unit is read once for all players. Only the players whose
+**  sight of the unit changed go in or out of fog.
+**
+**  @param unit  pointer to the unit to check if seen
+*/
+void UnitCountSeen(CUnit &unit)
+{
+	Assert(unit.Type);
+
+	//  Store which players could see the unit before this calc.
+	const int oldMask = UnitVisCountMask(unit);
+
+	//  Calculate new VisCount values.
+	const int height = unit.Type->TileHeight;
+	const int width = unit.Type->TileWidth;
+	int players = 0;  // players whose count is kept
+	int nobody = 0;
+
+	for (int p = 0; p < PlayerMax; ++p) {
+		if (Players[p].Type != PlayerNobody || p == ThisPlayer->Index) {
+			players |= 1 << p;
+			unit.VisCount[p] = 0;
+		}
+		if (Players[p].Type == PlayerNobody) {
+			nobody |= 1 << p;
+		}
+	}
+	// Permanently cloaked units are seen by their owner, and by the players detecting cloak.
+	const int owner = 1 << unit.Player->Index;
+	const bool cloaked = unit.Type->BoolFlag[PERMANENTCLOAK_INDEX].value;
+	int y = height;
+	unsigned int index = unit.Offset;
+	do {
+		for (unsigned int i = index; i != index + width; ++i) {
+			int seen;
+			if (Map.NoFogOfWar) {
+				seen = 0;
+				for (int p = 0; p < PlayerMax; ++p) {
+					if (Map.IsFieldVisible(Players[p], i)) {
+						seen |= 1 << p;
+					}
+				}
+			} else {
+				seen = Map.SightMask[i];
+			}
+			if (cloaked) {
+				seen = (seen & owner) | ((Map.CloakMask[i] | nobody) & ~owner);
+			}
+			seen &= players;
+			for (int p = 0; seen; ++p, seen >>= 1) {
+				unit.VisCount[p] += seen & 1;
+			}
+		}
+		index += Map.Info.MapWidth;
+	} while (--y);
+
+	UnitUpdateFog(unit, oldMask, NULL);
+}
+
+/**
+**  Make the units on the map go in or out of fog after a change of shared
+**  vision. The seen counts of the units do not change, only the players
+**  which see them through the shared vision.
+**
+**  @param oldShare  vision of each player before the change, see UnitsSharedVisionMasks.
+*/
+void UnitsUpdateSharedVision(const int *oldShare)
+{
+	for (CUnitManager::Iterator it = UnitManager.begin(); it != UnitManager.end(); ++it) {
+		CUnit &unit = **it;
+
+		if (!unit.Removed && !unit.Destroyed) {
+			UnitUpdateFog(unit, UnitVisCountMask(unit), oldShare);
+		}
+	}
+}
+
+/**
+**  Store the vision of each player, before a change of shared vision.
+**
+**  @param share  PlayerMax masks, see UnitsUpdateSharedVision.
+*/
+void UnitsSharedVisionMasks(int *share)
+{
+	for (int p = 0; p < PlayerMax; ++p) {
+		share[p] = PlayerVisionMask(Players[p]);
+	}
+}
+
 /**
 **  Returns true, if the unit is visible. It check the Viscount of
 **  the player and everyone who shares vision with him.
@@ -2798,6 +2966,8 @@ static void HitUnit_ApplyDamage(CUnit *attacker, CUnit &target, int damage)
 		}
 		target.Variable[HP_INDEX].Value -= damage - shieldDamage;
 	}
+	// Damage can set the unit on fire.
+	target.RegenActive = 1;
 	if (UseHPForXp && attacker && target.IsEnemy(*attacker)) {
 		attacker->Variable[XP_INDEX].Value += damage;
 		attacker->Variable[XP_INDEX].Max += damage;
@@ -66,6 +66,9 @@ void CMap::Insert(CUnit &unit)
 		} while (--j && unit.tilePos.x + (j - w) < Info.MapWidth);
 		index += Info.MapWidth;
 	} while (--i && unit.tilePos.y + (i - h) < Info.MapHeight);
+
+	UnitBucket(unit.tilePos).Insert(&unit);
+	MaxUnitTileSize = std::max(MaxUnitTileSize, std::max(w, h));
 }
 
 /**
@@ -90,6 +93,8 @@ void CMap::Remove(CUnit &unit)
 		} while (--j && unit.tilePos.x + (j - w) < Info.MapWidth);
 		index += Info.MapWidth;
 	} while (--i && unit.tilePos.y + (i - h) < Info.MapHeight);
+
+	UnitBucket(unit.tilePos).Remove(&unit);
 }
 
 
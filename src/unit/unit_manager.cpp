@@ -39,6 +39,14 @@
 #include "unit.h"
 #include "iolib.h"
 #include "script.h"
+#include "spells.h"
+#include "upgrade_structs.h"
+
+/*----------------------------------------------------------------------------
+--  Declarations
+----------------------------------------------------------------------------*/
+
+#define UNIT_SLAB_SIZE 256  /// Number of units allocated at once
 
 
 /*----------------------------------------------------------------------------
@@ -51,7 +59,7 @@ CUnitManager UnitManager;          /// Unit manager
 --  Functions
 ----------------------------------------------------------------------------*/
 
-CUnitManager::CUnitManager() : lastCreated(NULL)
+CUnitManager::CUnitManager() : loopCount(0), lastCreated(NULL), variableCount(0), spellCount(0), upgradeCount(0)
 {
 }
 
@@ -63,15 +71,89 @@ void CUnitManager::Init()
 	lastCreated = NULL;
 	//Assert(units.empty());
 	units.clear();
-	// Release memory of units in release list.
-	while (!releasedUnits.empty()) {
-		CUnit *unit = releasedUnits.front();
-		releasedUnits.pop_front();
-		delete unit;
-	}
+	releasedUnits.clear();
 
 	// Initialize the free unit slots
 	unitSlots.clear();
+	slotStates.clear();
+	// Release memory of all units, the next game sizes them again.
+	FreeSlabs();
+}
+
+/**
+**  Allocate the storage of UNIT_SLAB_SIZE more units.
+**
+**  The variable, spell and upgrade arrays of the units are sized from
+**  the game data when the first slab is allocated, and carved from
+**  the slab so that each unit needs no allocation of its own.
+*/
+void CUnitManager::AllocSlab()
+{
+	if (slabs.empty()) {
+		variableCount = UnitTypeVar.GetNumberVariable();
+		spellCount = SpellTypeTable.size();
+		upgradeCount = AllUpgrades.size();
+	}
+	const unsigned int upgradeWords = (upgradeCount + 31) / 32;
+	_unit_slab_ slab;
+
+	slab.Units = new CUnit[UNIT_SLAB_SIZE];
+	slab.Variables = variableCount ? new CVariable[UNIT_SLAB_SIZE * variableCount] : NULL;
+	slab.AutoCastSpells = spellCount ? new char[UNIT_SLAB_SIZE * spellCount] : NULL;
+	slab.SpellCoolDownTimers = spellCount ? new int[UNIT_SLAB_SIZE * spellCount] : NULL;
+	slab.Upgrades = upgradeWords ? new unsigned int[UNIT_SLAB_SIZE * upgradeWords] : NULL;
+	for (int i = 0; i < UNIT_SLAB_SIZE; ++i) {
+		CUnit &unit = slab.Units[i];
+
+		if (variableCount) {
+			unit.UnitManagerData.variables = slab.Variables + i * variableCount;
+		}
+		if (spellCount) {
+			unit.UnitManagerData.autoCastSpell = slab.AutoCastSpells + i * spellCount;
+			unit.UnitManagerData.spellCoolDownTimers = slab.SpellCoolDownTimers + i * spellCount;
+		}
+		if (upgradeWords) {
+			unit.IndividualUpgrades.Assign(slab.Upgrades + i * upgradeWords, upgradeCount);
+			unit.IndividualUpgrades.Clear();
+		}
+	}
+	slabs.push_back(slab);
+}
+
+/**
+**  Release the memory of all units.
+*/
+void CUnitManager::FreeSlabs()
+{
+	for (size_t i = 0; i != slabs.size(); ++i) {
+		for (int j = 0; j < UNIT_SLAB_SIZE; ++j) {
+			delete slabs[i].Units[j].pathFinderData;
+		}
+		delete[] slabs[i].Units;
+		delete[] slabs[i].Variables;
+		delete[] slabs[i].AutoCastSpells;
+		delete[] slabs[i].SpellCoolDownTimers;
+		delete[] slabs[i].Upgrades;
+	}
+	slabs.clear();
+}
+
+/**
+**  Take a new unit slot from the slabs.
+*/
+CUnit *CUnitManager::NewSlot()
+{
+	const int slot = unitSlots.size();
+
+	if (slot % UNIT_SLAB_SIZE == 0) {
+		AllocSlab();
+	}
+	CUnit *unit = &slabs.back().Units[slot % UNIT_SLAB_SIZE];
+
+	unit->UnitManagerData.slot = slot;
+	unitSlots.push_back(unit);
+	slotStates.push_back(_slot_state_());
+	return unit;
 }
 
 /**
@@ -81,6 +163,17 @@ void CUnitManager::Init()
 */
 CUnit *CUnitManager::AllocUnit()
 {
+	// The unit arrays must still fit the game data, else units would write past them.
+	if (!slabs.empty() && (variableCount != UnitTypeVar.GetNumberVariable()
+						   || spellCount != SpellTypeTable.size()
+						   || upgradeCount != AllUpgrades.size())) {
+		fprintf(stderr, "Variables, spells or upgrades defined after the first unit was made: "
+				"%u variables instead of %u, %u spells instead of %u, %u upgrades instead of %u\n",
+				UnitTypeVar.GetNumberVariable(), variableCount,
+				(unsigned int)SpellTypeTable.size(), spellCount,
+				(unsigned int)AllUpgrades.size(), upgradeCount);
+		ExitFatal(-1);
+	}
 	// Can use released unit?
 	if (!releasedUnits.empty() && releasedUnits.front()->ReleaseCycle < GameCycle) {
 		CUnit *unit = releasedUnits.front();
@@ -91,11 +184,7 @@ CUnit *CUnitManager::AllocUnit()
 		unit->UnitManagerData.unitSlot = -1;
 		return unit;
 	} else {
-		CUnit *unit = new CUnit;
-
-		unit->UnitManagerData.slot = unitSlots.size();
-		unitSlots.push_back(unit);
-		return unit;
+		return NewSlot();
 	}
 }
 
@@ -119,6 +208,7 @@ void CUnitManager::ReleaseUnit(CUnit *unit)
 		units[unit->UnitManagerData.unitSlot] = temp;
 		unit->UnitManagerData.unitSlot = -1;
 		units.pop_back();
+		slotStates[unit->UnitManagerData.slot].Unit = NULL;
 	}
 	releasedUnits.push_back(unit);
 	unit->ReleaseCycle = GameCycle + 500; // can be reused after this time
@@ -135,6 +225,21 @@ unsigned int CUnitManager::GetUsedSlotCount() const
 	return static_cast<unsigned int>(unitSlots.size());
 }
 
+/**
+**  Start a loop over the units in the game.
+**
+**  The loop goes through the slots, from 0 to the returned count, and
+**  gets each unit with GetLoopUnit. Units added during the loop, even in
+**  a released slot, are not part of it, and released units are skipped.
+**
+**  @return  Number of slots to go through.
+*/
+unsigned int CUnitManager::StartLoop()
+{
+	++loopCount;
+	return GetUsedSlotCount();
+}
+
 CUnitManager::Iterator CUnitManager::begin()
 {
 	return units.begin();
@@ -160,6 +265,30 @@ void CUnitManager::Add(CUnit *unit)
 	lastCreated = unit;
 	unit->UnitManagerData.unitSlot = static_cast<int>(units.size());
 	units.push_back(unit);
+
+	_slot_state_ &state = slotStates[unit->UnitManagerData.slot];
+	state.Unit = unit;
+	state.Added = loopCount;
+	UpdateSlot(*unit);
+}
+
+/**
+**  Copy the fields read by the loops of each cycle to the slot state.
+**
+**  The loops check them before touching the unit, so it must be called
+**  each time the type of a unit in the game changes or it is destroyed.
+**
+**  @param unit  Unit whose type or destroyed flag changed
+*/
+void CUnitManager::UpdateSlot(const CUnit &unit)
+{
+	_slot_state_ &state = slotStates[unit.UnitManagerData.slot];
+
+	if (state.Unit != &unit) {
+		return;
+	}
+	state.Type = unit.Type;
+	state.Destroyed = unit.Destroyed != 0;
 }
 
 /**
@@ -194,9 +323,7 @@ void CUnitManager::Load(lua_State *l)
 		LuaError(l, "incorrect argument");
 	}
 	for (unsigned int i = 0; i < unitCount; i++) {
-		CUnit *unit = new CUnit;
-		unitSlots.push_back(unit);
-		unit->UnitManagerData.slot = i;
+		NewSlot();
 	}
 	const unsigned int args = lua_rawlen(l, 2);
 	for (unsigned int i = 0; i < args; i++) {
@@ -92,6 +92,9 @@ void PathFinderInput::Save(CFile &file) const
 		file.printf("\"minrange\", %d, ", this->minRange);
 		file.printf("\"maxrange\", %d", this->maxRange);
 	}
+	if (this->isPathRequestDeferred) {
+		file.printf(", \"deferred\", %lu", this->deferredCycle);
+	}
 	file.printf("},\n  ");
 }
 
@@ -52,6 +52,7 @@
 #include "script.h"
 #include "unit.h"
 #include "unit_find.h"
+#include "unit_manager.h"
 #include "unittype.h"
 #include "util.h"
 
@@ -146,6 +147,10 @@ CUpgrade *CUpgrade::New(const std::string &ident)
 	if (upgrade) {
 		return upgrade;
 	} else {
+		if (UnitManager.IsGameDataSized()) {
+			fprintf(stderr, "Can't define the upgrade \"%s\" once units are made\n", ident.c_str());
+			ExitFatal(-1);
+		}
 		upgrade = new CUpgrade(ident);
 		Upgrades[ident] = upgrade;
 		upgrade->ID = AllUpgrades.size();
@@ -664,6 +669,7 @@ static void ApplyUpgradeModifier(CPlayer &player, const CUpgradeModifier *um)
 							clamp(&unit.Variable[j].Value, 0, unit.Variable[j].Max);
 						}
 					}
+					unit.ActivateBuffs();
 				}
 			}
 			if (um->ConvertTo) {
@@ -830,6 +836,7 @@ static void RemoveUpgradeModifier(CPlayer &player, const CUpgradeModifier *um)
 
 						clamp(&unit.Variable[j].Value, 0, unit.Variable[j].Max);
 					}
+					unit.ActivateBuffs();
 				}
 			}
 			if (um->ConvertTo) {
@@ -874,6 +881,7 @@ void ApplyIndividualUpgradeModifier(CUnit &unit, const CUpgradeModifier *um)
 			clamp(&unit.Variable[j].Value, 0, unit.Variable[j].Max);
 		}
 	}
+	unit.ActivateBuffs();
 	
 	if (um->ConvertTo) {
 		CommandTransformIntoType(unit, *um->ConvertTo);
@@ -909,6 +917,7 @@ static void RemoveIndividualUpgradeModifier(CUnit &unit, const CUpgradeModifier
 			clamp(&unit.Variable[j].Value, 0, unit.Variable[j].Max);
 		}
 	}
+	unit.ActivateBuffs();
 }
 
 /**
@@ -993,7 +1002,7 @@ void IndividualUpgradeAcquire(CUnit &unit, const CUpgrade *upgrade)
 {
 	int id = upgrade->ID;
 	unit.Player->UpgradeTimers.Upgrades[id] = upgrade->Costs[TimeCost];
-	unit.IndividualUpgrades[id] = true;
+	unit.IndividualUpgrades.Set(id, true);
 
 	for (int z = 0; z < NumUpgradeModifiers; ++z) {
 		if (UpgradeModifiers[z]->UpgradeId == id) {
@@ -1013,7 +1022,7 @@ void IndividualUpgradeLost(CUnit &unit, const CUpgrade *upgrade)
 {
 	int id = upgrade->ID;
 	unit.Player->UpgradeTimers.Upgrades[id] = 0;
-	unit.IndividualUpgrades[id] = false;
+	unit.IndividualUpgrades.Set(id, false);
 
 	for (int z = 0; z < NumUpgradeModifiers; ++z) {
 		if (UpgradeModifiers[z]->UpgradeId == id) {
@@ -209,8 +209,22 @@ void CGraphic::DrawFrameClipTrans(unsigned frame, int x, int y, int alpha) const
 void CPlayerColorGraphic::DrawPlayerColorFrameClip(int player, unsigned frame,
 												   int x, int y)
 {
-	GraphicPlayerPixels(Players[player], *this);
-	DrawFrameClip(frame, x, y);
+	SDL_Surface *surface = GetPlayerColorSurface(player, false);
+
+	if (surface == NULL) {
+		GraphicPlayerPixels(Players[player], *this);
+		DrawFrameClip(frame, x, y);
+		return;
+	}
+	int w = Width;
+	int h = Height;
+	const int oldx = x;
+	const int oldy = y;
+	CLIP_RECTANGLE(x, y, w, h);
+
+	SDL_Rect srect = {Sint16(frame_map[frame].x + x - oldx), Sint16(frame_map[frame].y + y - oldy), Uint16(w), Uint16(h)};
+	SDL_Rect drect = {Sint16(x), Sint16(y), 0, 0};
+	SDL_BlitSurface(surface, &srect, TheScreen, &drect);
 }
 
 /**
@@ -294,8 +308,90 @@ void CGraphic::DrawFrameClipTransX(unsigned frame, int x, int y, int alpha) cons
 void CPlayerColorGraphic::DrawPlayerColorFrameClipX(int player, unsigned frame,
 													int x, int y)
 {
-	GraphicPlayerPixels(Players[player], *this);
-	DrawFrameClipX(frame, x, y);
+	SDL_Surface *surface = GetPlayerColorSurface(player, true);
+
+	if (surface == NULL) {
+		GraphicPlayerPixels(Players[player], *this);
+		DrawFrameClipX(frame, x, y);
+		return;
+	}
+	SDL_Rect srect = {frameFlip_map[frame].x, frameFlip_map[frame].y, Uint16(Width), Uint16(Height)};
+
+	const int oldx = x;
+	const int oldy = y;
+	CLIP_RECTANGLE(x, y, srect.w, srect.h);
+	srect.x += x - oldx;
+	srect.y += y - oldy;
+
+	SDL_Rect drect = {Sint16(x), Sint16(y), 0, 0};
+	SDL_BlitSurface(surface, &srect, TheScreen, &drect);
+}
+
+/**
+**  Get the surface recolored for a player, make it on first use.
+**
+**  @param player  player number
+**  @param flip    true for the copy of SurfaceFlip
+**
+**  @return        the recolored surface, or NULL if the graphic has no palette.
+*/
+SDL_Surface *CPlayerColorGraphic::GetPlayerColorSurface(int player, bool flip)
+{
+	SDL_Surface *src = flip ? SurfaceFlip : Surface;
+
+	if (src == NULL || src->format->BytesPerPixel != 1
+		|| Players[player].UnitColors.Colors.size() < (size_t)PlayerColorIndexCount) {
+		return NULL;
+	}
+	if (ColorsVersion != PlayerColorsVersion) {
+		FreePlayerColorSurfaces();
+		ColorsVersion = PlayerColorsVersion;
+	}
+	SDL_Surface *&surface = flip ? PlayerColorSurfacesFlip[player] : PlayerColorSurfaces[player];
+	if (surface != NULL) {
+		return surface;
+	}
+	surface = SDL_ConvertSurface(src, src->format, 0);
+	if (surface == NULL) {
+		return NULL;
+	}
+	Uint32 ckey;
+	if (!SDL_GetColorKey(src, &ckey)) {
+		SDL_SetColorKey(surface, SDL_TRUE, ckey);
+	}
+	SDL_BlendMode blendMode;
+	SDL_GetSurfaceBlendMode(src, &blendMode);
+	SDL_SetSurfaceBlendMode(surface, blendMode);
+	Uint8 alpha;
+	SDL_GetSurfaceAlphaMod(src, &alpha);
+	SDL_SetSurfaceAlphaMod(surface, alpha);
+
+	const std::vector<CColor> &colors = Players[player].UnitColors.Colors;
+	std::vector<SDL_Color> sdlColors(colors.begin(), colors.end());
+	if (!sdlColors.empty()) {
+		SDL_SetPaletteColors(surface->format->palette, &sdlColors[0], PlayerColorIndexStart, PlayerColorIndexCount);
+	}
+	VideoPaletteListAdd(surface);
+	return surface;
+}
+
+/**
+**  Free the surfaces recolored for the players.
+*/
+void CPlayerColorGraphic::FreePlayerColorSurfaces()
+{
+	for (int i = 0; i < PlayerMax; ++i) {
+		if (PlayerColorSurfaces[i]) {
+			VideoPaletteListRemove(PlayerColorSurfaces[i]);
+			SDL_FreeSurface(PlayerColorSurfaces[i]);
+			PlayerColorSurfaces[i] = NULL;
+		}
+		if (PlayerColorSurfacesFlip[i]) {
+			VideoPaletteListRemove(PlayerColorSurfacesFlip[i]);
+			SDL_FreeSurface(PlayerColorSurfacesFlip[i]);
+			PlayerColorSurfacesFlip[i] = NULL;
+		}
+	}
 }
 
 /*----------------------------------------------------------------------------
@@ -544,6 +640,29 @@ static void ApplyGrayScale(SDL_Surface *Surface, int Width, int Height)
 	SDL_UnlockSurface(Surface);
 }
 
+/**
+**  Read the size of a PNG image from its header.
+**
+**  @param fp  File at the start of the image.
+**  @param w   Returns the width of the image.
+**  @param h   Returns the height of the image.
+**
+**  @return    true if the file is a PNG image.
+*/
+static bool ReadPngSize(CFile &fp, int &w, int &h)
+{
+	static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	unsigned char header[24];
+
+	if (fp.read(header, sizeof(header)) != sizeof(header)
+		|| memcmp(header, signature, sizeof(signature)) || memcmp(header + 12, "IHDR", 4)) {
+		return false;
+	}
+	w = (header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19];
+	h = (header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23];
+	return w > 0 && h > 0;
+}
+
 /**
 **  Load a graphic
 **
@@ -565,7 +684,16 @@ void CGraphic::Load(bool grayscale)
 		perror("Can't open file");
 		goto error;
 	}
-	Surface = IMG_Load_RW(fp.as_SDL_RWops(), 0);
+	if (HeadlessMode && ReadPngSize(fp, GraphicWidth, GraphicHeight)) {
+		// Nothing is displayed, only the frame layout matters
+		Surface = SDL_CreateRGBSurface(SDL_SWSURFACE, GraphicWidth, GraphicHeight, 8, 0, 0, 0, 0);
+		grayscale = false;
+	} else {
+		if (HeadlessMode) {
+			fp.seek(0, SEEK_SET);
+		}
+		Surface = IMG_Load_RW(fp.as_SDL_RWops(), 0);
+	}
 	if (Surface == NULL) {
 		fprintf(stderr, "Couldn't load file %s: %s", name.c_str(), IMG_GetError());
 		goto error;
@@ -747,6 +875,7 @@ void CGraphic::Resize(int w, int h)
 	}
 
 	Resized = true;
+	SurfaceChanged();
 	Uint32 ckey;
 	bool useckey = !SDL_GetColorKey(Surface, &ckey);
 
@@ -865,7 +994,7 @@ void CGraphic::SetOriginalSize()
 		return;
 	}
 
-	
+	SurfaceChanged();
 	if (Surface) {
 		FreeSurface(&Surface);
 		Surface = NULL;
@@ -935,6 +1064,7 @@ void CGraphic::SetPaletteColor(int idx, int r, int g, int b) {
 	color.g = g;
 	color.b = b;
 	SDL_SetPaletteColors(Surface->format->palette, &color, idx, 1);
+	SurfaceChanged();
 }
 
 static inline void dither(SDL_Surface *Surface) {
@@ -967,6 +1097,7 @@ void CGraphic::MakeShadow()
 			SDL_SetPaletteColors(SurfaceFlip->format->palette, colors, 0, 256);
 			dither(Surface);
 		}
+		SurfaceChanged();
 	}
 }
 
@@ -95,6 +95,18 @@ SDL_Surface *TheScreen; /// Internal screen
 static SDL_Rect Rects[100];
 static int NumRects;
 
+#define VIDEO_DIRTY_BAND 16         /// Rows of the screen compared at once to find the changes
+#define VIDEO_FULL_UPLOAD_FRAMES 32 /// Frames uploaded whole before looking for the changes again
+
+static std::vector<Uint8> UploadedPixels;  /// Copy of the pixels in TheTexture
+static bool UploadedPixelsStale;           /// A full upload didn't update UploadedPixels
+static int FullUploadsLeft;                /// Frames to upload whole without looking for the changes
+static bool PresentNeeded;                 /// Window needs the frame again
+
+int VideoFullUploadPercent = 50;        /// Upload the whole screen above this
+unsigned int VideoUploadedBytes;        /// Bytes uploaded by the last frame
+unsigned long VideoUploadedBytesTotal;  /// Bytes uploaded since start
+
 static std::map<int, std::string> Key2Str;
 static std::map<std::string, int> Str2Key;
 
@@ -252,6 +264,62 @@ static void InitKey2Str()
 	Key2Str[SDLK_UNDO] = "undo";
 }
 
+/**
+**  Initialize the colors used by the engine for the screen format.
+*/
+static void InitVideoColors()
+{
+	ColorBlack = Video.MapRGB(TheScreen->format, 0, 0, 0);
+	ColorDarkGreen = Video.MapRGB(TheScreen->format, 48, 100, 4);
+	ColorLightBlue = Video.MapRGB(TheScreen->format, 52, 113, 166);
+	ColorBlue = Video.MapRGB(TheScreen->format, 0, 0, 252);
+	ColorOrange = Video.MapRGB(TheScreen->format, 248, 140, 20);
+	ColorWhite = Video.MapRGB(TheScreen->format, 252, 248, 240);
+	ColorLightGray = Video.MapRGB(TheScreen->format, 192, 192, 192);
+	ColorGray = Video.MapRGB(TheScreen->format, 128, 128, 128);
+	ColorDarkGray = Video.MapRGB(TheScreen->format, 64, 64, 64);
+	ColorRed = Video.MapRGB(TheScreen->format, 252, 0, 0);
+	ColorGreen = Video.MapRGB(TheScreen->format, 0, 252, 0);
+	ColorYellow = Video.MapRGB(TheScreen->format, 252, 252, 0);
+
+	for(std::vector<std::string>::iterator it = UI.LifeBarColorNames.begin(); it != UI.LifeBarColorNames.end(); ++it) {
+		UI.LifeBarColorsInt.push_back(IndexToColor(GetColorIndexByName((*it).c_str())));
+	}
+}
+
+/**
+**  Initialize the video part without display, for headless games.
+**
+**  Only TheScreen exists, as a software surface, so the drawing code
+**  used while loading keeps working.
+*/
+void InitVideoHeadless()
+{
+	if (SDL_WasInit(SDL_INIT_TIMER) == 0) {
+		if (SDL_Init(SDL_INIT_TIMER) < 0) {
+			fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+			exit(1);
+		}
+		atexit(SDL_Quit);
+	}
+	if (!Video.Width || !Video.Height) {
+		Video.Width = 640;
+		Video.Height = 480;
+	}
+	TheScreen = SDL_CreateRGBSurface(0, Video.Width, Video.Height, 32,
+									 0x00ff0000,
+									 0x0000ff00,
+									 0x000000ff,
+									 0);
+	Video.Depth = TheScreen->format->BitsPerPixel;
+	SetClipping(0, 0, Video.Width - 1, Video.Height - 1);
+
+	InitKey2Str();
+	InitVideoColors();
+
+	UI.MouseWarpPos.x = UI.MouseWarpPos.y = -1;
+}
+
 /**
 **  Initialize the video part for SDL.
 */
@@ -415,23 +483,7 @@ void InitVideoSdl()
 	SDL_SetCursor(Video.blankCursor);
 
 	InitKey2Str();
-
-	ColorBlack = Video.MapRGB(TheScreen->format, 0, 0, 0);
-	ColorDarkGreen = Video.MapRGB(TheScreen->format, 48, 100, 4);
-	ColorLightBlue = Video.MapRGB(TheScreen->format, 52, 113, 166);
-	ColorBlue = Video.MapRGB(TheScreen->format, 0, 0, 252);
-	ColorOrange = Video.MapRGB(TheScreen->format, 248, 140, 20);
-	ColorWhite = Video.MapRGB(TheScreen->format, 252, 248, 240);
-	ColorLightGray = Video.MapRGB(TheScreen->format, 192, 192, 192);
-	ColorGray = Video.MapRGB(TheScreen->format, 128, 128, 128);
-	ColorDarkGray = Video.MapRGB(TheScreen->format, 64, 64, 64);
-	ColorRed = Video.MapRGB(TheScreen->format, 252, 0, 0);
-	ColorGreen = Video.MapRGB(TheScreen->format, 0, 252, 0);
-	ColorYellow = Video.MapRGB(TheScreen->format, 252, 252, 0);
-
-	for(std::vector<std::string>::iterator it = UI.LifeBarColorNames.begin(); it != UI.LifeBarColorNames.end(); ++it) {
-		UI.LifeBarColorsInt.push_back(IndexToColor(GetColorIndexByName((*it).c_str())));
-	}
+	InitVideoColors();
 
 	UI.MouseWarpPos.x = UI.MouseWarpPos.y = -1;
 }
@@ -517,6 +569,11 @@ static void SdlDoEvent(const EventCallback &callbacks, SDL_Event &event)
 				}
 				break;
 
+				case SDL_WINDOWEVENT_EXPOSED:
+				case SDL_WINDOWEVENT_SIZE_CHANGED:
+					PresentNeeded = true;
+					break;
+
 				case SDL_WINDOWEVENT_FOCUS_GAINED:
 				case SDL_WINDOWEVENT_FOCUS_LOST:
 				{
@@ -552,6 +609,13 @@ static void SdlDoEvent(const EventCallback &callbacks, SDL_Event &event)
 								  event.key.keysym.sym, event.key.keysym.sym < 128 ? event.key.keysym.sym : 0);
 			break;
 
+		case SDL_RENDER_TARGETS_RESET:
+		case SDL_RENDER_DEVICE_RESET:
+			// The content of the textures is lost
+			ForgetUploadedScreen();
+			Invalidate();
+			break;
+
 		case SDL_QUIT:
 			Exit(0);
 			break;
@@ -641,6 +705,202 @@ void WaitEventsOneFrame()
 	}
 }
 
+/**
+**  Merge the invalidated rectangles which overlap.
+**
+**  Two rectangles are merged when their bounding box is not larger
+**  than both areas together, so merging never uploads more pixels.
+**
+**  @return  the area covered by the merged rectangles.
+*/
+static int MergeInvalidatedRects()
+{
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (int i = 0; i < NumRects && !merged; ++i) {
+			for (int j = i + 1; j < NumRects; ++j) {
+				const SDL_Rect &a = Rects[i];
+				const SDL_Rect &b = Rects[j];
+				const int x1 = std::min(a.x, b.x);
+				const int y1 = std::min(a.y, b.y);
+				const int x2 = std::max(a.x + a.w, b.x + b.w);
+				const int y2 = std::max(a.y + a.h, b.y + b.h);
+
+				if ((x2 - x1) * (y2 - y1) > a.w * a.h + b.w * b.h) {
+					continue;
+				}
+				Rects[i].x = x1;
+				Rects[i].y = y1;
+				Rects[i].w = x2 - x1;
+				Rects[i].h = y2 - y1;
+				Rects[j] = Rects[--NumRects];
+				// The grown rectangle may now overlap the others again
+				merged = true;
+				break;
+			}
+		}
+	}
+	int area = 0;
+	for (int i = 0; i < NumRects; ++i) {
+		area += Rects[i].w * Rects[i].h;
+	}
+	return area;
+}
+
+/**
+**  Find the pixels of rect which differ from the uploaded frame and
+**  copy them to the uploaded frame.
+**
+**  The rectangle is compared a band of rows at a time, each band gives
+**  the bounding box of its changes.
+**
+**  @param rect   Invalidated rectangle.
+**  @param dirty  Where to append the changed rectangles.
+*/
+static void FindChangedRects(const SDL_Rect &rect, std::vector<SDL_Rect> &dirty)
+{
+	const int bpp = TheScreen->format->BytesPerPixel;
+	const int pitch = TheScreen->pitch;
+	const Uint8 *screen = (const Uint8 *)TheScreen->pixels + rect.x * bpp;
+	Uint8 *uploaded = &UploadedPixels[0] + rect.x * bpp;
+	const int len = rect.w * bpp;
+
+	for (int bandY = rect.y; bandY < rect.y + rect.h; bandY += VIDEO_DIRTY_BAND) {
+		const int bandEnd = std::min(bandY + VIDEO_DIRTY_BAND, rect.y + rect.h);
+		SDL_Rect changed;
+		int left = len;
+		int right = 0;
+		int top = bandEnd;
+		int bottom = bandY;
+
+		for (int y = bandY; y < bandEnd; ++y) {
+			const Uint8 *cur = screen + y * pitch;
+			Uint8 *old = uploaded + y * pitch;
+
+			if (memcmp(cur, old, len) == 0) {
+				continue;
+			}
+			int l = 0;
+			while (memcmp(cur + l, old + l, bpp) == 0) {
+				l += bpp;
+			}
+			int r = len;
+			while (memcmp(cur + r - bpp, old + r - bpp, bpp) == 0) {
+				r -= bpp;
+			}
+			memcpy(old + l, cur + l, r - l);
+			left = std::min(left, l);
+			right = std::max(right, r);
+			top = std::min(top, y);
+			bottom = y + 1;
+		}
+		if (top < bottom) {
+			changed.x = rect.x + left / bpp;
+			changed.y = top;
+			changed.w = (right - left) / bpp;
+			changed.h = bottom - top;
+			dirty.push_back(changed);
+		}
+	}
+}
+
+/**
+**  Upload the changed parts of TheScreen to TheTexture.
+**
+**  Only the pixels of the invalidated rectangles which changed since the
+**  last upload are copied, unless they cover VideoFullUploadPercent of
+**  the screen. So a screen redrawn the same, as menus and paused games
+**  are, uploads nothing.
+**
+**  Once most of the screen changed, as it does in game, the following
+**  frames which invalidate as much are uploaded whole without looking
+**  for the changes, for VIDEO_FULL_UPLOAD_FRAMES frames.
+**
+**  @return  true if something was uploaded.
+*/
+static bool UploadInvalidatedRects()
+{
+	const int screenArea = TheScreen->w * TheScreen->h;
+	const int bpp = TheScreen->format->BytesPerPixel;
+	const size_t size = TheScreen->h * TheScreen->pitch;
+
+	if (UploadedPixels.size() != size) {
+		// First frame or new texture: no copy to compare with
+		UploadedPixels.assign((const Uint8 *)TheScreen->pixels, (const Uint8 *)TheScreen->pixels + size);
+		UploadedPixelsStale = false;
+		FullUploadsLeft = 0;
+		SDL_UpdateTexture(TheTexture, NULL, TheScreen->pixels, TheScreen->pitch);
+		VideoUploadedBytes = size;
+		VideoUploadedBytesTotal += VideoUploadedBytes;
+		return true;
+	}
+	MergeInvalidatedRects();
+
+	int area = 0;
+	for (int i = 0; i < NumRects; ++i) {
+		area += Rects[i].w * Rects[i].h;
+	}
+	if (FullUploadsLeft > 0 && area * 100 >= screenArea * VideoFullUploadPercent) {
+		// The copy is only needed again by the frame after the last of them
+		if (--FullUploadsLeft == 0) {
+			memcpy(&UploadedPixels[0], TheScreen->pixels, size);
+			UploadedPixelsStale = false;
+		} else {
+			UploadedPixelsStale = true;
+		}
+		SDL_UpdateTexture(TheTexture, NULL, TheScreen->pixels, TheScreen->pitch);
+		VideoUploadedBytes = size;
+		VideoUploadedBytesTotal += VideoUploadedBytes;
+		return true;
+	}
+
+	std::vector<SDL_Rect> dirty;
+	if (UploadedPixelsStale) {
+		// TheTexture has the last frame, only the invalidated rectangles changed since.
+		memcpy(&UploadedPixels[0], TheScreen->pixels, size);
+		UploadedPixelsStale = false;
+		dirty.assign(Rects, Rects + NumRects);
+	} else {
+		for (int i = 0; i < NumRects; ++i) {
+			FindChangedRects(Rects[i], dirty);
+		}
+	}
+	int changedArea = 0;
+	for (size_t i = 0; i != dirty.size(); ++i) {
+		changedArea += dirty[i].w * dirty[i].h;
+	}
+	if (dirty.empty()) {
+		VideoUploadedBytes = 0;
+	} else if (changedArea * 100 >= screenArea * VideoFullUploadPercent) {
+		FullUploadsLeft = VIDEO_FULL_UPLOAD_FRAMES;
+		SDL_UpdateTexture(TheTexture, NULL, TheScreen->pixels, TheScreen->pitch);
+		VideoUploadedBytes = size;
+	} else {
+		VideoUploadedBytes = 0;
+		for (size_t i = 0; i != dirty.size(); ++i) {
+			const SDL_Rect &rect = dirty[i];
+			const Uint8 *pixels = (const Uint8 *)TheScreen->pixels + rect.y * TheScreen->pitch + rect.x * bpp;
+
+			SDL_UpdateTexture(TheTexture, &rect, pixels, TheScreen->pitch);
+			VideoUploadedBytes += rect.w * rect.h * bpp;
+		}
+	}
+	VideoUploadedBytesTotal += VideoUploadedBytes;
+	return !dirty.empty();
+}
+
+/**
+**  Forget what TheTexture holds, so that the next frame uploads the
+**  whole screen. Needed each time the texture is made again or loses
+**  its content.
+*/
+void ForgetUploadedScreen()
+{
+	UploadedPixels.clear();
+	PresentNeeded = true;
+}
+
 /**
 **  Realize video memory.
 */
@@ -649,15 +909,22 @@ static Uint32 LastTick = 0;
 
 void RealizeVideoMemory()
 {
+	if (HeadlessMode) {
+		NumRects = 0;
+		return;
+	}
 	if (NumRects) {
-		//SDL_UpdateWindowSurfaceRects(TheWindow, Rects, NumRects);
-		SDL_UpdateTexture(TheTexture, NULL, TheScreen->pixels, TheScreen->pitch);
+		const bool changed = UploadInvalidatedRects();
+		NumRects = 0;
+		if (!changed && !PresentNeeded) {
+			HideCursor();
+			return;
+		}
+		PresentNeeded = false;
 		if (CanUseShaders) {
 			RenderWithShader(TheRenderer, TheWindow, TheTexture);
 		} else {
 			SDL_RenderClear(TheRenderer);
-			//for (int i = 0; i < NumRects; i++)
-			//    SDL_UpdateTexture(TheTexture, &Rects[i], TheScreen->pixels, TheScreen->pitch);
 			SDL_RenderCopy(TheRenderer, TheTexture, NULL, NULL);
 			if (EnableDebugPrint) {
 				// show a bar representing fps scaled by 10
@@ -670,7 +937,8 @@ void RealizeVideoMemory()
 			}
 			SDL_RenderPresent(TheRenderer);
 		}
-		NumRects = 0;
+	} else {
+		VideoUploadedBytes = 0;
 	}
 	HideCursor();
 }
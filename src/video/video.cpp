@@ -144,6 +144,7 @@ private:
 ----------------------------------------------------------------------------*/
 
 extern void InitVideoSdl();         /// Init SDL video hardware driver
+extern void InitVideoHeadless();    /// Init video without display
 
 extern void SdlLockScreen();        /// Do SDL hardware lock
 extern void SdlUnlockScreen();      /// Do SDL hardware unlock
@@ -296,6 +297,7 @@ bool CVideo::ResizeScreen(int w, int h)
 	                               SDL_PIXELFORMAT_ARGB8888,
 	                               SDL_TEXTUREACCESS_STREAMING,
 	                               w, h);
+	ForgetUploadedScreen();
 
 	SetClipping(0, 0, w - 1, h - 1);
 
@@ -326,7 +328,11 @@ void DeInitImageLoaders()
 */
 void InitVideo()
 {
-	InitVideoSdl();
+	if (HeadlessMode) {
+		InitVideoHeadless();
+	} else {
+		InitVideoSdl();
+	}
 	InitLineDraw();
 }
 
@@ -0,0 +1,288 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_netrelay.cpp - The test file for netrelay.cpp. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+
+#include "network/netrelay.h"
+
+#include "net_lowlevel.h"
+#include "net_message.h"
+
+class AutoNetwork
+{
+public:
+	AutoNetwork() { NetInit(); }
+	~AutoNetwork() { NetExit(); }
+};
+
+static void AddCycle(CNetworkRelayStream &stream, uint32_t cycle)
+{
+	CNetworkRelayCycle entry;
+	CNetworkRelayCommand command;
+	unsigned char buf[MaxNetworkRelaySize];
+
+	entry.Header.Seq = stream.GetSize();
+	entry.Header.Cycle = cycle;
+	command.Player = cycle % PlayerMax;
+	command.Type = MessageCommandMove;
+	command.Data.assign(8, cycle & 0xFF);
+	entry.Commands.push_back(command);
+	stream.Add(buf, entry.Serialize(buf), cycle);
+}
+
+/// Read the relay entries waiting on socket, return the seq of the last one
+static int ReadEntries(CUDPSocket &socket, int *count)
+{
+	unsigned char buf[MaxNetworkRelaySize];
+	CHost from;
+	int last = -1;
+
+	*count = 0;
+	while (socket.HasDataToRead(50) > 0) {
+		const int len = socket.Recv(buf, sizeof(buf), &from);
+		CNetworkRelayHeader header;
+
+		if (len < (int)CNetworkRelayHeader::Size()) {
+			continue;
+		}
+		header.Deserialize(buf);
+		if (header.Subtype != RelayMessageAck) {
+			last = header.Seq;
+			++*count;
+		}
+	}
+	return last;
+}
+
+static void SendAck(CUDPSocket &socket, const CHost &relay, uint32_t next)
+{
+	CNetworkRelayHeader ack;
+	unsigned char buf[32];
+
+	ack.Seq = next;
+	socket.Send(relay, buf, ack.Serialize(buf));
+}
+
+TEST(CNetworkRelayCycle)
+{
+	CNetworkRelayCycle entry;
+	CNetworkRelayCommand command;
+
+	entry.Header.Seq = 42;
+	entry.Header.Cycle = 1234;
+	entry.More = 1;
+	command.Player = 3;
+	command.Type = MessageChat;
+	command.Data.assign(5, 'x');
+	entry.Commands.push_back(command);
+	command.Player = 4;
+	command.Type = MessageCommandStop;
+	command.Data.clear();
+	entry.Commands.push_back(command);
+
+	unsigned char buf[MaxNetworkRelaySize];
+	const size_t size = entry.Serialize(buf);
+	CHECK_EQUAL(entry.Size(), size);
+
+	CNetworkRelayCycle entry2;
+	CHECK_EQUAL(size, entry2.Deserialize(buf, size));
+	CHECK_EQUAL(42u, entry2.Header.Seq);
+	CHECK_EQUAL(1234u, entry2.Header.Cycle);
+	CHECK_EQUAL(1, entry2.More);
+	CHECK_EQUAL(2u, entry2.Commands.size());
+	CHECK_EQUAL(3, entry2.Commands[0].Player);
+	CHECK(entry2.Commands[0].Data == entry.Commands[0].Data);
+	CHECK(entry2.Commands[1].Data.empty());
+
+	// Truncated message
+	CHECK_EQUAL(0u, entry2.Deserialize(buf, size - 1));
+}
+
+TEST_FIXTURE(AutoNetwork, CNetworkRelay)
+{
+	const CHost relayHost("127.0.0.1", 6520);
+	const CHost sourceHost("127.0.0.1", 6521);
+	const CHost observerHost1("127.0.0.1", 6522);
+	const CHost observerHost2("127.0.0.1", 6523);
+	const unsigned int delay = 10;
+	CNetworkRelay relay;
+	CUDPSocket source;
+	CUDPSocket observer1;
+	CUDPSocket observer2;
+
+	CHECK(relay.Open(relayHost, delay, sourceHost));
+	CHECK(source.Open(sourceHost));
+	CHECK(observer1.Open(observerHost1));
+	CHECK(observer2.Open(observerHost2));
+
+	// The server sends the setup and 20 update cycles.
+	CNetworkRelayStream stream;
+	CNetworkRelaySetup setup;
+	unsigned char buf[MaxNetworkRelaySize];
+	stream.Add(buf, setup.Serialize(buf), 0);
+	for (uint32_t cycle = 2; cycle <= 40; cycle += 2) {
+		AddCycle(stream, cycle);
+	}
+	unsigned long ticks = 1000;
+	CNetworkRelayPeer peer(relayHost, ticks);
+	peer.Send(source, stream, stream.GetSize(), ticks);
+	CHECK_EQUAL(stream.GetSize(), peer.Sent);
+
+	relay.HasDataToRead(100);
+	relay.Update(ticks);
+	CHECK_EQUAL(stream.GetSize(), relay.GetStream().GetSize());
+	// Entries up to cycle 40 - delay are released.
+	CHECK_EQUAL(1u + 15u, relay.GetReleased());
+
+	// The relay acks what it has.
+	CHECK(source.HasDataToRead(100) > 0);
+	CHost from;
+	const int len = source.Recv(buf, sizeof(buf), &from);
+	CHECK_EQUAL((int)CNetworkRelayHeader::Size(), len);
+	CNetworkRelayHeader ack;
+	ack.Deserialize(buf);
+	CHECK(from == relayHost);
+	CHECK_EQUAL(RelayMessageAck, ack.Subtype);
+	CHECK_EQUAL(stream.GetSize(), ack.Seq);
+
+	// Observers subscribe and get the released entries.
+	SendAck(observer1, relayHost, 0);
+	SendAck(observer2, relayHost, 0);
+	relay.HasDataToRead(100);
+	relay.Update(ticks);
+	CHECK_EQUAL(2, relay.GetObserverCount());
+	int count;
+	CHECK_EQUAL(15, ReadEntries(observer1, &count));
+	CHECK_EQUAL(16, count);
+	CHECK_EQUAL(15, ReadEntries(observer2, &count));
+	CHECK_EQUAL(16, count);
+
+	// Observer 2 lost everything after the setup: it gets them again
+	// once its acks stop moving.
+	SendAck(observer1, relayHost, 16);
+	SendAck(observer2, relayHost, 1);
+	ticks += 100;
+	relay.HasDataToRead(100);
+	relay.Update(ticks);
+	CHECK_EQUAL(-1, ReadEntries(observer2, &count));
+	ticks += 1000;
+	relay.Update(ticks);
+	CHECK_EQUAL(-1, ReadEntries(observer1, &count));
+	CHECK_EQUAL(15, ReadEntries(observer2, &count));
+	CHECK_EQUAL(15, count);
+
+	// More cycles release more entries.
+	AddCycle(stream, 42);
+	peer.Send(source, stream, stream.GetSize(), ticks);
+	relay.HasDataToRead(100);
+	relay.Update(ticks);
+	CHECK_EQUAL(17u, relay.GetReleased());
+	CHECK_EQUAL(16, ReadEntries(observer1, &count));
+	CHECK_EQUAL(1, count);
+
+	// Silent observers are dropped.
+	ticks += 60000;
+	relay.Update(ticks);
+	CHECK_EQUAL(0, relay.GetObserverCount());
+}
+
+TEST_FIXTURE(AutoNetwork, CNetworkRelay_Restart)
+{
+	const CHost relayHost("127.0.0.1", 6530);
+	const CHost sourceHost("127.0.0.1", 6531);
+	const CHost strayHost("127.0.0.2", 6532);
+	const CHost observerHost("127.0.0.1", 6533);
+	CNetworkRelay relay;
+	CUDPSocket source;
+	CUDPSocket stray;
+	CUDPSocket observer;
+
+	// The source is bound by address only, any port.
+	CHECK(relay.Open(relayHost, 10, CHost("127.0.0.1", 0)));
+	CHECK(source.Open(sourceHost));
+	CHECK(stray.Open(strayHost));
+	CHECK(observer.Open(observerHost));
+
+	unsigned char buf[MaxNetworkRelaySize];
+	unsigned long ticks = 1000;
+
+	// A stray sender can't take the relay.
+	CNetworkRelayStream strayStream;
+	CNetworkRelaySetup straySetup;
+	straySetup.Game = 7;
+	strayStream.Add(buf, straySetup.Serialize(buf), 0);
+	CNetworkRelayPeer strayPeer(relayHost, ticks);
+	strayPeer.Send(stray, strayStream, strayStream.GetSize(), ticks);
+	relay.HasDataToRead(100);
+	relay.Update(ticks);
+	CHECK_EQUAL(0u, relay.GetStream().GetSize());
+
+	// First game of the source.
+	CNetworkRelayStream stream;
+	CNetworkRelaySetup setup;
+	setup.Game = 1;
+	stream.Add(buf, setup.Serialize(buf), 0);
+	for (uint32_t cycle = 2; cycle <= 40; cycle += 2) {
+		AddCycle(stream, cycle);
+	}
+	CNetworkRelayPeer peer(relayHost, ticks);
+	peer.Send(source, stream, stream.GetSize(), ticks);
+	relay.HasDataToRead(100);
+	relay.Update(ticks);
+	CHECK_EQUAL(stream.GetSize(), relay.GetStream().GetSize());
+	SendAck(observer, relayHost, 0);
+	relay.HasDataToRead(100);
+	relay.Update(ticks);
+	CHECK_EQUAL(1, relay.GetObserverCount());
+
+	// A resend of the setup of the same game changes nothing.
+	peer = CNetworkRelayPeer(relayHost, ticks);
+	peer.Send(source, stream, 1, ticks);
+	relay.HasDataToRead(100);
+	relay.Update(ticks);
+	CHECK_EQUAL(stream.GetSize(), relay.GetStream().GetSize());
+	CHECK_EQUAL(1, relay.GetObserverCount());
+
+	// The server restarts with the same settings: the old game is dropped.
+	stream.Clear();
+	setup.Game = 2;
+	stream.Add(buf, setup.Serialize(buf), 0);
+	AddCycle(stream, 2);
+	AddCycle(stream, 4);
+	peer = CNetworkRelayPeer(relayHost, ticks);
+	peer.Send(source, stream, stream.GetSize(), ticks);
+	relay.HasDataToRead(100);
+	relay.Update(ticks);
+	CHECK_EQUAL(3u, relay.GetStream().GetSize());
+	CHECK(relay.GetStream().IsSameEntry(0, &stream.GetEntry(0)[0], stream.GetEntry(0).size()));
+	CHECK_EQUAL(1u, relay.GetReleased());
+	CHECK_EQUAL(0, relay.GetObserverCount());
+}
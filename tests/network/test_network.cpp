@@ -58,6 +58,11 @@ void FillCustomValue(CNetworkCommandSync *obj)
 {
 	obj->syncSeed = 0x01234567;
 	obj->syncHash = 0x89ABCDEF;
+	obj->unitHash = 0x13579BDF;
+	obj->missileHash = 0x2468ACE0;
+	obj->playerHash = 0x0F1E2D3C;
+	obj->sendTicks = 0x11223344;
+	obj->echoTicks = 0x55667788;
 }
 void FillCustomValue(CNetworkCommandQuit *obj)
 {
@@ -139,5 +144,90 @@ TEST(CNetworkPacketHeader)
 {
 	CHECK(CheckSerialization<CNetworkPacketHeader>());
 }
-//TEST(CNetworkPacket)
+TEST(CNetworkPacket)
+{
+	CNetworkPacket packet1;
+	CNetworkCommand nc;
+	CNetworkCommandSync ns;
+
+	FillCustomValue(&nc);
+	FillCustomValue(&ns);
+	packet1.Header.Cycle = 42;
+	packet1.Header.OrigPlayer = 3;
+	for (int i = 0; i != MaxNetworkCommands; ++i) {
+		packet1.Header.Type[i] = MessageNone;
+	}
+	packet1.Header.Type[0] = MessageCommandMove;
+	packet1.Command[0].resize(nc.Size());
+	nc.Serialize(&packet1.Command[0][0]);
+	packet1.Header.Type[1] = MessageSync;
+	packet1.Command[1].resize(ns.Size());
+	ns.Serialize(&packet1.Command[1][0]);
+
+	// Previous packet with the same move, a changed sync and a chat.
+	CNetworkChat chat;
+	FillCustomValue(&chat);
+	ns.syncSeed ^= 0x00FF0000;
+	ns.sendTicks -= 33;
+	packet1.PreviousCount = 1;
+	packet1.PreviousHeader[0].Cycle = 41;
+	packet1.PreviousHeader[0].Type[0] = MessageCommandMove;
+	packet1.PreviousCommand[0][0] = packet1.Command[0];
+	packet1.PreviousHeader[0].Type[1] = MessageSync;
+	packet1.PreviousCommand[0][1].resize(ns.Size());
+	ns.Serialize(&packet1.PreviousCommand[0][1][0]);
+	packet1.PreviousHeader[0].Type[2] = MessageChat;
+	packet1.PreviousCommand[0][2].resize(chat.Size());
+	chat.Serialize(&packet1.PreviousCommand[0][2][0]);
+	for (int i = 3; i != MaxNetworkCommands; ++i) {
+		packet1.PreviousHeader[0].Type[i] = MessageNone;
+	}
 
+	packet1.EncodePrevious(2);
+	const size_t size = packet1.Size(2);
+	unsigned char *buffer = new unsigned char [size];
+	CHECK(packet1.Serialize(buffer, 2) == size);
+
+	CNetworkPacket packet2;
+	int commands;
+	packet2.Deserialize(buffer, size, &commands);
+	delete [] buffer;
+
+	CHECK(commands == 2);
+	CHECK(Comp(packet1.Header, packet2.Header));
+	CHECK(packet1.Command[0] == packet2.Command[0]);
+	CHECK(packet1.Command[1] == packet2.Command[1]);
+	CHECK(packet2.PreviousCount == 1);
+	CHECK(packet2.PreviousCommandCount(0) == 3);
+	CHECK(packet2.PreviousHeader[0].Cycle == 41);
+	for (int i = 0; i != 3; ++i) {
+		CHECK(packet1.PreviousHeader[0].Type[i] == packet2.PreviousHeader[0].Type[i]);
+		CHECK(packet1.PreviousCommand[0][i] == packet2.PreviousCommand[0][i]);
+	}
+}
+
+TEST(CNetworkPacket_Truncated)
+{
+	CNetworkPacket packet1;
+	CNetworkChat chat;
+
+	FillCustomValue(&chat);
+	for (int i = 0; i != MaxNetworkCommands; ++i) {
+		packet1.Header.Type[i] = MessageNone;
+	}
+	packet1.Header.Type[0] = MessageChat;
+	packet1.Command[0].resize(chat.Size());
+	chat.Serialize(&packet1.Command[0][0]);
+
+	const size_t size = packet1.Size(1);
+	unsigned char *buffer = new unsigned char [size];
+	CHECK(packet1.Serialize(buffer, 1) == size);
+
+	// Cut inside the command data: the size read must not go past the end.
+	CNetworkPacket packet2;
+	int commands;
+	packet2.Deserialize(buffer, CNetworkPacketHeader::Size() + 2 + packet1.Command[0].size() - 1, &commands);
+	delete [] buffer;
+
+	CHECK(commands == -1);
+}
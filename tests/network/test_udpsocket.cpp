@@ -31,7 +31,7 @@
 
 #include "stratagus.h"
 
-#include "network/udpsocket.h"
+#include "network/netsockets.h"
 
 #include "net_lowlevel.h"
 
@@ -108,3 +108,53 @@ TEST_FIXTURE(AutoNetwork, CUDPSocket)
 	socket2.Close();
 	CHECK(socket2.IsValid() == false);
 }
+
+TEST_FIXTURE(AutoNetwork, CUDPSocketBatch)
+{
+	const CHost host1("127.0.0.1", 6503);
+	const CHost host2("127.0.0.1", 6504);
+	const CHost host3("127.0.0.1", 6505);
+
+	CUDPSocket socket1;
+	CUDPSocket socket2;
+	CUDPSocket socket3;
+
+	socket1.Open(host1);
+	socket2.Open(host2);
+	socket3.Open(host3);
+
+	Foo foo;
+	foo.Fill();
+
+	// Two copies for socket2, one for socket3.
+	const CHost hosts[] = {host2, host3, host2};
+	socket1.SendBatch(hosts, 3, &foo, sizeof(foo));
+
+	Foo foos[4];
+	int lens[4];
+	CHost froms[4];
+	int count = 0;
+	while (count != 2 && socket2.HasDataToRead(1000) > 0) {
+		const int res = socket2.RecvBatch(reinterpret_cast<unsigned char *>(&foos[count]), sizeof(Foo), 4 - count, lens + count, froms + count);
+		CHECK(res > 0);
+		if (res <= 0) {
+			break;
+		}
+		count += res;
+	}
+	CHECK_EQUAL(2, count);
+	for (int i = 0; i != count; ++i) {
+		CHECK_EQUAL(int(sizeof(Foo)), lens[i]);
+		CHECK(host1 == froms[i]);
+		CHECK(foos[i].Check());
+	}
+
+	CHECK(socket3.HasDataToRead(1000));
+	CHECK_EQUAL(1, socket3.RecvBatch(reinterpret_cast<unsigned char *>(&foos[0]), sizeof(Foo), 4, lens, froms));
+	CHECK(foos[0].Check());
+
+#ifdef DEBUG
+	CHECK_EQUAL(1u, socket1.getStatistic().sentBatchCount);
+	CHECK_EQUAL(3u, socket1.getStatistic().sentPacketsCount);
+#endif
+}
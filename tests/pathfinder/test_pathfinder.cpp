@@ -0,0 +1,189 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_pathfinder.cpp - The test file for pathfinder.cpp. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "pathfinder.h"
+
+#include <vector>
+
+/// A unit asking a path again as soon as it has one
+struct PathRequester {
+	PathRequester() : Deferred(false), DeferredCycle(0), Served(0) {}
+
+	bool Deferred;
+	unsigned long DeferredCycle;
+	int Served;
+};
+
+TEST(PathRequestBudget_Saturated)
+{
+	const int unitCount = 50;
+	const int nodesPerSearch = 300;
+	const int budget = 1000;
+	const unsigned long cycleCount = 500;
+	std::vector<PathRequester> units(unitCount);
+	PathRequestBudget requests;
+	unsigned long maxWait = 0;
+
+	requests.Reset(budget, 0);
+	for (unsigned long cycle = 1; cycle <= cycleCount; ++cycle) {
+		requests.NewCycle(budget, cycle);
+		int served = 0;
+		// Units ask in slot order, as in UnitActions.
+		for (int i = 0; i != unitCount; ++i) {
+			PathRequester &unit = units[i];
+			const unsigned long deferredCycle = unit.Deferred ? unit.DeferredCycle : cycle;
+
+			if (requests.CanSearch(deferredCycle)) {
+				requests.Served(deferredCycle, nodesPerSearch);
+				if (unit.Deferred) {
+					maxWait = std::max(maxWait, cycle - unit.DeferredCycle);
+				}
+				unit.Deferred = false;
+				++unit.Served;
+				++served;
+			} else {
+				requests.Deferred(deferredCycle);
+				if (!unit.Deferred) {
+					unit.Deferred = true;
+					unit.DeferredCycle = cycle;
+				}
+			}
+		}
+		// The budget is spent each cycle.
+		CHECK(served > 0 && served < unitCount);
+	}
+	// Every unit, whatever its slot, is served within a bounded number of cycles.
+	CHECK(maxWait <= (unsigned long)unitCount);
+	for (int i = 0; i != unitCount; ++i) {
+		CHECK(units[i].Served >= (int)(cycleCount / unitCount));
+	}
+}
+
+TEST(PathRequestBudget_OldestGone)
+{
+	PathRequestBudget requests;
+
+	requests.Reset(1000, 0);
+	requests.NewCycle(1000, 1);
+	// 10 searches of 100 nodes spend the budget, an 11th request waits.
+	for (int i = 0; i != 10; ++i) {
+		CHECK(requests.CanSearch(1));
+		requests.Served(1, 100);
+	}
+	CHECK(!requests.CanSearch(1));
+	requests.Deferred(1);
+
+	// The waiting request never asks again, the new ones only keep what it may use.
+	requests.NewCycle(1000, 2);
+	int served = 0;
+	while (requests.CanSearch(2)) {
+		requests.Served(2, 100);
+		++served;
+	}
+	CHECK_EQUAL(9, served);
+	requests.Deferred(2);
+	// The waiting request is still served.
+	CHECK(requests.CanSearch(1));
+}
+
+TEST(PathRequestBudget_OldestServedOnce)
+{
+	PathRequestBudget requests;
+
+	requests.Reset(1000, 0);
+	requests.NewCycle(1000, 1);
+	requests.Served(1, 100);
+	requests.Deferred(1);
+	requests.Deferred(1);
+
+	// A new search spends the budget before the waiting requests ask.
+	requests.NewCycle(1000, 2);
+	CHECK(requests.CanSearch(2));
+	requests.Served(2, 1000);
+	// One of them is served anyway, the other one waits.
+	CHECK(requests.CanSearch(1));
+	requests.Served(1, 100);
+	CHECK(!requests.CanSearch(1));
+}
+
+TEST(PathRequestBudget_NoLimit)
+{
+	PathRequestBudget requests;
+
+	requests.Reset(0, 0);
+	requests.NewCycle(0, 1);
+	for (int i = 0; i != 100; ++i) {
+		CHECK(requests.CanSearch(1));
+		requests.Served(1, 100000);
+	}
+}
+
+/// A path of length steps going east
+static std::vector<char> PathEast(int length)
+{
+	const char east = (char)XY2Heading[2][1];
+
+	return std::vector<char>(length, east);
+}
+
+TEST(FindSharedPathJoin_FollowerAhead)
+{
+	// The follower stands between the leader and the goal.
+	const Vec2i leaderPos(5, 5);
+	const Vec2i goalPos(25, 5);
+	const Vec2i goalSize(1, 1);
+	const std::vector<char> path = PathEast(20);
+	const Vec2i followerPos(8, 6);
+	Vec2i joinPos;
+
+	const int join = FindSharedPathJoin(leaderPos, &path[0], (int)path.size(), followerPos,
+										goalPos, goalSize, joinPos);
+	// It joins the path just ahead of it, not at the start of the leader.
+	CHECK_EQUAL(4, join);
+	CHECK(joinPos == Vec2i(9, 5));
+}
+
+TEST(FindSharedPathJoin_FollowerBehind)
+{
+	const Vec2i leaderPos(5, 5);
+	const Vec2i goalPos(25, 5);
+	const Vec2i goalSize(1, 1);
+	const std::vector<char> path = PathEast(20);
+	Vec2i joinPos;
+
+	CHECK_EQUAL(0, FindSharedPathJoin(leaderPos, &path[0], (int)path.size(), Vec2i(2, 5),
+									  goalPos, goalSize, joinPos));
+	CHECK(joinPos == leaderPos);
+	// Too far from every step of the path
+	CHECK_EQUAL(-1, FindSharedPathJoin(leaderPos, &path[0], (int)path.size(), Vec2i(10, 20),
+									   goalPos, goalSize, joinPos));
+}
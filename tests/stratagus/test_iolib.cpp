@@ -0,0 +1,79 @@
+//       _________ __                 __
+//      /   _____//  |_____________ _/  |______     ____  __ __  ______
+//      \_____  \\   __\_  __ \__  \\   __\__  \   / ___\|  |  \/  ___/
+//      /        \|  |  |  | \// __ \|  |  / __ \_/ /_/  >  |  /\___ |
+//     /_______  /|__|  |__|  (____  /__| (____  /\___  /|____//____  >
+//             \/                  \/          \//_____/            \/
+//  ______________________                           ______________________
+//                        T H E   W A R   B E G I N S
+//         Stratagus - A free fantasy real time strategy game engine
+//
+/**@name test_iolib.cpp - The test file for iolib.cpp. */
+//
+//      (c) Copyright 2026 by the Stratagus Team
+//
+//      This program is free software; you can redistribute it and/or modify
+//      it under the terms of the GNU General Public License as published by
+//      the Free Software Foundation; only version 2 of the License.
+//
+//      This program is distributed in the hope that it will be useful,
+//      but WITHOUT ANY WARRANTY; without even the implied warranty of
+//      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//      GNU General Public License for more details.
+//
+//      You should have received a copy of the GNU General Public License
+//      along with this program; if not, write to the Free Software
+//      Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+//      02111-1307, USA.
+//
+
+
+#include <UnitTest++.h>
+
+#include "stratagus.h"
+#include "iolib.h"
+
+static std::string PrintToMemory(const char *format, int i, unsigned long ul, const char *s)
+{
+	CFile file;
+	std::string data;
+
+	file.open("memory", CL_OPEN_WRITE | CL_WRITE_MEMORY);
+	file.printf(format, i, ul, s);
+	file.close();
+	file.takeMemory(data);
+	return data;
+}
+
+TEST(CFILE_PRINTF_STREAMED)
+{
+	CHECK_EQUAL("-42 123456789 text %", PrintToMemory("%d %lu %s %%", -42, 123456789, "text"));
+	CHECK_EQUAL("0 0 ", PrintToMemory("%d %lu %s", 0, 0, ""));
+}
+
+TEST(CFILE_PRINTF_FORMATTED)
+{
+	CHECK_EQUAL("  -42|00042|text  ", PrintToMemory("%5d|%05lu|%-6s", -42, 42, "text"));
+}
+
+TEST(CFILE_PRINTF_LARGE)
+{
+	CFile file;
+	std::string expected;
+	std::string data;
+
+	file.open("memory", CL_OPEN_WRITE | CL_WRITE_MEMORY);
+	for (int i = 0; i < 50000; ++i) {
+		char buf[32];
+
+		snprintf(buf, sizeof(buf), "{%d, \"%x\"}\n", i, i);
+		expected += buf;
+		file.printf("{%d, \"%x\"}\n", i, i);
+	}
+	const std::string longText(100000, 'a');
+	expected += longText;
+	file.printf("%s", longText.c_str());
+	file.close();
+	file.takeMemory(data);
+	CHECK(expected == data);
+}